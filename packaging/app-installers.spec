@@ -23,7 +23,10 @@ BuildRequires:  pkgconfig(pkgmgr-installer)
 BuildRequires:  pkgconfig(security-manager)
 BuildRequires:  pkgconfig(libiri)
 BuildRequires:  pkgconfig(libxml-2.0)
+BuildRequires:  pkgconfig(openssl)
 BuildRequires:  pkgconfig(zlib)
+BuildRequires:  pkgconfig(libdeflate)
+BuildRequires:  pkgconfig(libzstd)
 BuildRequires:  pkgconfig(minizip)
 BuildRequires:  pkgconfig(libzip)
 BuildRequires:  pkgconfig(libtzplatform-config)
@@ -56,6 +59,15 @@ Requires:   %{name} = %{version}
 %description devel
 This package contains header files of app-installers common library
 
+%package delta-generator
+Summary:    Generator of delta packages
+Group:      Application Framework/Package Management
+Requires:   %{name} = %{version}
+
+%description delta-generator
+Tool which creates delta package updating one version of package to
+another, as applied by app-installers during delta update
+
 %package tests
 Summary: Unit tests for app-installers
 Requires: %{name} = %{version}
@@ -102,6 +114,10 @@ make %{?_smp_mflags}
 %{_includedir}/app-installers/common/*/*/*.h
 %{_libdir}/pkgconfig/app-installers.pc
 
+%files delta-generator
+%manifest app-installers.manifest
+%{_bindir}/delta-generator
+
 %files tests
 %manifest app-installers-tests.manifest
 %{_bindir}/app-installers-ut/*
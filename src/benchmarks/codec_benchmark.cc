@@ -0,0 +1,243 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache-2.0 license that can be
+// found in the LICENSE file.
+
+// Compares extraction of the same package content compressed with deflate
+// and with zstd (zip method 93). Content is taken from given package or
+// generated. Reports wall time and cpu time (user + system) of extraction.
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <unzip.h>
+#include <zip.h>
+#include <zstd.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/utils/byte_size_literals.h"
+#include "common/utils/zip_extractor.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+namespace bpo = boost::program_options;
+namespace ci = common_installer;
+
+namespace {
+
+const int kZipMethodZstd = 93;
+const uint64_t kFileSize = 1_MB;
+const unsigned kMaxPath = 4096;
+
+struct PackageFile {
+  std::string name;
+  std::vector<char> data;
+};
+
+bool ReadPackage(const bf::path& path, std::vector<PackageFile>* files) {
+  unzFile zip_file = unzOpen64(path.c_str());
+  if (!zip_file) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+  bool result = true;
+  for (int ret = unzGoToFirstFile(zip_file); ret == UNZ_OK && result;
+       ret = unzGoToNextFile(zip_file)) {
+    unz_file_info64 info;
+    char name[kMaxPath];
+    if (unzGetCurrentFileInfo64(zip_file, &info, name, sizeof(name), nullptr,
+                                0, nullptr, 0) != UNZ_OK ||
+        unzOpenCurrentFile(zip_file) != UNZ_OK) {
+      result = false;
+      break;
+    }
+    PackageFile file;
+    file.name = name;
+    file.data.resize(info.uncompressed_size);
+    if (!file.data.empty() &&
+        unzReadCurrentFile(zip_file, file.data.data(), file.data.size()) !=
+        static_cast<int>(file.data.size()))
+      result = false;
+    unzCloseCurrentFile(zip_file);
+    files->push_back(std::move(file));
+  }
+  unzClose(zip_file);
+  if (!result)
+    std::cerr << "Failed to read " << path << std::endl;
+  return result;
+}
+
+void GenerateContent(uint64_t total_size, std::vector<PackageFile>* files) {
+  static const char kWords[][8] = {
+    "<app ", "id=", "\"a\" ", "name ", "value ", "</app>", "\n", "  "
+  };
+  std::mt19937 generator(0);
+  for (uint64_t i = 0; i * kFileSize < total_size; ++i) {
+    PackageFile file;
+    file.name = "res/file" + std::to_string(i) + ".xml";
+    file.data.resize(kFileSize);
+    size_t pos = 0;
+    while (pos < file.data.size()) {
+      const char* word = kWords[generator() % 8];
+      while (*word && pos < file.data.size())
+        file.data[pos++] = *word++;
+    }
+    files->push_back(std::move(file));
+  }
+}
+
+bool WritePackage(const bf::path& path, const std::vector<PackageFile>& files,
+                  bool zstd, int zstd_level) {
+  zipFile zip_file = zipOpen64(path.c_str(), APPEND_STATUS_CREATE);
+  if (!zip_file) {
+    std::cerr << "Cannot create " << path << std::endl;
+    return false;
+  }
+  zip_fileinfo info = {};
+  bool result = true;
+  std::vector<char> compressed;
+  for (auto& file : files) {
+    if (!zstd) {
+      result =
+          zipOpenNewFileInZip64(zip_file, file.name.c_str(), &info, nullptr,
+                                0, nullptr, 0, nullptr, Z_DEFLATED,
+                                Z_DEFAULT_COMPRESSION, 1) == ZIP_OK &&
+          zipWriteInFileInZip(zip_file, file.data.data(),
+                              file.data.size()) == ZIP_OK &&
+          zipCloseFileInZip(zip_file) == ZIP_OK;
+    } else {
+      compressed.resize(ZSTD_compressBound(file.data.size()));
+      size_t size = ZSTD_compress(compressed.data(), compressed.size(),
+                                  file.data.data(), file.data.size(),
+                                  zstd_level);
+      uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(file.data.data()),
+                        file.data.size());
+      // raw mode stores data compressed by us with given method
+      result = !ZSTD_isError(size) &&
+          zipOpenNewFileInZip2_64(zip_file, file.name.c_str(), &info,
+                                  nullptr, 0, nullptr, 0, nullptr,
+                                  kZipMethodZstd, 0, 1, 1) == ZIP_OK &&
+          zipWriteInFileInZip(zip_file, compressed.data(), size) == ZIP_OK &&
+          zipCloseFileInZipRaw64(zip_file, file.data.size(), crc) == ZIP_OK;
+    }
+    if (!result)
+      break;
+  }
+  if (zipClose(zip_file, nullptr) != ZIP_OK)
+    result = false;
+  if (!result)
+    std::cerr << "Failed to write " << path << std::endl;
+  return result;
+}
+
+double CpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+      (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+bool RunScenario(const std::string& name, const bf::path& package,
+                 const bf::path& work_dir, uint64_t total_size) {
+  bf::path destination = work_dir / "extracted";
+  bs::error_code error;
+  bf::remove_all(destination, error);
+  bf::create_directories(destination, error);
+  if (error) {
+    std::cerr << "Cannot create " << destination << std::endl;
+    return false;
+  }
+  sync();
+
+  double cpu_start = CpuSeconds();
+  auto start = std::chrono::steady_clock::now();
+  ci::ZipExtractor extractor(package, destination, ci::ExtractOptions());
+  if (!extractor.Extract("")) {
+    std::cerr << "Extraction failed: " << name << std::endl;
+    return false;
+  }
+  auto extracted = std::chrono::steady_clock::now();
+  double cpu_s = CpuSeconds() - cpu_start;
+  sync();
+  auto synced = std::chrono::steady_clock::now();
+
+  double extract_s =
+      std::chrono::duration<double>(extracted - start).count();
+  double total_s = std::chrono::duration<double>(synced - start).count();
+  double mb = static_cast<double>(total_size) / 1_MB;
+  std::cout << std::left << std::setw(16) << name << std::right
+            << std::fixed << std::setprecision(1)
+            << std::setw(8) << bf::file_size(package) / 1_MB << " MB"
+            << std::setw(10) << mb / extract_s << " MB/s"
+            << std::setw(10) << mb / total_s << " MB/s (with sync)"
+            << std::setprecision(3)
+            << std::setw(10) << cpu_s << " s cpu" << std::endl;
+  bf::remove_all(destination, error);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bpo::options_description options("Allowed options");
+  bpo::variables_map opt_map;
+  try {
+    options.add_options()
+        ("help,h", "display this help message")
+        ("package,p", bpo::value<std::string>(),
+            "package which content is used, generated if not given")
+        ("size,s", bpo::value<unsigned>()->default_value(200),
+            "size of generated content in MB")
+        ("level,l", bpo::value<int>()->default_value(19),
+            "zstd compression level")
+        ("work-dir,w", bpo::value<std::string>()->default_value("/tmp"),
+            "directory where packages are created and extracted");
+    bpo::store(bpo::parse_command_line(argc, argv, options), opt_map);
+    if (opt_map.count("help")) {
+      std::cerr << options << std::endl;
+      return 0;
+    }
+    bpo::notify(opt_map);
+  } catch (const bpo::error& error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+
+  std::vector<PackageFile> files;
+  if (opt_map.count("package")) {
+    if (!ReadPackage(opt_map["package"].as<std::string>(), &files))
+      return -1;
+  } else {
+    GenerateContent(opt_map["size"].as<unsigned>() * 1_MB, &files);
+  }
+  uint64_t total_size = 0;
+  for (auto& file : files)
+    total_size += file.data.size();
+
+  bf::path work_dir =
+      bf::path(opt_map["work-dir"].as<std::string>()) / "codec-benchmark";
+  bs::error_code error;
+  bf::create_directories(work_dir, error);
+  bf::path deflate_package = work_dir / "deflate.zip";
+  bf::path zstd_package = work_dir / "zstd.zip";
+  int result = 0;
+  if (!WritePackage(deflate_package, files, false, 0) ||
+      !WritePackage(zstd_package, files, true,
+                    opt_map["level"].as<int>()) ||
+      !RunScenario("deflate", deflate_package, work_dir, total_size) ||
+      !RunScenario("zstd", zstd_package, work_dir, total_size))
+    result = -1;
+  bf::remove_all(work_dir, error);
+  return result;
+}
@@ -0,0 +1,293 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache-2.0 license that can be
+// found in the LICENSE file.
+
+// Compares full and delta update of synthetic package. Old version is
+// installed, new version differs in small edits of some files and in some
+// added and removed files. Full update time is time of extracting new
+// package, delta update time is time of extracting delta package created
+// by PackageDelta and running StepDeltaPatch, after which content must be
+// the same as content of new package.
+
+#include <pkgmgr_parser.h>
+#include <unistd.h>
+#include <zip.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/installer_context.h"
+#include "common/step/filesystem/step_delta_patch.h"
+#include "common/utils/byte_size_literals.h"
+#include "common/utils/file_util.h"
+#include "delta_generator/package_delta.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+namespace bpo = boost::program_options;
+namespace ci = common_installer;
+
+namespace {
+
+const char kPkgId[] = "org.tizen.deltabenchmark";
+const uint64_t kMinFileSize = 4_kB;
+const uint64_t kMaxFileSize = 2_MB;
+const unsigned kEditsPerFile = 8;
+
+struct PackageFile {
+  std::string name;
+  std::string data;
+};
+
+void GenerateContent(uint64_t total_size, std::mt19937* generator,
+                     std::vector<PackageFile>* files) {
+  static const char kWords[][8] = {
+    "<app ", "id=", "\"a\" ", "name ", "value ", "</app>", "\n", "  "
+  };
+  uint64_t size = 0;
+  for (unsigned i = 0; size < total_size; ++i) {
+    PackageFile file;
+    uint64_t file_size =
+        kMinFileSize + (*generator)() % (kMaxFileSize - kMinFileSize);
+    // half of files is text like, half incompressible like binaries
+    if (i % 2) {
+      file.name = "res/file" + std::to_string(i) + ".xml";
+      while (file.data.size() < file_size)
+        file.data += kWords[(*generator)() % 8];
+    } else {
+      file.name = (i == 0 ? "bin/" : "lib/") + std::string("file") +
+          std::to_string(i);
+      file.data.resize(file_size);
+      for (auto& c : file.data)
+        c = (*generator)();
+    }
+    size += file.data.size();
+    files->push_back(std::move(file));
+  }
+}
+
+// modifies, removes and adds given percentage of files
+void MakeNewVersion(const std::vector<PackageFile>& old_files,
+                    uint64_t total_size, unsigned changed_percent,
+                    std::mt19937* generator,
+                    std::vector<PackageFile>* new_files) {
+  std::vector<PackageFile> added;
+  for (auto& file : old_files) {
+    unsigned dice = (*generator)() % 100;
+    // binary in bin/ is kept, step expects the directory
+    if (dice < changed_percent / 2 && file.name.compare(0, 4, "bin/") != 0)
+      continue;
+    new_files->push_back(file);
+    if (dice < changed_percent) {
+      std::string& data = new_files->back().data;
+      for (unsigned i = 0; i < kEditsPerFile; ++i) {
+        size_t pos = (*generator)() % data.size();
+        data.insert(pos, "edit" + std::to_string((*generator)()));
+      }
+    }
+  }
+  GenerateContent(total_size * changed_percent / 200, generator, &added);
+  for (auto& file : added) {
+    file.name = "res/added/" + bf::path(file.name).filename().string();
+    new_files->push_back(std::move(file));
+  }
+}
+
+bool WritePackage(const bf::path& path,
+                  const std::vector<PackageFile>& files) {
+  zipFile zip_file = zipOpen64(path.c_str(), APPEND_STATUS_CREATE);
+  if (!zip_file) {
+    std::cerr << "Cannot create " << path << std::endl;
+    return false;
+  }
+  zip_fileinfo info = {};
+  bool result = true;
+  for (auto& file : files) {
+    result =
+        zipOpenNewFileInZip64(zip_file, file.name.c_str(), &info, nullptr,
+                              0, nullptr, 0, nullptr, Z_DEFLATED,
+                              Z_DEFAULT_COMPRESSION, 1) == ZIP_OK &&
+        zipWriteInFileInZip(zip_file, file.data.data(),
+                            file.data.size()) == ZIP_OK &&
+        zipCloseFileInZip(zip_file) == ZIP_OK;
+    if (!result)
+      break;
+  }
+  if (zipClose(zip_file, nullptr) != ZIP_OK)
+    result = false;
+  if (!result)
+    std::cerr << "Failed to write " << path << std::endl;
+  return result;
+}
+
+bool CheckContent(const bf::path& dir, const std::vector<PackageFile>& files) {
+  unsigned count = 0;
+  for (bf::recursive_directory_iterator iter(dir);
+      iter != bf::recursive_directory_iterator(); ++iter) {
+    if (bf::is_regular_file(iter->status()))
+      ++count;
+  }
+  if (count != files.size()) {
+    std::cerr << "Expected " << files.size() << " files, found " << count
+              << std::endl;
+    return false;
+  }
+  for (auto& file : files) {
+    std::ifstream stream((dir / file.name).string(), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(stream)),
+                     std::istreambuf_iterator<char>());
+    if (data != file.data) {
+      std::cerr << "Content differs: " << file.name << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+bool RunDeltaUpdate(const bf::path& delta_package, const bf::path& root,
+                    const bf::path& unpacked) {
+  if (!ci::ExtractToTmpDir(delta_package.c_str(), unpacked)) {
+    std::cerr << "Failed to extract " << delta_package << std::endl;
+    return false;
+  }
+  ci::InstallerContext context;
+  context.unpacked_dir_path.set(unpacked);
+  context.root_application_path.set(root);
+  context.pkgid.set(kPkgId);
+  // step looks for icons of web applications in manifest of old version
+  context.old_manifest_data.set(
+      static_cast<manifest_x*>(calloc(1, sizeof(manifest_x))));
+  ci::filesystem::StepDeltaPatch step(&context);
+  if (step.precheck() != ci::Step::Status::OK ||
+      step.process() != ci::Step::Status::OK) {
+    std::cerr << "Failed to apply delta" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void PrintResult(const std::string& name, const bf::path& package,
+                 double seconds) {
+  std::cout << std::left << std::setw(8) << name << std::right
+            << std::fixed << std::setprecision(1)
+            << std::setw(8) << static_cast<double>(bf::file_size(package)) /
+                1_MB << " MB package"
+            << std::setprecision(3)
+            << std::setw(10) << seconds << " s" << std::endl;
+}
+
+bool Run(const bf::path& work_dir, uint64_t size, unsigned changed_percent,
+         double max_patch_ratio) {
+  std::mt19937 generator(0);
+  std::vector<PackageFile> old_files;
+  std::vector<PackageFile> new_files;
+  GenerateContent(size, &generator, &old_files);
+  MakeNewVersion(old_files, size, changed_percent, &generator, &new_files);
+
+  bf::path old_package = work_dir / "old.tpk";
+  bf::path new_package = work_dir / "new.tpk";
+  bf::path delta_package = work_dir / "delta.tpk";
+  bf::path root = work_dir / "apps";
+  bf::path full_dir = work_dir / "full";
+  bf::path unpacked = work_dir / "unpacked";
+  bs::error_code error;
+  for (auto& dir : {root / kPkgId, full_dir, unpacked})
+    bf::create_directories(dir, error);
+  if (error) {
+    std::cerr << "Cannot create directories in " << work_dir << std::endl;
+    return false;
+  }
+  if (!WritePackage(old_package, old_files) ||
+      !WritePackage(new_package, new_files) ||
+      !ci::ExtractToTmpDir(old_package.c_str(), root / kPkgId))
+    return false;
+
+  auto start = std::chrono::steady_clock::now();
+  ci::PackageDelta delta(old_package, new_package, max_patch_ratio);
+  if (!delta.Create(delta_package)) {
+    std::cerr << "Failed to create delta package" << std::endl;
+    return false;
+  }
+  double generate_s = Seconds(start);
+  const ci::PackageDelta::Stats& stats = delta.stats();
+  std::cout << "delta: " << stats.added << " added, " << stats.patched
+            << " patched, " << stats.replaced << " replaced, "
+            << stats.removed << " removed, generated in " << std::fixed
+            << std::setprecision(3) << generate_s << " s" << std::endl;
+
+  sync();
+  start = std::chrono::steady_clock::now();
+  if (!ci::ExtractToTmpDir(new_package.c_str(), full_dir)) {
+    std::cerr << "Failed to extract " << new_package << std::endl;
+    return false;
+  }
+  sync();
+  PrintResult("full", new_package, Seconds(start));
+
+  start = std::chrono::steady_clock::now();
+  if (!RunDeltaUpdate(delta_package, root, unpacked))
+    return false;
+  sync();
+  PrintResult("delta", delta_package, Seconds(start));
+
+  return CheckContent(unpacked, new_files);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bpo::options_description options("Allowed options");
+  bpo::variables_map opt_map;
+  try {
+    options.add_options()
+        ("help,h", "display this help message")
+        ("size,s", bpo::value<unsigned>()->default_value(100),
+            "size of package content in MB")
+        ("changed,c", bpo::value<unsigned>()->default_value(5),
+            "percentage of files changed, half of them is modified, "
+            "other half removed and as much added")
+        ("max-patch-ratio,r", bpo::value<double>()->default_value(0.8),
+            "ratio of patch and file size above which file is replaced")
+        ("work-dir,w", bpo::value<std::string>()->default_value("/tmp"),
+            "directory where packages are created and installed");
+    bpo::store(bpo::parse_command_line(argc, argv, options), opt_map);
+    if (opt_map.count("help")) {
+      std::cerr << options << std::endl;
+      return 0;
+    }
+    bpo::notify(opt_map);
+  } catch (const bpo::error& error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+
+  bf::path work_dir =
+      bf::path(opt_map["work-dir"].as<std::string>()) / "delta-benchmark";
+  bs::error_code error;
+  bf::create_directories(work_dir, error);
+  int result = 0;
+  if (!Run(work_dir, opt_map["size"].as<unsigned>() * 1_MB,
+           opt_map["changed"].as<unsigned>(),
+           opt_map["max-patch-ratio"].as<double>()))
+    result = -1;
+  ci::RemoveTree(work_dir);
+  return result;
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache-2.0 license that can be
+// found in the LICENSE file.
+
+// Measures throughput of package extraction for different ExtractOptions.
+// Synthetic package contains both deflated (text like) and stored (random,
+// incompressible like media assets) entries.
+
+#include <unistd.h>
+#include <zip.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/utils/byte_size_literals.h"
+#include "common/utils/zip_extractor.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+namespace bpo = boost::program_options;
+namespace ci = common_installer;
+
+namespace {
+
+const uint64_t kFileSize = 2_MB;
+const int kFilesPerDirectory = 16;
+
+struct Scenario {
+  const char* name;
+  unsigned threads;
+  size_t buffer_size;
+  bool preallocate;
+};
+
+const Scenario kScenarios[] = {
+  {"8 KiB writes, no preallocation, 1 thread", 1, 8_kB, false},
+  {"8 KiB writes, preallocation, 1 thread", 1, 8_kB, true},
+  {"256 KiB writes, preallocation, 1 thread", 1, 256_kB, true},
+  {"1 MiB writes, preallocation, 1 thread", 1, 1_MB, true},
+  {"256 KiB writes, preallocation, all cores", 0, 256_kB, true},
+};
+
+void FillCompressible(std::mt19937* generator, std::vector<char>* data) {
+  static const char kWords[][8] = {
+    "<app ", "id=", "\"a\" ", "name ", "value ", "</app>", "\n", "  "
+  };
+  size_t pos = 0;
+  while (pos < data->size()) {
+    const char* word = kWords[(*generator)() % 8];
+    while (*word && pos < data->size())
+      (*data)[pos++] = *word++;
+  }
+}
+
+void FillRandom(std::mt19937* generator, std::vector<char>* data) {
+  for (auto& byte : *data)
+    byte = static_cast<char>((*generator)());
+}
+
+bool CreatePackage(const bf::path& path, uint64_t total_size) {
+  zipFile zip_file = zipOpen64(path.c_str(), APPEND_STATUS_CREATE);
+  if (!zip_file) {
+    std::cerr << "Cannot create " << path << std::endl;
+    return false;
+  }
+  std::mt19937 generator(0);
+  std::vector<char> data(kFileSize);
+  zip_fileinfo info = {};
+  bool result = true;
+  for (uint64_t i = 0; i * kFileSize < total_size && result; ++i) {
+    bool stored = (i % 2) == 1;
+    if (stored)
+      FillRandom(&generator, &data);
+    else
+      FillCompressible(&generator, &data);
+    std::string name = "res/dir" + std::to_string(i / kFilesPerDirectory) +
+        "/file" + std::to_string(i) + (stored ? ".png" : ".xml");
+    int method = stored ? 0 : Z_DEFLATED;
+    int level = stored ? 0 : Z_DEFAULT_COMPRESSION;
+    result =
+        zipOpenNewFileInZip(zip_file, name.c_str(), &info, nullptr, 0,
+                            nullptr, 0, nullptr, method, level) == ZIP_OK &&
+        zipWriteInFileInZip(zip_file, data.data(), data.size()) == ZIP_OK &&
+        zipCloseFileInZip(zip_file) == ZIP_OK;
+  }
+  if (zipClose(zip_file, nullptr) != ZIP_OK)
+    result = false;
+  if (!result)
+    std::cerr << "Failed to write " << path << std::endl;
+  return result;
+}
+
+bool RunScenario(const Scenario& scenario, const bf::path& package,
+                 const bf::path& work_dir, uint64_t total_size) {
+  bf::path destination = work_dir / "extracted";
+  bs::error_code error;
+  bf::remove_all(destination, error);
+  bf::create_directories(destination, error);
+  if (error) {
+    std::cerr << "Cannot create " << destination << std::endl;
+    return false;
+  }
+  sync();
+
+  ci::ExtractOptions options;
+  options.threads = scenario.threads;
+  options.buffer_size = scenario.buffer_size;
+  options.preallocate = scenario.preallocate;
+
+  auto start = std::chrono::steady_clock::now();
+  ci::ZipExtractor extractor(package, destination, options);
+  if (!extractor.Extract("")) {
+    std::cerr << "Extraction failed: " << scenario.name << std::endl;
+    return false;
+  }
+  auto extracted = std::chrono::steady_clock::now();
+  sync();
+  auto synced = std::chrono::steady_clock::now();
+
+  double extract_s =
+      std::chrono::duration<double>(extracted - start).count();
+  double total_s = std::chrono::duration<double>(synced - start).count();
+  double mb = static_cast<double>(total_size) / 1_MB;
+  std::cout << std::left << std::setw(44) << scenario.name << std::right
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << mb / extract_s << " MB/s"
+            << std::setw(10) << mb / total_s << " MB/s (with sync)"
+            << std::endl;
+  bf::remove_all(destination, error);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bpo::options_description options("Allowed options");
+  bpo::variables_map opt_map;
+  try {
+    options.add_options()
+        ("help,h", "display this help message")
+        ("size,s", bpo::value<unsigned>()->default_value(200),
+            "size of package content in MB")
+        ("work-dir,w", bpo::value<std::string>()->default_value("/tmp"),
+            "directory where package is created and extracted");
+    bpo::store(bpo::parse_command_line(argc, argv, options), opt_map);
+    if (opt_map.count("help")) {
+      std::cerr << options << std::endl;
+      return 0;
+    }
+    bpo::notify(opt_map);
+  } catch (const bpo::error& error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+
+  uint64_t total_size = opt_map["size"].as<unsigned>() * 1_MB;
+  bf::path work_dir =
+      bf::path(opt_map["work-dir"].as<std::string>()) / "extract-benchmark";
+  bs::error_code error;
+  bf::create_directories(work_dir, error);
+  bf::path package = work_dir / "package.zip";
+  if (!CreatePackage(package, total_size))
+    return -1;
+
+  int result = 0;
+  for (auto& scenario : kScenarios) {
+    if (!RunScenario(scenario, package, work_dir, total_size)) {
+      result = -1;
+      break;
+    }
+  }
+  bf::remove_all(work_dir, error);
+  return result;
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache-2.0 license that can be
+// found in the LICENSE file.
+
+// Measures inflate and crc32 throughput of every Inflater backend available
+// in this build on in-memory raw deflate stream.
+
+#include <zlib.h>
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/utils/byte_size_literals.h"
+#include "common/utils/inflater.h"
+
+namespace bpo = boost::program_options;
+namespace ci = common_installer;
+
+namespace {
+
+void FillCompressible(std::vector<uint8_t>* data) {
+  static const char kWords[][8] = {
+    "<app ", "id=", "\"a\" ", "name ", "value ", "</app>", "\n", "  "
+  };
+  std::mt19937 generator(0);
+  size_t pos = 0;
+  while (pos < data->size()) {
+    const char* word = kWords[generator() % 8];
+    while (*word && pos < data->size())
+      (*data)[pos++] = *word++;
+  }
+}
+
+bool Deflate(const std::vector<uint8_t>& input,
+             std::vector<uint8_t>* output) {
+  z_stream stream = {};
+  // negative window bits: raw deflate as stored in zip
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  output->resize(deflateBound(&stream, input.size()));
+  stream.next_in = const_cast<Bytef*>(input.data());
+  stream.avail_in = input.size();
+  stream.next_out = output->data();
+  stream.avail_out = output->size();
+  int ret = deflate(&stream, Z_FINISH);
+  output->resize(stream.total_out);
+  deflateEnd(&stream);
+  return ret == Z_STREAM_END;
+}
+
+bool RunBackend(const std::string& backend,
+                const std::vector<uint8_t>& compressed,
+                const std::vector<uint8_t>& original, unsigned iterations) {
+  std::unique_ptr<ci::Inflater> inflater = ci::Inflater::Create(backend);
+  if (!inflater)
+    return false;
+  std::vector<uint8_t> output(original.size());
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i) {
+    if (!inflater->Inflate(compressed.data(), compressed.size(),
+                           output.data(), output.size())) {
+      std::cerr << "Inflate failed: " << backend << std::endl;
+      return false;
+    }
+  }
+  auto inflated = std::chrono::steady_clock::now();
+  uint32_t crc = 0;
+  for (unsigned i = 0; i < iterations; ++i)
+    crc = inflater->Crc32(0, output.data(), output.size());
+  auto checksummed = std::chrono::steady_clock::now();
+
+  if (output != original ||
+      crc != crc32(0, original.data(), original.size())) {
+    std::cerr << "Invalid output: " << backend << std::endl;
+    return false;
+  }
+
+  double mb = static_cast<double>(original.size()) * iterations / 1_MB;
+  double inflate_s =
+      std::chrono::duration<double>(inflated - start).count();
+  double crc_s =
+      std::chrono::duration<double>(checksummed - inflated).count();
+  std::cout << std::left << std::setw(12) << backend << std::right
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << mb / inflate_s << " MB/s inflate"
+            << std::setw(10) << mb / crc_s << " MB/s crc32" << std::endl;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bpo::options_description options("Allowed options");
+  bpo::variables_map opt_map;
+  try {
+    options.add_options()
+        ("help,h", "display this help message")
+        ("size,s", bpo::value<unsigned>()->default_value(16),
+            "size of uncompressed data in MB")
+        ("iterations,i", bpo::value<unsigned>()->default_value(20),
+            "number of repetitions");
+    bpo::store(bpo::parse_command_line(argc, argv, options), opt_map);
+    if (opt_map.count("help")) {
+      std::cerr << options << std::endl;
+      return 0;
+    }
+    bpo::notify(opt_map);
+  } catch (const bpo::error& error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+
+  std::vector<uint8_t> original(opt_map["size"].as<unsigned>() * 1_MB);
+  FillCompressible(&original);
+  std::vector<uint8_t> compressed;
+  if (!Deflate(original, &compressed)) {
+    std::cerr << "Failed to deflate test data" << std::endl;
+    return -1;
+  }
+
+  unsigned iterations = opt_map["iterations"].as<unsigned>();
+  for (auto& backend : ci::Inflater::AvailableBackends()) {
+    if (!RunBackend(backend, compressed, original, iterations))
+      return -1;
+  }
+  return 0;
+}
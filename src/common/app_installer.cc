@@ -3,26 +3,60 @@
 // Use of this source code is governed by a apache 2.0 license that can be
 // found in the LICENSE file.
 
+#include <unistd.h>
+
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
-#include <unistd.h>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "common/app_installer.h"
 #include "common/installer_context.h"
 #include "common/pkgmgr_interface.h"
 #include "common/pkgmgr_signal.h"
+#include "common/utils/sync_registry.h"
+#include "common/utils/thread_pool.h"
+#include "common/utils/trash.h"
 
 namespace {
 
 const unsigned kProgressRange = 100;
 
+// number of threads used to run independent steps concurrently
+const char kParallelStepsEnvironmentVariable[] =
+    "APP_INSTALLERS_PARALLEL_STEPS";
+
+// restores flushing of all filesystems with sync() at the end of request
+const char kFullSyncEnvironmentVariable[] = "APP_INSTALLERS_FULL_SYNC";
+
+bool GetFullSyncFromEnvironment() {
+  const char* value = getenv(kFullSyncEnvironmentVariable);
+  return value && strcmp(value, "1") == 0;
+}
+
+unsigned GetParallelStepsFromEnvironment() {
+  const char* value = getenv(kParallelStepsEnvironmentVariable);
+  if (!value || !*value)
+    return 0;
+  return strtoul(value, nullptr, 10);
+}
+
 }
 
 namespace common_installer {
 
 AppInstaller::AppInstaller(const char* package_type, PkgMgrPtr pkgmgr)
     : pkgmgr_(pkgmgr),
-      context_(new InstallerContext()) {
+      context_(new InstallerContext()),
+      tracer_(StepTracer::CreateFromEnvironment()),
+      parallel_threads_(GetParallelStepsFromEnvironment()),
+      full_sync_(GetFullSyncFromEnvironment()) {
   context_->pkg_type.set(package_type);
   context_->installation_mode.set(pkgmgr->GetInstallationMode());
 
@@ -36,59 +70,173 @@ AppInstaller::AppInstaller(const char* package_type, PkgMgrPtr pkgmgr)
 AppInstaller::~AppInstaller() {
 }
 
-AppInstaller::Result AppInstaller::Run() {
-  std::list<std::unique_ptr<Step>>::iterator it(steps_.begin());
-  std::list<std::unique_ptr<Step>>::iterator itStart(steps_.begin());
-  std::list<std::unique_ptr<Step>>::iterator itEnd(steps_.end());
+void AppInstaller::EnableStepTracing(const boost::filesystem::path& output) {
+  tracer_.reset(new StepTracer(output));
+}
 
-  Step::Status process_status = Step::Status::OK;
-  Result ret = Result::OK;
-  unsigned total_steps = steps_.size();
-  unsigned current_step = 1;
+void AppInstaller::EnableParallelSteps(unsigned threads) {
+  parallel_threads_ = threads;
+}
+
+void AppInstaller::EnableFullSync(bool full_sync) {
+  full_sync_ = full_sync;
+}
 
-  for (; it != itEnd; ++it, ++current_step) {
-    try {
-      process_status = (*it)->precheck();
-    } catch (const std::exception& err) {
-      LOG(ERROR) << "Exception occurred in precheck(): " << err.what()
-                 << " in step: " << (*it)->name();
-      process_status = Step::Status::ERROR;
+Step::Status AppInstaller::RunStep(Step* step) {
+  Step::Status process_status = Step::Status::OK;
+  try {
+    StepTracer::Scope trace(tracer_.get(), step->name(), "precheck");
+    process_status = step->precheck();
+  } catch (const std::exception& err) {
+    LOG(ERROR) << "Exception occurred in precheck(): " << err.what()
+               << " in step: " << step->name();
+    process_status = Step::Status::ERROR;
+  }
+  try {
+    if (process_status == Step::Status::OK) {
+      StepTracer::Scope trace(tracer_.get(), step->name(), "process");
+      process_status = step->process();
     }
-    try {
-      if (process_status == Step::Status::OK) {
-        process_status = (*it)->process();
-      }
-    } catch (const std::exception& err) {
-      LOG(ERROR) << "Exception occurred in process(): " << err.what()
-                 << " in step: " << (*it)->name();
-      process_status = Step::Status::ERROR;
+  } catch (const std::exception& err) {
+    LOG(ERROR) << "Exception occurred in process(): " << err.what()
+               << " in step: " << step->name();
+    process_status = Step::Status::ERROR;
+  }
+  return process_status;
+}
+
+void AppInstaller::SendProgress(unsigned current_step, unsigned total_steps) {
+  if (!pi_)
+    return;
+  std::lock_guard<std::mutex> lock(signal_mutex_);
+
+  // send START signal as soon as possible if not sent
+  if (pi_->state() == PkgmgrSignal::State::NOT_SENT) {
+    if (!context_->pkgid.get().empty()) {
+      pi_->SendStarted(context_->pkg_type.get(), context_->pkgid.get());
     }
+  }
 
+  // send installation progress
+  pi_->SendProgress(
+      current_step * kProgressRange / total_steps,
+      context_->pkg_type.get(), context_->pkgid.get());
+}
+
+Step::Status AppInstaller::ProcessSequential(std::vector<Step*>* processed) {
+  unsigned total_steps = steps_.size();
+  unsigned current_step = 1;
+  for (auto& step : steps_) {
+    processed->push_back(step.get());
+    Step::Status process_status = RunStep(step.get());
     if (process_status != Step::Status::OK) {
       LOG(ERROR) << "Error during processing";
-      ret = Result::ERROR;
-      break;
+      LOG(ERROR) << "Failure occurs in step: " << step->name();
+      return process_status;
     }
+    SendProgress(current_step++, total_steps);
+  }
+  return Step::Status::OK;
+}
 
-    if (pi_) {
-      // send START signal as soon as possible if not sent
-      if (pi_->state() == PkgmgrSignal::State::NOT_SENT) {
-        if (!context_->pkgid.get().empty()) {
-          pi_->SendStarted(context_->pkg_type.get(), context_->pkgid.get());
-        }
+Step::Status AppInstaller::ProcessParallel(std::vector<Step*>* processed) {
+  std::vector<Step*> steps;
+  for (auto& step : steps_)
+    steps.push_back(step.get());
+
+  // build graph: step depends on every preceding step it conflicts with.
+  // Steps writing pkgid are barriers because it is read here to send
+  // pkgmgr signals.
+  std::vector<StepDependencies> dependencies(steps.size());
+  std::vector<bool> barrier(steps.size());
+  for (size_t i = 0; i < steps.size(); ++i) {
+    barrier[i] = !steps[i]->GetDependencies(&dependencies[i]) ||
+        dependencies[i].IsWriting(context_->pkgid);
+  }
+  std::vector<std::vector<size_t>> dependents(steps.size());
+  std::vector<unsigned> pending(steps.size(), 0);
+  for (size_t i = 0; i < steps.size(); ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (barrier[i] || barrier[j] ||
+          dependencies[i].ConflictsWith(dependencies[j])) {
+        dependents[j].push_back(i);
+        ++pending[i];
       }
+    }
+  }
+
+  // steps are started in list order whenever their dependencies are done
+  std::set<size_t> ready;
+  for (size_t i = 0; i < steps.size(); ++i)
+    if (pending[i] == 0)
+      ready.insert(i);
 
-      // send installation progress
-      pi_->SendProgress(
-          current_step * kProgressRange / total_steps,
-          context_->pkg_type.get(), context_->pkgid.get());
+  std::mutex mutex;
+  std::condition_variable step_finished;
+  std::deque<std::pair<size_t, Step::Status>> finished;
+  unsigned running = 0;
+  unsigned current_step = 1;
+  Step::Status process_status = Step::Status::OK;
+
+  ThreadPool pool(parallel_threads_);
+  while (true) {
+    while (process_status == Step::Status::OK && !ready.empty()) {
+      size_t index = *ready.begin();
+      ready.erase(ready.begin());
+      ++running;
+      pool.Submit([this, index, &steps, &mutex, &finished, &step_finished] {
+        Step::Status status = RunStep(steps[index]);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          finished.emplace_back(index, status);
+        }
+        step_finished.notify_one();
+      });
+    }
+    if (running == 0)
+      break;
+
+    std::deque<std::pair<size_t, Step::Status>> results;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      step_finished.wait(lock, [&finished] { return !finished.empty(); });
+      results.swap(finished);
+    }
+    for (auto& result : results) {
+      --running;
+      Step* step = steps[result.first];
+      processed->push_back(step);
+      if (result.second != Step::Status::OK) {
+        LOG(ERROR) << "Error during processing";
+        LOG(ERROR) << "Failure occurs in step: " << step->name();
+        // undo of first failure is reported, running steps are awaited
+        if (process_status == Step::Status::OK)
+          process_status = result.second;
+        continue;
+      }
+      if (process_status != Step::Status::OK)
+        continue;
+      SendProgress(current_step++, steps.size());
+      for (size_t dependent : dependents[result.first])
+        if (--pending[dependent] == 0)
+          ready.insert(dependent);
     }
   }
+  return process_status;
+}
+
+AppInstaller::Result AppInstaller::Run() {
+  // steps in order of completion, including failed ones
+  std::vector<Step*> processed;
+  Step::Status process_status = (parallel_threads_ > 1) ?
+      ProcessParallel(&processed) : ProcessSequential(&processed);
+  Result ret = Result::OK;
 
-  if (it != itEnd) {
-    LOG(ERROR) << "Failure occurs in step: " << (*it)->name();
-    do {
+  if (process_status != Step::Status::OK) {
+    ret = Result::ERROR;
+    for (auto it = processed.rbegin(); it != processed.rend(); ++it) {
       try {
+        StepTracer::Scope trace(tracer_.get(), (*it)->name(), "undo");
         if ((*it)->undo() != Step::Status::OK) {
           LOG(ERROR) << "Error during undo operation(" << (*it)->name()
                      << "), but continuing...";
@@ -99,10 +247,11 @@ AppInstaller::Result AppInstaller::Run() {
                    << " in step: " << (*it)->name();
         ret = Result::UNDO_ERROR;
       }
-    } while (it-- != itStart);
+    }
   } else {
     for (auto& step : steps_) {
       try {
+        StepTracer::Scope trace(tracer_.get(), step->name(), "clean");
         if (step->clean() != Step::Status::OK) {
           LOG(ERROR) << "Error during clean operation(" << step->name() << ")";
           ret = Result::CLEANUP_ERROR;
@@ -116,7 +265,22 @@ AppInstaller::Result AppInstaller::Run() {
       }
     }
   }
-  sync();
+  {
+    StepTracer::Scope trace(tracer_.get(), "AppInstaller", "sync");
+    if (full_sync_) {
+      sync();
+    } else {
+      // package content is registered by steps writing it (unpacking,
+      // copying, patching), platform manifest is written by backends
+      if (!context_->xml_path.get().empty())
+        RegisterWrittenFile(context_->xml_path.get());
+      if (!SyncWrittenFiles()) {
+        LOG(WARNING) << "Failed to flush some of written files, "
+                     << "falling back to sync()";
+        sync();
+      }
+    }
+  }
 
   if (pi_) {
     // send START if pkgid was not parsed
@@ -128,6 +292,9 @@ AppInstaller::Result AppInstaller::Run() {
                       context_->pkgid.get());
   }
 
+  // trees moved to trash by steps are removed after request is finished
+  StartTrashReaper(context_->root_application_path.get());
+
   if (context_->installation_mode.get() == InstallationMode::OFFLINE &&
       context_->is_preload_request.get() &&
       process_status != Step::Status::OK) {
@@ -137,11 +304,15 @@ AppInstaller::Result AppInstaller::Run() {
     info_file.close();
   }
 
+  if (tracer_)
+    tracer_->Write(context_->pkgid.get());
+
   return ret;
 }
 
 void AppInstaller::HandleStepError(Step::Status result,
                                         const std::string& error) {
+  std::lock_guard<std::mutex> lock(signal_mutex_);
   if (pi_)
     pi_->SendError(result, error, context_->pkg_type.get(),
                    context_->pkgid.get());
@@ -10,12 +10,15 @@
 #include <boost/bind.hpp>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "common/pkgmgr_interface.h"
 #include "common/pkgmgr_signal.h"
 #include "common/step/step.h"
 #include "common/utils/macros.h"
+#include "common/utils/step_tracer.h"
 
 namespace common_installer {
 
@@ -74,6 +77,35 @@ class AppInstaller {
    */
   Result Run();
 
+  /**
+   * \brief Enables export of per-step timing trace. Tracing can be also
+   *        enabled by setting StepTracer::kTraceEnvironmentVariable.
+   *
+   * \param output path of Chrome trace JSON file written at end of Run()
+   */
+  void EnableStepTracing(const boost::filesystem::path& output);
+
+  /**
+   * \brief Enables concurrent execution of steps. Steps are scheduled
+   *        according to dependencies they declare (Step::GetDependencies())
+   *        and undone in reverse order of completion. Can be also enabled
+   *        by APP_INSTALLERS_PARALLEL_STEPS environment variable.
+   *
+   * \param threads number of worker threads, value less than 2 disables
+   *                concurrent execution
+   */
+  void EnableParallelSteps(unsigned threads);
+
+  /**
+   * \brief By default only files written during request are flushed to
+   *        storage at the end of Run(). Full sync flushes all filesystems
+   *        with sync() instead. Can be also enabled by setting
+   *        APP_INSTALLERS_FULL_SYNC=1 environment variable.
+   *
+   * \param full_sync true to use sync()
+   */
+  void EnableFullSync(bool full_sync);
+
  protected:
   PkgMgrPtr pkgmgr_;
   std::unique_ptr<InstallerContext> context_;
@@ -84,6 +116,17 @@ class AppInstaller {
   // data used to send signal
   std::unique_ptr<PkgmgrSignal> pi_;
 
+  // null if step tracing is disabled
+  std::unique_ptr<StepTracer> tracer_;
+
+  unsigned parallel_threads_;
+  bool full_sync_;
+  std::mutex signal_mutex_;
+
+  Step::Status RunStep(Step* step);
+  Step::Status ProcessSequential(std::vector<Step*>* processed);
+  Step::Status ProcessParallel(std::vector<Step*>* processed);
+  void SendProgress(unsigned current_step, unsigned total_steps);
   void HandleStepError(Step::Status result, const std::string& error);
 
   SCOPE_LOG_TAG(AppInstaller)
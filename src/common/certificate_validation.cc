@@ -5,12 +5,19 @@
 #include "common/certificate_validation.h"
 
 #include <boost/format.hpp>
+#include <libxml2/libxml/parser.h>
+#include <libxml2/libxml/tree.h>
 #include <vcore/SignatureValidator.h>
 
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <regex>
+#include <set>
+#include <vector>
 
 #include "common/utils/base64.h"
+#include "common/utils/file_util.h"
 
 namespace bf = boost::filesystem;
 namespace ci = common_installer;
@@ -20,6 +27,22 @@ namespace {
 const char kSignatureAuthor[] = "author-signature.xml";
 const char kRegexDistributorSignature[] = "^(signature)([1-9][0-9]*)(\\.xml)";
 
+const char kXmlDsigNamespace[] = "http://www.w3.org/2000/09/xmldsig#";
+const char kDigestMethodSha256[] = "http://www.w3.org/2001/04/xmlenc#sha256";
+const char kDigestMethodSha512[] = "http://www.w3.org/2001/04/xmlenc#sha512";
+
+enum class ReferenceCheck {
+  OK,
+  INVALID,
+  UNSUPPORTED  // digests cannot be checked with table
+};
+
+struct SignatureReference {
+  std::string uri;
+  std::string algorithm;
+  std::string digest_value;
+  bool has_transforms;
+};
 
 bool SetAuthorCertificate(ValidationCore::SignatureData data,
     common_installer::CertificateInfo* cert_info) {
@@ -87,6 +110,157 @@ bool SetDistributor2Certificate(ValidationCore::SignatureData data,
   return true;
 }
 
+bool IsDsigElement(xmlNodePtr node, const char* name) {
+  return node->type == XML_ELEMENT_NODE && node->ns &&
+      xmlStrEqual(node->ns->href, BAD_CAST kXmlDsigNamespace) &&
+      xmlStrEqual(node->name, BAD_CAST name);
+}
+
+xmlNodePtr FindDsigChild(xmlNodePtr parent, const char* name) {
+  for (xmlNodePtr child = parent->children; child; child = child->next)
+    if (IsDsigElement(child, name))
+      return child;
+  return nullptr;
+}
+
+std::string GetNodeContent(xmlNodePtr node) {
+  xmlChar* content = xmlNodeGetContent(node);
+  if (!content)
+    return std::string();
+  std::string result(reinterpret_cast<char*>(content));
+  xmlFree(content);
+  return result;
+}
+
+bool ReadSignatureReferences(const bf::path& signature_path,
+                             std::vector<SignatureReference>* references) {
+  xmlDocPtr doc = xmlReadFile(signature_path.c_str(), nullptr, XML_PARSE_NONET);
+  if (!doc) {
+    LOG(ERROR) << "Failed to parse signature: " << signature_path;
+    return false;
+  }
+  xmlNodePtr root = xmlDocGetRootElement(doc);
+  xmlNodePtr signed_info = nullptr;
+  if (root && IsDsigElement(root, "Signature"))
+    signed_info = FindDsigChild(root, "SignedInfo");
+  if (!signed_info) {
+    LOG(ERROR) << "No SignedInfo in signature: " << signature_path;
+    xmlFreeDoc(doc);
+    return false;
+  }
+  for (xmlNodePtr node = signed_info->children; node; node = node->next) {
+    if (!IsDsigElement(node, "Reference"))
+      continue;
+    SignatureReference reference;
+    xmlChar* uri = xmlGetProp(node, BAD_CAST "URI");
+    if (uri) {
+      reference.uri = reinterpret_cast<char*>(uri);
+      xmlFree(uri);
+    }
+    xmlNodePtr method = FindDsigChild(node, "DigestMethod");
+    if (method) {
+      xmlChar* algorithm = xmlGetProp(method, BAD_CAST "Algorithm");
+      if (algorithm) {
+        reference.algorithm = reinterpret_cast<char*>(algorithm);
+        xmlFree(algorithm);
+      }
+    }
+    xmlNodePtr value = FindDsigChild(node, "DigestValue");
+    if (value)
+      reference.digest_value = GetNodeContent(value);
+    reference.has_transforms = FindDsigChild(node, "Transforms") != nullptr;
+    references->push_back(std::move(reference));
+  }
+  xmlFreeDoc(doc);
+  return true;
+}
+
+std::string DecodeUri(const std::string& uri) {
+  std::string result;
+  result.reserve(uri.size());
+  for (size_t i = 0; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size() &&
+        isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+        isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+      result += static_cast<char>(
+          std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 2;
+    } else {
+      result += uri[i];
+    }
+  }
+  return result;
+}
+
+// Compares digests of files referenced by signature with digests calculated
+// during extraction. Files missing in table are read from disk. Every file
+// in table except signature files must be referenced, as cert-svc requires.
+ReferenceCheck CheckReferenceDigests(const bf::path& base_path,
+    const ValidationCore::SignatureFileInfo& file_info,
+    const ci::DigestTable& digests) {
+  bf::path signature_path(file_info.getFileName());
+  if (signature_path.is_relative())
+    signature_path = base_path / signature_path;
+  std::vector<SignatureReference> references;
+  if (!ReadSignatureReferences(signature_path, &references))
+    return ReferenceCheck::INVALID;
+
+  std::set<std::string> referenced;
+  for (auto& reference : references) {
+    // same-document references are checked by cert-svc
+    if (reference.uri.empty() || reference.uri[0] == '#')
+      continue;
+    if (reference.has_transforms)
+      return ReferenceCheck::UNSUPPORTED;
+    unsigned algorithm;
+    if (reference.algorithm == kDigestMethodSha256)
+      algorithm = ci::DIGEST_SHA256;
+    else if (reference.algorithm == kDigestMethodSha512)
+      algorithm = ci::DIGEST_SHA512;
+    else
+      return ReferenceCheck::UNSUPPORTED;
+
+    std::string path = DecodeUri(reference.uri);
+    std::string expected;
+    if (ci::HasDirectoryClimbing(path) ||
+        !ci::DecodeBase64(reference.digest_value, &expected)) {
+      LOG(ERROR) << "Malformed reference: " << reference.uri;
+      return ReferenceCheck::INVALID;
+    }
+
+    ci::FileDigests file_digests;
+    auto iter = digests.find(path);
+    if (iter != digests.end())
+      file_digests = iter->second;
+    const std::string& actual = (algorithm == ci::DIGEST_SHA256) ?
+        file_digests.sha256 : file_digests.sha512;
+    if (actual.empty() &&
+        !ci::CalculateFileDigests(base_path / path, algorithm,
+                                  &file_digests)) {
+      LOG(ERROR) << "Referenced file is missing: " << path;
+      return ReferenceCheck::INVALID;
+    }
+    if (actual != expected) {
+      LOG(ERROR) << "Digest mismatch of file: " << path;
+      return ReferenceCheck::INVALID;
+    }
+    referenced.insert(path);
+  }
+
+  std::regex distributor_regex(kRegexDistributorSignature);
+  bool is_author = signature_path.filename() == kSignatureAuthor;
+  for (auto& item : digests) {
+    if (referenced.count(item.first))
+      continue;
+    if (std::regex_search(item.first, distributor_regex) ||
+        (is_author && item.first == kSignatureAuthor))
+      continue;
+    LOG(ERROR) << "File not referenced by signature: " << item.first;
+    return ReferenceCheck::INVALID;
+  }
+  return ReferenceCheck::OK;
+}
+
 }  // namespace
 
 namespace common_installer {
@@ -190,7 +364,8 @@ bool CheckDistSignature(const ValidationCore::SignatureFileInfo& file_info) {
 
 bool ValidateSignatures(const bf::path& base_path,
     PrivilegeLevel* level, common_installer::CertificateInfo* cert_info,
-    bool check_reference, bool is_preload, std::string* error_message) {
+    bool check_reference, bool is_preload, std::string* error_message,
+    const DigestTable* digests) {
   // Find signature files
   ValidationCore::SignatureFileInfoSet signature_files;
   ValidationCore::SignatureFinder signature_finder(base_path.string());
@@ -215,11 +390,62 @@ bool ValidateSignatures(const bf::path& base_path,
   // Read xml schema for signatures
   for (auto& file_info : signature_files) {
     std::string error;
-    if (!ValidateSignatureFile(base_path, file_info, level,
-                               cert_info, check_reference, &error)) {
+    // file references are checked below against digest table if available
+    if (!ValidateSignatureFile(base_path, file_info, level, cert_info,
+                               check_reference && !digests, &error)) {
       *error_message = error;
       return false;
     }
+    if (!check_reference || !digests)
+      continue;
+    switch (CheckReferenceDigests(base_path, file_info, *digests)) {
+      case ReferenceCheck::OK:
+        break;
+      case ReferenceCheck::INVALID:
+        *error_message = "Invalid reference in signature file";
+        return false;
+      case ReferenceCheck::UNSUPPORTED:
+        if (!ValidateSignatureFile(base_path, file_info, level, cert_info,
+                                   true, &error)) {
+          *error_message = error;
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+bool ValidateSignatureReferences(const bf::path& base_path,
+    bool is_preload, std::string* error_message,
+    const DigestTable* digests) {
+  // certificates were already checked, results are discarded
+  PrivilegeLevel level = PrivilegeLevel::UNTRUSTED;
+  CertificateInfo cert_info;
+  if (!digests)
+    return ValidateSignatures(base_path, &level, &cert_info, true,
+                              is_preload, error_message);
+
+  ValidationCore::SignatureFileInfoSet signature_files;
+  ValidationCore::SignatureFinder signature_finder(base_path.string());
+  if (signature_finder.find(signature_files) !=
+      ValidationCore::SignatureFinder::NO_ERROR) {
+    LOG(ERROR) << "Error while searching for signatures";
+    return false;
+  }
+  for (auto& file_info : signature_files) {
+    switch (CheckReferenceDigests(base_path, file_info, *digests)) {
+      case ReferenceCheck::OK:
+        break;
+      case ReferenceCheck::INVALID:
+        *error_message = "Invalid reference in signature file";
+        return false;
+      case ReferenceCheck::UNSUPPORTED:
+        if (!ValidateSignatureFile(base_path, file_info, &level, &cert_info,
+                                   true, error_message))
+          return false;
+        break;
+    }
   }
   return true;
 }
@@ -13,6 +13,7 @@
 #include <string>
 
 #include "common/installer_context.h"
+#include "common/utils/file_digests.h"
 
 namespace common_installer {
 
@@ -32,9 +33,41 @@ bool ValidateSignatureFile(
     common_installer::CertificateInfo* cert_info,
     bool check_reference, std::string* error_message);
 
+/**
+ * \brief Validates all signature files of package
+ *
+ * \param base_path directory containing signature files and package content
+ * \param level privilege level read from distributor signature
+ * \param cert_info certificates read from signatures
+ * \param check_reference true if digests of referenced files are checked
+ * \param is_preload true if package is preloaded
+ * \param error_message error message
+ * \param digests if given, referenced files are checked against these
+ *                digests instead of being read again from base_path
+ *
+ * \return true if signatures are valid
+ */
 bool ValidateSignatures(const boost::filesystem::path& base_path,
     PrivilegeLevel* level, common_installer::CertificateInfo* cert_info,
-    bool check_reference, bool is_preload, std::string* error_message);
+    bool check_reference, bool is_preload, std::string* error_message,
+    const DigestTable* digests = nullptr);
+
+/**
+ * \brief Checks only digests of files referenced by signatures. Used when
+ *        signatures were validated with check_reference set to false
+ *        before all referenced files were available.
+ *
+ * \param base_path directory containing signature files and package content
+ * \param is_preload true if package is preloaded
+ * \param error_message error message
+ * \param digests if given, referenced files are checked against these
+ *                digests instead of being read again from base_path
+ *
+ * \return true if all references are correct
+ */
+bool ValidateSignatureReferences(const boost::filesystem::path& base_path,
+    bool is_preload, std::string* error_message,
+    const DigestTable* digests = nullptr);
 
 bool ValidatePrivilegeLevel(common_installer::PrivilegeLevel level,
     bool is_webapp, const char* api_version, GList* privileges,
@@ -33,6 +33,9 @@ const char* PrivilegeLevelToString(PrivilegeLevel level) {
 InstallerContext::InstallerContext()
     : manifest_data(nullptr),
       old_manifest_data(nullptr),
+      partially_unpacked(false),
+      unpacked_to_staging_dir(false),
+      signature_references_deferred(false),
       uid(getuid()),
       backend_data(nullptr),
       privilege_level(PrivilegeLevel::UNTRUSTED),
@@ -24,6 +24,7 @@
 #include "common/pkgmgr_interface.h"
 #include "common/recovery_file.h"
 #include "common/request.h"
+#include "common/utils/file_digests.h"
 #include "common/utils/property.h"
 
 #include "manifest_info/account.h"
@@ -247,6 +248,33 @@ class InstallerContext {
    */
   Property<boost::filesystem::path> unpacked_dir_path;
 
+  /**
+   * \brief true if only package metadata (manifest and signature files) is
+   *        present in unpacked_dir_path and the rest of package content is
+   *        still to be extracted
+   */
+  Property<bool> partially_unpacked;
+
+  /**
+   * \brief true if unpacked_dir_path is hidden staging directory on the same
+   *        filesystem as root_application_path, so it can become package
+   *        directory by single rename
+   */
+  Property<bool> unpacked_to_staging_dir;
+
+  /**
+   * \brief true if signature files were validated without checking their
+   *        references, which must be checked once package is fully unpacked
+   */
+  Property<bool> signature_references_deferred;
+
+  /**
+   * \brief digests of unpacked files calculated during extraction, keyed by
+   *        path relative to unpacked_dir_path. Used to check signature
+   *        references without reading files again.
+   */
+  Property<DigestTable> file_digests;
+
   /**
    * \brief uid of user which installation was triggered for
    *        (any normal or globaltizenapp)
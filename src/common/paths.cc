@@ -14,6 +14,7 @@ namespace {
 const int32_t kPWBufSize = sysconf(_SC_GETPW_R_SIZE_MAX);
 const char kImageDir[] = ".image";
 const char kBckExtension[] = ".bck";
+const char kStagingExtension[] = ".new";
 const char kExternalStorageDirPrefix[] = "SDCardA1";
 
 boost::filesystem::path GetBackupPath(
@@ -42,6 +43,13 @@ boost::filesystem::path GetBackupPathForPackagePath(
   return GetBackupPath(pkg_path);
 }
 
+boost::filesystem::path GetStagingPathForPackagePath(
+    const boost::filesystem::path& pkg_path) {
+  bf::path staging_path = pkg_path;
+  staging_path += kStagingExtension;
+  return staging_path;
+}
+
 boost::filesystem::path GetBackupPathForManifestFile(
     const boost::filesystem::path& manfest_path) {
   return GetBackupPath(manfest_path);
@@ -25,6 +25,17 @@ namespace common_installer {
 boost::filesystem::path GetBackupPathForPackagePath(
     const boost::filesystem::path& pkg_path);
 
+/**
+ * \brief Helper function for getting path where new content of package is
+ *        staged before it replaces old one during update (used for recovery)
+ *
+ * \param pkg_path package path
+ *
+ * \return staging path
+ */
+boost::filesystem::path GetStagingPathForPackagePath(
+    const boost::filesystem::path& pkg_path);
+
 /**
  * \brief Helper function for getting backup path (used for recovery)
  *        based on manifest file path
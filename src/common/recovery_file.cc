@@ -4,17 +4,21 @@
 
 #include "common/recovery_file.h"
 
+#include <unistd.h>
+
 #include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
 
 #include <manifest_parser/utils/logging.h>
 
 #include <array>
+#include <cerrno>
 #include <cstring>
 #include <map>
 #include <utility>
 
 #include "common/installer_context.h"
+#include "common/utils/sync_registry.h"
 
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
@@ -29,6 +33,9 @@ const char kRecoveryRdsString[] = "RDS";
 const char kRecoveryDeltaString[] = "DELTA";
 const char kRecoveryUnknownString[] = "UNKNOWN";
 
+const char kBackupPhaseExchangeString[] = "EXCHANGE";
+const char kBackupPhaseExchangedString[] = "EXCHANGED";
+
 const std::map<std::string, ci::RequestType> kStringToRequestMap = {
   {kRecoveryNewInstallationString, ci::RequestType::Install},
   {kRecoveryUpdateInstallationString, ci::RequestType::Update},
@@ -78,7 +85,9 @@ std::unique_ptr<RecoveryFile> RecoveryFile::OpenRecoveryFileForPath(
 }
 
 RecoveryFile::RecoveryFile(const bf::path& path, bool load)
-    : path_(path) {
+    : type_(RequestType::Unknown),
+      backup_phase_(BackupPhase::None),
+      path_(path) {
   if (load) {
     if (!ReadFileContent()) {
       path_.clear();
@@ -125,6 +134,14 @@ void RecoveryFile::set_type(RequestType type) {
   type_ = type;
 }
 
+void RecoveryFile::set_backup_phase(BackupPhase phase) {
+  backup_phase_ = phase;
+}
+
+void RecoveryFile::set_backup_content(std::string content) {
+  backup_content_ = std::move(content);
+}
+
 const boost::filesystem::path& RecoveryFile::unpacked_dir() const {
   return unpacked_dir_;
 }
@@ -137,6 +154,14 @@ RequestType RecoveryFile::type() const {
   return type_;
 }
 
+BackupPhase RecoveryFile::backup_phase() const {
+  return backup_phase_;
+}
+
+const std::string& RecoveryFile::backup_content() const {
+  return backup_content_;
+}
+
 bool RecoveryFile::ReadFileContent() {
   FILE* handle = fopen(path_.c_str(), "r");
   if (!handle) {
@@ -168,6 +193,20 @@ bool RecoveryFile::ReadFileContent() {
     return true;
   }
   pkgid_ = TruncateNewLine(data.data());
+  if (!fgets(data.data(), data.size(), handle)) {
+    fclose(handle);
+    return true;
+  }
+  std::string phase(TruncateNewLine(data.data()));
+  if (phase == kBackupPhaseExchangeString)
+    backup_phase_ = BackupPhase::Exchange;
+  else if (phase == kBackupPhaseExchangedString)
+    backup_phase_ = BackupPhase::Exchanged;
+  if (!fgets(data.data(), data.size(), handle)) {
+    fclose(handle);
+    return true;
+  }
+  backup_content_ = TruncateNewLine(data.data());
   fclose(handle);
   return true;
 }
@@ -203,7 +242,22 @@ bool RecoveryFile::WriteAndCommitFileContent() {
   fputs("\n", handle);
   fputs(pkgid_.c_str(), handle);
   fputs("\n", handle);
+  if (backup_phase_ != BackupPhase::None) {
+    fputs(backup_phase_ == BackupPhase::Exchange ?
+        kBackupPhaseExchangeString : kBackupPhaseExchangedString, handle);
+    fputs("\n", handle);
+    fputs(backup_content_.c_str(), handle);
+    fputs("\n", handle);
+  }
+  // backup phase must be on disk before directories it describes are
+  // renamed
+  if (fflush(handle) != 0 || fsync(fileno(handle)) != 0) {
+    LOG(ERROR) << "Cannot flush recovery file, errno: " << errno;
+    fclose(handle);
+    return false;
+  }
   fclose(handle);
+  RegisterWrittenFile(path_);
   return true;
 }
 
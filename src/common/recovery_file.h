@@ -16,6 +16,21 @@ namespace common_installer {
 
 namespace recovery {
 
+/**
+ * Progress of exchange of package directory with its new content, tells
+ * where old package content may be found after crash.
+ */
+enum class BackupPhase {
+  // old content is at package path or backup path
+  None,
+  // old content is at package path or staging path, as directories are
+  // being exchanged
+  Exchange,
+  // old content is at staging path, backup path or package path, as it is
+  // being moved to backup path or restored by undo
+  Exchanged
+};
+
 /**
  * Responsible for managing recovery file.
  *
@@ -79,6 +94,20 @@ class RecoveryFile {
    */
   void set_type(RequestType type);
 
+  /**
+   * setter for backup phase
+   *
+   * \param phase new backup phase value
+   */
+  void set_backup_phase(BackupPhase phase);
+
+  /**
+   * setter for identity of directory holding old package content
+   *
+   * \param content "device:inode" of directory (see GetPathIdentity())
+   */
+  void set_backup_content(std::string content);
+
   /**
    * getter for unpacked dir
    *
@@ -100,6 +129,20 @@ class RecoveryFile {
    */
   RequestType type() const;
 
+  /**
+   * getter for backup phase
+   *
+   * \return current backup phase
+   */
+  BackupPhase backup_phase() const;
+
+  /**
+   * getter for identity of directory holding old package content
+   *
+   * \return current backup content
+   */
+  const std::string& backup_content() const;
+
   /**
    * Transaction of current RecoveryFile content into recovery file
    *
@@ -115,6 +158,8 @@ class RecoveryFile {
   RequestType type_;
   boost::filesystem::path unpacked_dir_;
   std::string pkgid_;
+  BackupPhase backup_phase_;
+  std::string backup_content_;
 
   boost::filesystem::path path_;
 };
@@ -208,7 +208,7 @@ bool CreateUserDirectories(uid_t user, const std::string& pkgid,
 bool DeleteDirectories(const bf::path& app_dir, const std::string& pkgid) {
   bf::path base_dir = app_dir / pkgid;
   bs::error_code error;
-  bf::remove_all(base_dir, error);
+  ci::RemoveTree(base_dir, &error);
   if (error) {
     LOG(ERROR) << "Failed to delete directory: " << base_dir;
     return false;
@@ -16,6 +16,7 @@
 
 #include "common/paths.h"
 #include "common/utils/file_util.h"
+#include "common/utils/sync_registry.h"
 
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
@@ -42,6 +43,7 @@ Step::Status StepBackupManifest::process() {
     LOG(ERROR) << "Failed to make a copy of xml manifest file";
     return Status::MANIFEST_ERROR;
   }
+  RegisterWrittenFile(context_->backup_xml_path.get());
   LOG(DEBUG) << "Manifest backup created";
   return Status::OK;
 }
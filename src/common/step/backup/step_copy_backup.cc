@@ -4,14 +4,22 @@
 
 #include "common/step/backup/step_copy_backup.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
 
 #include <cassert>
+#include <cerrno>
 #include <string>
 
 #include "common/paths.h"
+#include "common/recovery_file.h"
+#include "common/utils/file_copy.h"
 #include "common/utils/file_util.h"
+#include "common/utils/trash.h"
 
 namespace {
 
@@ -25,6 +33,12 @@ namespace backup {
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
 
+StepCopyBackup::StepCopyBackup(InstallerContext* context)
+    : Step(context),
+      content_staged_(false),
+      content_exchanged_(false) {
+}
+
 Step::Status StepCopyBackup::precheck() {
   if (context_->pkgid.get().empty()) {
     LOG(ERROR) << "pkgid attribute is empty";
@@ -40,11 +54,21 @@ Step::Status StepCopyBackup::precheck() {
       context_->root_application_path.get() / context_->pkgid.get());
   install_path_ = context_->pkg_path.get();
   backup_path_ = GetBackupPathForPackagePath(context_->pkg_path.get());
+  staging_path_ = GetStagingPathForPackagePath(context_->pkg_path.get());
 
   return Status::OK;
 }
 
 Step::Status StepCopyBackup::process() {
+  if (CanExchangeContent()) {
+    if (ExchangeContent())
+      return Status::OK;
+    // new content could not be returned to its place
+    if (content_staged_ || content_exchanged_)
+      return Status::APP_DIR_ERROR;
+    LOG(WARNING) << "Cannot exchange package directory, moving its content";
+  }
+
   if (!Backup())
     return Status::APP_DIR_ERROR;
 
@@ -71,11 +95,33 @@ Step::Status StepCopyBackup::undo() {
   // TODO(t.iwanek): this should be done in StepUnzip
   bs::error_code error;
   LOG(DEBUG) << "Remove tmp dir: " << context_->unpacked_dir_path.get();
-  bf::remove_all(context_->unpacked_dir_path.get(), error);  // ignore error
+  RemoveTree(context_->unpacked_dir_path.get(), &error);  // ignore error
 
   if (context_->external_storage)
     context_->external_storage->Abort();
 
+  if (content_exchanged_) {
+    // old content is at backup path, or still at staging path if it could
+    // not be moved there
+    bf::path old_content =
+        bf::exists(backup_path_) ? backup_path_ : staging_path_;
+    if (!ExchangePaths(install_path_, old_content)) {
+      LOG(ERROR) << "Failed to revert package directory";
+      return Status::APP_DIR_ERROR;
+    }
+    content_exchanged_ = false;
+    MoveToTrash(old_content, context_->root_application_path.get(),
+                &error);
+    SetBackupPhase(recovery::BackupPhase::None);
+    LOG(DEBUG) << "Application files reverted from backup";
+    return Status::OK;
+  }
+  if (content_staged_) {
+    MoveToTrash(staging_path_, context_->root_application_path.get(),
+                &error);
+    content_staged_ = false;
+  }
+
   // if backup was created then restore files
   if (bf::exists(backup_path_)) {
     if (!RollbackApplicationDirectory()) {
@@ -87,6 +133,124 @@ Step::Status StepCopyBackup::undo() {
   return Status::OK;
 }
 
+bool StepCopyBackup::CanExchangeContent() {
+  // mount points inside package directory cannot be moved with it
+  if (context_->external_storage ||
+      bf::exists(install_path_ / kExternalMemoryMountPoint))
+    return false;
+  if (bf::exists(backup_path_) || bf::exists(staging_path_))
+    return false;
+  // unpacked directory must not be mount point itself
+  const bf::path& unpacked = context_->unpacked_dir_path.get();
+  struct stat install_stat;
+  struct stat unpacked_stat;
+  struct stat unpacked_parent_stat;
+  if (lstat(install_path_.c_str(), &install_stat) != 0 ||
+      lstat(unpacked.c_str(), &unpacked_stat) != 0 ||
+      stat(unpacked.parent_path().c_str(), &unpacked_parent_stat) != 0)
+    return false;
+  return S_ISDIR(install_stat.st_mode) && S_ISDIR(unpacked_stat.st_mode) &&
+      install_stat.st_dev == unpacked_stat.st_dev &&
+      unpacked_parent_stat.st_dev == unpacked_stat.st_dev;
+}
+
+bool StepCopyBackup::ExchangeContent() {
+  const bf::path& unpacked = context_->unpacked_dir_path.get();
+  if (!CopyDirectoryAttributes(install_path_, unpacked))
+    return false;
+
+  // new content becomes sibling of package directory and both are swapped
+  // by single atomic exchange, then old content is moved to backup path.
+  // Recovery file records where old content may be before each of these
+  // renames, so that StepRecoverFiles restores it after crash.
+  if (!RenameDir(unpacked, staging_path_))
+    return false;
+  content_staged_ = true;
+  std::string old_content = GetPathIdentity(install_path_);
+  if (old_content.empty() ||
+      !SetBackupPhase(recovery::BackupPhase::Exchange, old_content))
+    return UnstageContent();
+  if (!ExchangePaths(install_path_, staging_path_)) {
+    if (!SetBackupPhase(recovery::BackupPhase::None))
+      return false;
+    return UnstageContent();
+  }
+  content_staged_ = false;
+  content_exchanged_ = true;
+  if (!SetBackupPhase(recovery::BackupPhase::Exchanged, old_content)) {
+    // old content cannot be moved away while recovery file points at it
+    if (!ExchangePaths(install_path_, staging_path_))
+      return false;
+    content_exchanged_ = false;
+    content_staged_ = true;
+    if (!SetBackupPhase(recovery::BackupPhase::None))
+      return false;
+    return UnstageContent();
+  }
+  if (!RenameDir(staging_path_, backup_path_))
+    return false;
+  LOG(INFO) << "Old package content exchanged with new one, saved to: "
+            << backup_path_;
+  return true;
+}
+
+bool StepCopyBackup::CopyDirectoryAttributes(const bf::path& from,
+                                             const bf::path& to) {
+  // package directory keeps its owner, mode and security labels, like when
+  // content was moved into it
+  struct stat info;
+  if (stat(from.c_str(), &info) != 0 ||
+      chown(to.c_str(), info.st_uid, info.st_gid) != 0 ||
+      chmod(to.c_str(), info.st_mode & 07777) != 0) {
+    LOG(ERROR) << "Cannot copy attributes of " << from << " to " << to
+               << ", errno: " << errno;
+    return false;
+  }
+  int from_fd = open(from.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (from_fd < 0) {
+    LOG(ERROR) << "Cannot open " << from << ", errno: " << errno;
+    return false;
+  }
+  int to_fd = open(to.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (to_fd < 0) {
+    LOG(ERROR) << "Cannot open " << to << ", errno: " << errno;
+    close(from_fd);
+    return false;
+  }
+  bool result = CopyExtendedAttributes(from_fd, to_fd);
+  if (!result)
+    LOG(ERROR) << "Cannot copy extended attributes of " << from << " to "
+               << to << ", errno: " << errno;
+  close(to_fd);
+  close(from_fd);
+  return result;
+}
+
+bool StepCopyBackup::SetBackupPhase(recovery::BackupPhase phase,
+                                    const std::string& old_content) {
+  recovery::RecoveryFile* recovery_file =
+      context_->recovery_info.get().recovery_file.get();
+  if (!recovery_file)
+    return true;
+  recovery_file->set_backup_phase(phase);
+  recovery_file->set_backup_content(old_content);
+  if (!recovery_file->WriteAndCommitFileContent()) {
+    LOG(ERROR) << "Cannot record backup phase in recovery file";
+    return false;
+  }
+  return true;
+}
+
+bool StepCopyBackup::UnstageContent() {
+  if (!RenameDir(staging_path_, context_->unpacked_dir_path.get())) {
+    LOG(ERROR) << "Cannot move staged content back to "
+               << context_->unpacked_dir_path.get();
+    return false;
+  }
+  content_staged_ = false;
+  return false;
+}
+
 bool StepCopyBackup::Backup() {
   // create backup directory
   bs::error_code error;
@@ -184,7 +348,8 @@ bool StepCopyBackup::NewContent() {
 bool StepCopyBackup::CleanBackupDirectory() {
   if (bf::exists(backup_path_)) {
     bs::error_code error;
-    bf::remove_all(backup_path_, error);
+    MoveToTrash(backup_path_, context_->root_application_path.get(),
+                &error);
     if (error)
       return false;
   }
@@ -194,7 +359,7 @@ bool StepCopyBackup::CleanBackupDirectory() {
 bool StepCopyBackup::RollbackApplicationDirectory() {
   bs::error_code error;
   if (bf::exists(context_->pkg_path.get())) {
-    bf::remove_all(context_->pkg_path.get(), error);
+    RemoveTree(context_->pkg_path.get(), &error);
     if (error) {
       return false;
     }
@@ -9,7 +9,10 @@
 
 #include <manifest_parser/utils/logging.h>
 
+#include <string>
+
 #include "common/installer_context.h"
+#include "common/recovery_file.h"
 #include "common/step/step.h"
 
 namespace common_installer {
@@ -22,7 +25,7 @@ namespace backup {
  */
 class StepCopyBackup : public Step {
  public:
-  using Step::Step;
+  explicit StepCopyBackup(InstallerContext* context);
 
   /**
    * \brief main logic of creating backup and copying new content
@@ -53,6 +56,13 @@ class StepCopyBackup : public Step {
   Status precheck() override;
 
  private:
+  bool CanExchangeContent();
+  bool ExchangeContent();
+  bool CopyDirectoryAttributes(const boost::filesystem::path& from,
+                               const boost::filesystem::path& to);
+  bool SetBackupPhase(recovery::BackupPhase phase,
+                      const std::string& old_content = std::string());
+  bool UnstageContent();
   bool Backup();
   bool NewContent();
   bool CleanBackupDirectory();
@@ -62,6 +72,12 @@ class StepCopyBackup : public Step {
 
   boost::filesystem::path install_path_;
   boost::filesystem::path backup_path_;
+  boost::filesystem::path staging_path_;
+  // new content was renamed to staging path, before exchange
+  bool content_staged_;
+  // package directory was exchanged with staged content, old content is
+  // at backup path or at staging path if it was not moved yet
+  bool content_exchanged_;
 
   STEP_NAME(CopyBackup)
 };
@@ -8,6 +8,8 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/system/error_code.hpp>
 
+#include "common/utils/trash.h"
+
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
 
@@ -36,7 +38,7 @@ Step::Status StepClearData::process() {
   for (auto iter = bf::directory_iterator(data_directory);
       iter != bf::directory_iterator(); ++iter) {
     bs::error_code error;
-    bf::remove_all(iter->path(), error);
+    MoveToTrash(iter->path(), context_->root_application_path.get(), &error);
     if (error) {
       LOG(ERROR) << "Failed to remove: " << iter->path();
       status = Status::APP_DIR_ERROR;
@@ -67,8 +67,17 @@ Step::Status StepCopy::process() {
                << install_path.parent_path().string();
     return Step::Status::APP_DIR_ERROR;
   }
-  if (!MoveDir(context_->unpacked_dir_path.get(), install_path,
-               FSFlag::FS_MERGE_DIRECTORIES)) {
+  // external storage mounts its directories inside install path, so content
+  // has to be merged into it
+  if (context_->unpacked_to_staging_dir.get() &&
+      !context_->external_storage) {
+    if (!RenameDir(context_->unpacked_dir_path.get(), install_path)) {
+      LOG(ERROR) << "Cannot rename staging directory to install path, from "
+          << context_->unpacked_dir_path.get() << " to " << install_path;
+      return Status::APP_DIR_ERROR;
+    }
+  } else if (!MoveDir(context_->unpacked_dir_path.get(), install_path,
+                      FSFlag::FS_MERGE_DIRECTORIES)) {
     LOG(ERROR) << "Cannot move widget directory to install path, from "
         << context_->unpacked_dir_path.get() << " to " << install_path;
     return Status::APP_DIR_ERROR;
@@ -89,7 +98,7 @@ Step::Status StepCopy::undo() {
     context_->external_storage->Abort();
 
   if (bf::exists(context_->pkg_path.get()))
-    bf::remove_all(context_->pkg_path.get());
+    RemoveTree(context_->pkg_path.get());
   return Status::OK;
 }
 
@@ -89,7 +89,7 @@ Step::Status StepCopyTep::process() {
 Step::Status StepCopyTep::undo() {
   bs::error_code error;
   if (bf::exists(context_->tep_path.get())) {
-    bf::remove_all(context_->tep_path.get(), error);
+    RemoveTree(context_->tep_path.get(), &error);
   }
 
   // remove tep file is installed outside package path
@@ -98,7 +98,7 @@ Step::Status StepCopyTep::undo() {
                                            context_->uid.get());
     tep_path /= context_->tep_path.get().filename();
     if (bf::exists(tep_path)) {
-      bf::remove_all(tep_path, error);
+      RemoveTree(tep_path, &error);
     }
   }
   return Status::OK;
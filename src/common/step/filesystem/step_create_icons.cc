@@ -9,6 +9,8 @@
 #include <pkgmgr-info.h>
 
 #include "common/utils/glist_range.h"
+#include "common/utils/sync_registry.h"
+#include "common/utils/file_util.h"
 
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
@@ -16,10 +18,21 @@ namespace bs = boost::system;
 namespace common_installer {
 namespace filesystem {
 
+bool StepCreateIcons::GetDependencies(StepDependencies* dependencies) const {
+  if (!IsExactly<StepCreateIcons>())
+    return false;
+  dependencies->Reads(context_->manifest_data);
+  dependencies->Reads(context_->uid);
+  dependencies->Reads(context_->is_preload_request);
+  dependencies->Reads(resource::kPackageDirectory);
+  dependencies->Writes(resource::kIconDirectory);
+  return true;
+}
+
 Step::Status StepCreateIcons::undo() {
   for (auto& icon : icons_) {
     bs::error_code error;
-    bf::remove_all(icon, error);
+    RemoveTree(icon, &error);
   }
   return Status::OK;
 }
@@ -56,6 +69,7 @@ Step::Status StepCreateIcons::process() {
                      << " , error: " << error;
           return Status::ICON_ERROR;
         }
+        RegisterWrittenFile(destination_path);
         icons_.push_back(destination_path);
       }
     }
@@ -41,6 +41,11 @@ class StepCreateIcons : public Step {
    */
   Status undo() override;
   Status precheck() override { return Status::OK; }
+  /**
+   * \brief reads manifest_data, uid, is_preload_request and package
+   *        directory resource, writes icon directory resource
+   */
+  bool GetDependencies(StepDependencies* dependencies) const override;
 
  private:
   std::vector<boost::filesystem::path> icons_;
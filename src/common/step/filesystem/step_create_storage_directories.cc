@@ -14,6 +14,7 @@
 #include <vector>
 
 #include "common/shared_dirs.h"
+#include "common/utils/file_util.h"
 #include "common/utils/glist_range.h"
 
 namespace bf = boost::filesystem;
@@ -34,6 +35,17 @@ const utils::VersionNumber ver30("3.0");
 namespace common_installer {
 namespace filesystem {
 
+bool StepCreateStorageDirectories::GetDependencies(
+    StepDependencies* dependencies) const {
+  if (!IsExactly<StepCreateStorageDirectories>())
+    return false;
+  dependencies->Reads(context_->request_mode);
+  dependencies->Reads(context_->pkg_path);
+  dependencies->Reads(context_->manifest_data);
+  dependencies->Writes(resource::kPackageDirectory);
+  return true;
+}
+
 common_installer::Step::Status StepCreateStorageDirectories::process() {
   if (context_->request_mode.get() == RequestMode::GLOBAL) {
     // remove packaged RW diriectories
@@ -86,7 +98,7 @@ bool StepCreateStorageDirectories::SubShareDir() {
 
   if (api_version >= ver30) {
     // remove shared/data (deprecated)
-    bf::remove_all(shared_data_path, error_code);
+    RemoveTree(shared_data_path, &error_code);
     if (error_code) {
       LOG(ERROR) << "Can't remove dir:" << shared_data_path;
       return false;
@@ -100,7 +112,7 @@ bool StepCreateStorageDirectories::SubShareDir() {
   }
 
   // remove shared/cache (do not support)
-  bf::remove_all(shared_cache_path, error_code);
+  RemoveTree(shared_cache_path, &error_code);
   if (error_code) {
     LOG(ERROR) << "Can't remove dir:" << shared_cache_path;
     return false;
@@ -146,11 +158,11 @@ void StepCreateStorageDirectories::RemoveAll() {
   bf::path shared_cache_path = context_->pkg_path.get() / kSharedCache;
   bf::path shared_trusted_path = context_->pkg_path.get() / kSharedTrusted;
 
-  bf::remove_all(data_path, error_code);
-  bf::remove_all(cache_path, error_code);
-  bf::remove_all(shared_data_path, error_code);
-  bf::remove_all(shared_cache_path, error_code);
-  bf::remove_all(shared_trusted_path, error_code);
+  RemoveTree(data_path, &error_code);
+  RemoveTree(cache_path, &error_code);
+  RemoveTree(shared_data_path, &error_code);
+  RemoveTree(shared_cache_path, &error_code);
+  RemoveTree(shared_trusted_path, &error_code);
 }
 
 }  // namespace filesystem
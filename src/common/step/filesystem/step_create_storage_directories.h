@@ -33,6 +33,11 @@ class StepCreateStorageDirectories : public common_installer::Step {
   Status clean() override { return Status::OK; }
   Status undo() override { return Status::OK; }
   Status precheck() override { return Status::OK; }
+  /**
+   * \brief reads request_mode, pkg_path and manifest_data, writes package
+   *        directory resource
+   */
+  bool GetDependencies(StepDependencies* dependencies) const override;
 
  protected:
   bool ShareDir();
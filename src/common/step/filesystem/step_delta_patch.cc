@@ -8,15 +8,24 @@
 #include <boost/filesystem/path.hpp>
 #include <delta/delta_handler.h>
 #include <delta/delta_parser.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <set>
+#include <string>
 
+#include "common/utils/file_copy.h"
 #include "common/utils/file_util.h"
 #include "common/utils/glist_range.h"
+#include "common/utils/sync_registry.h"
+#include "common/utils/thread_pool.h"
+#include "common/utils/vcdiff_decoder.h"
 
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
@@ -63,14 +72,6 @@ void RemoveBinarySymlinks(const bf::path& dir) {
   }
 }
 
-void RemoveStorageDirectories(const bf::path& dir) {
-  bs::error_code error;
-  bf::remove_all(dir / kDataDir, error);
-  bf::remove_all(dir / kCacheDir, error);
-  bf::remove_all(dir / kSharedData, error);
-  bf::remove_all(dir / kSharedTrusted, error);
-}
-
 void RemoveExtraIconFiles(const bf::path& dir, const bf::path& pkg_dir,
                           manifest_x* manifest) {
   for (application_x* app : GListRange<application_x*>(manifest->application)) {
@@ -90,7 +91,7 @@ void RemoveExtraIconFiles(const bf::path& dir, const bf::path& pkg_dir,
 bool ApplyDeletedFiles(const delta::DeltaInfo& info, const bf::path& app_dir) {
   for (auto& relative : info.removed()) {
     bs::error_code error;
-    bf::remove_all(app_dir / relative, error);
+    ci::RemoveTree(app_dir / relative, &error);
     if (error) {
       LOG(WARNING) << "Failed to remove";
     }
@@ -99,54 +100,151 @@ bool ApplyDeletedFiles(const delta::DeltaInfo& info, const bf::path& app_dir) {
   return true;
 }
 
-bool ApplyModifiedFiles(const delta::DeltaInfo& info, const bf::path& app_dir,
-                        const bf::path& patch_dir, bool is_preload) {
-  for (auto& relative : info.modified()) {
-    bf::path temp_file = ci::GenerateTemporaryPath(
-        bf::path(ci::GetRootAppPath(is_preload)) / "tmp_file");
-    bf::path patch_file = patch_dir / relative;
-    bf::path input = app_dir / relative;
-    if (!bf::is_regular_file(input)) {
-      LOG(ERROR) << "Cannot modify. Not a regular file: " << input;
-      return false;
+bool RunXDelta(const bf::path& input, const bf::path& patch_file,
+               const bf::path& output) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    const char* const argv[] = {
+      kXDeltaBinary,
+      "-d",
+      "-s",
+      input.c_str(),
+      patch_file.c_str(),
+      output.c_str(),
+      nullptr,
+    };
+    int ret = execv(argv[0], const_cast<char* const*>(argv));
+    if (ret != 0) {
+      // no other thing to -> do just quit, without running exit handlers
+      // of forked multithreaded parent
+      _exit(-1);
     }
-    pid_t pid = fork();
-    if (pid == 0) {
-      const char* const argv[] = {
-        kXDeltaBinary,
-        "-d",
-        "-s",
-        input.c_str(),
-        patch_file.c_str(),
-        temp_file.c_str(),
-        nullptr,
-      };
-      int ret = execv(argv[0], const_cast<char* const*>(argv));
-      if (ret != 0) {
-        // no other thing to -> do just quit
-        exit(-1);
-      }
-    } else if (pid == -1) {
-      LOG(ERROR) << "Failed to fork with errno: " << errno;
+  } else if (pid == -1) {
+    LOG(ERROR) << "Failed to fork with errno: " << errno;
+    return false;
+  } else {
+    int status;
+    waitpid(pid, &status, 0);
+    if (status != 0) {
+      LOG(ERROR) << "xdelta3 failed with error code: " << status;
       return false;
-    } else {
-      int status;
-      waitpid(pid, &status, 0);
-      if (status != 0) {
-        LOG(ERROR) << "xdelta3 failed with error code: " << status;
+    }
+  }
+  return true;
+}
+
+// patched file takes over owner, mode and extended attributes (e.g. SMACK
+// labels) of installed file so that nothing but content changes
+bool CopyFileMetadata(const struct stat& info, const bf::path& from,
+                      const bf::path& to) {
+  int from_fd = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  int to_fd = open(to.c_str(), O_RDONLY | O_CLOEXEC);
+  // chown() clears set-user-ID bits and file capabilities, so it goes first
+  bool result = from_fd >= 0 && to_fd >= 0 &&
+      fchown(to_fd, info.st_uid, info.st_gid) == 0 &&
+      fchmod(to_fd, info.st_mode & 07777) == 0 &&
+      ci::CopyExtendedAttributes(from_fd, to_fd);
+  if (!result)
+    LOG(ERROR) << "Cannot copy owner and attributes of " << from << " to "
+               << to << ", errno: " << errno;
+  if (from_fd >= 0)
+    close(from_fd);
+  if (to_fd >= 0)
+    close(to_fd);
+  return result;
+}
+
+// patched file is decoded from installed file, which is not copied to
+// snapshot at all
+bool PatchFile(const bf::path& input, const bf::path& patch_file,
+               const bf::path& output) {
+  struct stat info;
+  if (lstat(input.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+    LOG(ERROR) << "Cannot modify. Not a regular file: " << input;
+    return false;
+  }
+  bf::path temp_file = ci::GenerateTemporaryPath(output);
+  int source_fd = open(input.c_str(), O_RDONLY | O_CLOEXEC);
+  int patch_fd = open(patch_file.c_str(), O_RDONLY | O_CLOEXEC);
+  int output_fd = open(temp_file.c_str(),
+                       O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+                       info.st_mode & 07777);
+  ci::VcdiffDecoder::Result result = ci::VcdiffDecoder::Result::ERROR;
+  if (source_fd >= 0 && patch_fd >= 0 && output_fd >= 0) {
+    ci::VcdiffDecoder decoder;
+    result = decoder.Decode(source_fd, patch_fd, output_fd);
+  } else {
+    LOG(ERROR) << "Cannot open files to patch " << input
+               << ", errno: " << errno;
+  }
+  if (source_fd >= 0)
+    close(source_fd);
+  if (patch_fd >= 0)
+    close(patch_fd);
+  if (output_fd >= 0)
+    close(output_fd);
+
+  bs::error_code error;
+  if (result == ci::VcdiffDecoder::Result::UNSUPPORTED) {
+    // e.g. secondary compression, leave it to xdelta3 tool
+    LOG(INFO) << "Patch of " << input << " needs " << kXDeltaBinary;
+    bf::remove(temp_file, error);
+    if (RunXDelta(input, patch_file, temp_file))
+      result = ci::VcdiffDecoder::Result::OK;
+    else
+      result = ci::VcdiffDecoder::Result::ERROR;
+  }
+  if (result != ci::VcdiffDecoder::Result::OK ||
+      !CopyFileMetadata(info, input, temp_file) ||
+      rename(temp_file.c_str(), output.c_str()) != 0) {
+    LOG(ERROR) << "Failed to patch " << input;
+    bf::remove(temp_file, error);
+    return false;
+  }
+  ci::RegisterWrittenFile(output);
+  return true;
+}
+
+// files are patched independently of each other, so they are spread over
+// pool of workers; first failure cancels files which were not started yet
+bool ApplyModifiedFiles(const delta::DeltaInfo& info,
+                        const bf::path& installed_dir, const bf::path& app_dir,
+                        const bf::path& patch_dir) {
+  const auto& modified = info.modified();
+  unsigned threads = std::min<size_t>(ci::ThreadPool::DefaultSize(),
+                                      modified.size());
+  if (threads <= 1) {
+    for (auto& relative : modified) {
+      if (!PatchFile(installed_dir / relative, patch_dir / relative,
+                     app_dir / relative))
         return false;
-      }
+      LOG(DEBUG) << "Patched: " << relative;
     }
-    bs::error_code error;
-    bf::copy_file(temp_file, input, bf::copy_option::overwrite_if_exists,
-                  error);
-    if (error) {
-      LOG(ERROR) << "Failed to copy from " << temp_file << " to " << input;
-      bf::remove(temp_file, error);
-      return false;
+    return true;
+  }
+
+  std::atomic<bool> cancelled(false);
+  bf::path failed_file;
+  {
+    ci::ThreadPool pool(threads);
+    for (auto& relative : modified) {
+      pool.Submit([&, relative] {
+        if (cancelled)
+          return;
+        if (!PatchFile(installed_dir / relative, patch_dir / relative,
+                       app_dir / relative)) {
+          // only first failing worker reports its file
+          if (!cancelled.exchange(true))
+            failed_file = relative;
+          return;
+        }
+        LOG(DEBUG) << "Patched: " << relative;
+      });
     }
-    bf::remove(temp_file, error);
-    LOG(DEBUG) << "Patched: " << relative;
+  }
+  if (cancelled) {
+    LOG(ERROR) << "Failed to apply patch to: " << failed_file;
+    return false;
   }
   return true;
 }
@@ -182,42 +280,42 @@ bool ApplyAddedFiles(const delta::DeltaInfo& info, const bf::path& app_dir,
   return true;
 }
 
-bool ApplyPatch(const delta::DeltaInfo& info, const bf::path& app_dir,
-                const bf::path& patch_dir, bool is_preload) {
+bool ApplyPatch(const delta::DeltaInfo& info, const bf::path& installed_dir,
+                const bf::path& app_dir, const bf::path& patch_dir) {
   if (!ApplyDeletedFiles(info, app_dir))
     return false;
-  if (!ApplyModifiedFiles(info, app_dir, patch_dir, is_preload))
+  if (!ApplyModifiedFiles(info, installed_dir, app_dir, patch_dir))
     return false;
   if (!ApplyAddedFiles(info, app_dir, patch_dir))
     return false;
   return true;
 }
 
-bool CopySkipMount(const bf::path& from, const bf::path& to) {
-  bs::error_code error;
-  bf::create_directory(to, error);
-  if (error) {
-    LOG(ERROR) << "Failed to create target directory";
-    return false;
+// Snapshot of installed package is a real copy. Files are reflinked where
+// filesystem supports it (see CopyFileContent()), which shares data blocks
+// copy-on-write, so patching the snapshot never changes installed files.
+// Elsewhere they are copied, so files which delta removes, patches or
+// replaces are left out of the snapshot instead of being copied and then
+// deleted or overwritten.
+// Hardlinks are not used as they share inode: metadata set on snapshot by
+// later steps (ownership, permissions, SMACK labels) would be applied to the
+// installed package too.
+bool CopySkipMount(const delta::DeltaInfo& info, const bf::path& from,
+                   const bf::path& to, const bf::path& patch_dir,
+                   bool skip_storage) {
+  std::set<std::string> skipped = {kExternalMemoryMountPoint};
+  skipped.insert(info.removed().begin(), info.removed().end());
+  skipped.insert(info.modified().begin(), info.modified().end());
+  for (auto& relative : info.added()) {
+    if (!bf::is_directory(patch_dir / relative))
+      skipped.insert(relative);
   }
-  for (bf::directory_iterator iter(from); iter != bf::directory_iterator();
-       ++iter) {
-    if (iter->path().filename() == kExternalMemoryMountPoint)
-      continue;
-
-    if (bf::is_directory(iter->path())) {
-      if (!ci::CopyDir(iter->path(), to / iter->path().filename())) {
-        LOG(ERROR) << "Failed to create copy of: " << iter->path();
-        return false;
-      }
-    } else {
-      bs::error_code error;
-      bf::copy(iter->path(), to / iter->path().filename(), error);
-      if (error) {
-        LOG(ERROR) << "Failed to create copy of: " << iter->path();
-        return false;
-      }
-    }
+  // storage directories are restored by installation itself
+  if (skip_storage)
+    skipped.insert({kDataDir, kCacheDir, kSharedData, kSharedTrusted});
+  if (!ci::CopyDir(from, to, ci::FS_NONE, skipped)) {
+    LOG(ERROR) << "Failed to create copy of: " << from;
+    return false;
   }
   return true;
 }
@@ -270,6 +368,9 @@ Step::Status StepDeltaPatch::process() {
     return Status::DELTA_ERROR;
   }
 
+  // unpacked content is replaced, digests of delta package are stale
+  context_->file_digests.get().clear();
+
   // create old content directory and patch directory
   patch_dir_ = context_->unpacked_dir_path.get();
   patch_dir_ += ".patch";
@@ -278,10 +379,12 @@ Step::Status StepDeltaPatch::process() {
     return Status::DELTA_ERROR;
   }
 
-  if (!CopySkipMount(
-      context_->root_application_path.get() / context_->pkgid.get()
-          / delta_root_,
-      context_->unpacked_dir_path.get())) {
+  bf::path installed_dir =
+      context_->root_application_path.get() / context_->pkgid.get() /
+      delta_root_;
+  if (!CopySkipMount(*delta_info, installed_dir,
+                     context_->unpacked_dir_path.get(), patch_dir_,
+                     delta_root_.empty())) {
     LOG(ERROR) << "Failed to copy package files";
     return Status::DELTA_ERROR;
   }
@@ -289,10 +392,10 @@ Step::Status StepDeltaPatch::process() {
   // if there is no root set, that means we need to handle files added by
   // installer itself (during installation) and files added during runtime
   // they will be restored in process so just remove extra copy here, so that
-  // it doesn't interfere with installation process
+  // it doesn't interfere with installation process (storage directories are
+  // not copied at all)
   if (delta_root_.empty()) {
     RemoveBinarySymlinks(context_->unpacked_dir_path.get());
-    RemoveStorageDirectories(context_->unpacked_dir_path.get());
     // TODO(t.iwanek): subclass this step in wgt backend
     RemoveExtraIconFiles(
         context_->unpacked_dir_path.get(),
@@ -301,19 +404,19 @@ Step::Status StepDeltaPatch::process() {
   }
 
   // apply changes mentioned in delta
-  if (!ApplyPatch(*delta_info, context_->unpacked_dir_path.get(), patch_dir_,
-    context_->is_preload_request.get()))
+  if (!ApplyPatch(*delta_info, installed_dir, context_->unpacked_dir_path.get(),
+                  patch_dir_))
     return Status::DELTA_ERROR;
 
   bs::error_code error;
-  bf::remove_all(patch_dir_, error);
+  RemoveTree(patch_dir_, &error);
   LOG(INFO) << "Delta patch applied successfully";
   return Status::OK;
 }
 
 Step::Status StepDeltaPatch::undo() {
   bs::error_code error;
-  bf::remove_all(patch_dir_, error);
+  RemoveTree(patch_dir_, &error);
   return Status::OK;
 }
 
@@ -28,8 +28,11 @@ namespace filesystem {
  * Flow goes as below:
  *  1) `unpacked_dir` (where delta package is unpacked) is moved to
  *     `unpacked_dir_patch` (PATCH DIR)
- *  2) old package content is moved to `unpacked_dir` (it becomes APP_DIR)
- *  3) `unpacked_dir` is being applied with patches (using xdelta3 tool)
+ *  2) old package content is copied to `unpacked_dir` (it becomes APP_DIR),
+ *     files are reflinked where filesystem supports it, files which delta
+ *     removes, patches or replaces are not copied
+ *  3) `unpacked_dir` is being applied with patches decoded from installed
+ *     files
  *  4) `unpacked_dir_patch` is removed.
  *  5) Normal update flow proceeds as if it it was normal update installation
  *     (as the unpacked_dir contains full new version of package).
@@ -8,7 +8,11 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/system/error_code.hpp>
 
+#include <string>
+#include <vector>
+
 #include "common/paths.h"
+#include "common/recovery_file.h"
 #include "common/utils/file_util.h"
 
 namespace bf = boost::filesystem;
@@ -24,7 +28,7 @@ Step::Status StepRecoverFiles::RecoveryNew() {
   }
   if (bf::exists(context_->pkg_path.get())) {
     bs::error_code error;
-    bf::remove_all(context_->pkg_path.get(), error);
+    RemoveTree(context_->pkg_path.get(), &error);
   }
   LOG(INFO) << "Package files recovery done";
   return Status::OK;
@@ -36,10 +40,17 @@ Step::Status StepRecoverFiles::RecoveryUpdate() {
     return Status::OK;
   }
   bf::path backup_path = GetBackupPathForPackagePath(context_->pkg_path.get());
-  if (bf::exists(backup_path)) {
+  recovery::RecoveryFile* recovery_file =
+      context_->recovery_info.get().recovery_file.get();
+  if (recovery_file &&
+      recovery_file->backup_phase() != recovery::BackupPhase::None) {
+    if (!RestoreExchangedContent(recovery_file->backup_phase(),
+                                 recovery_file->backup_content()))
+      return Status::RECOVERY_ERROR;
+  } else if (bf::exists(backup_path)) {
     if (bf::exists(context_->pkg_path.get())) {
       bs::error_code error;
-      bf::remove_all(context_->pkg_path.get(), error);
+      RemoveTree(context_->pkg_path.get(), &error);
       if (error) {
         LOG(ERROR) << "Cannot restore widget files to its correct location";
         return Status::RECOVERY_ERROR;
@@ -47,10 +58,59 @@ Step::Status StepRecoverFiles::RecoveryUpdate() {
     }
     (void) MoveDir(backup_path, context_->pkg_path.get());
   }
+  // new content which was not committed or was already reverted
+  bf::path staging_path =
+      GetStagingPathForPackagePath(context_->pkg_path.get());
+  if (bf::exists(staging_path)) {
+    bs::error_code error;
+    RemoveTree(staging_path, &error);
+    if (error) {
+      LOG(ERROR) << "Cannot remove staged package files";
+      return Status::RECOVERY_ERROR;
+    }
+  }
   LOG(INFO) << "Package files recovery done";
   return Status::OK;
 }
 
+bool StepRecoverFiles::RestoreExchangedContent(recovery::BackupPhase phase,
+                                               const std::string& content) {
+  const bf::path& pkg_path = context_->pkg_path.get();
+  bf::path backup_path = GetBackupPathForPackagePath(pkg_path);
+  std::vector<bf::path> candidates = {
+    pkg_path, GetStagingPathForPackagePath(pkg_path)
+  };
+  if (phase == recovery::BackupPhase::Exchanged)
+    candidates.push_back(backup_path);
+  bf::path old_content;
+  for (auto& candidate : candidates) {
+    if (GetPathIdentity(candidate) == content) {
+      old_content = candidate;
+      break;
+    }
+  }
+  bs::error_code error;
+  if (old_content.empty()) {
+    // backup was already removed by successful update
+    LOG(WARNING) << "Old package content not found, keeping " << pkg_path;
+  } else if (old_content != pkg_path) {
+    // directory found by its identity holds old content until it is renamed,
+    // so crash in between is recovered again in the same way
+    RemoveTree(pkg_path, &error);
+    if (error || !RenameDir(old_content, pkg_path)) {
+      LOG(ERROR) << "Cannot restore package files from " << old_content;
+      return false;
+    }
+  }
+  // backup path holds new content if undo exchanged it with package path
+  RemoveTree(backup_path, &error);
+  if (error) {
+    LOG(ERROR) << "Cannot remove " << backup_path;
+    return false;
+  }
+  return true;
+}
+
 bool StepRecoverFiles::SetPackagePath() {
   if (context_->pkgid.get().empty())
     return false;
@@ -7,7 +7,10 @@
 
 #include <manifest_parser/utils/logging.h>
 
+#include <string>
+
 #include "common/installer_context.h"
+#include "common/recovery_file.h"
 #include "common/step/recovery/step_recovery.h"
 
 namespace common_installer {
@@ -19,7 +22,9 @@ namespace filesystem {
  *
  * For recovering new installation, package files are removed.
  * For recovering update installation, old package files are restored to its
- * original locations.
+ * original locations and new package files staged for update are removed.
+ * If package directory was being exchanged with its new content, recovery
+ * file tells which directory holds old content.
  */
 class StepRecoverFiles : public recovery::StepRecovery {
  public:
@@ -30,6 +35,8 @@ class StepRecoverFiles : public recovery::StepRecovery {
 
  private:
   bool SetPackagePath();
+  bool RestoreExchangedContent(recovery::BackupPhase phase,
+                               const std::string& content);
 
   STEP_NAME(RecoverBackup)
 };
@@ -12,6 +12,8 @@
 #include <vector>
 
 #include "common/pkgmgr_query.h"
+#include "common/utils/file_util.h"
+#include "common/utils/trash.h"
 
 namespace bs = boost::system;
 namespace bf = boost::filesystem;
@@ -71,19 +73,21 @@ Step::Status StepRemoveFiles::process() {
           LOG(DEBUG) << "Skipping remove dir:" << itr->path().c_str();
           continue;
         }
-        bf::remove_all(itr->path(), error);
+        MoveToTrash(itr->path(), context_->root_application_path.get(),
+                    &error);
         if (error) {
           LOG(ERROR) << "Can't remove dir:" << context_->pkg_path.get().c_str();
         }
       } else if (bf::is_regular_file(itr->status())) {
-        bf::remove_all(itr->path(), error);
+        RemoveTree(itr->path(), &error);
       }
     }
     // The shared/res will be removed if it exists.
     bf::path shared_res_path = pkg_path / kSharedRes;
-    bf::remove_all(shared_res_path, error);
+    MoveToTrash(shared_res_path, context_->root_application_path.get(),
+                &error);
   } else {
-    bf::remove_all(pkg_path, error);
+    MoveToTrash(pkg_path, context_->root_application_path.get(), &error);
     if (error) {
       LOG(ERROR) << "Can't remove directory:" <<
           context_->pkg_path.get().c_str();
@@ -7,6 +7,7 @@
 #include <boost/system/error_code.hpp>
 
 #include "common/installer_context.h"
+#include "common/utils/file_util.h"
 
 namespace common_installer {
 namespace filesystem {
@@ -28,7 +29,7 @@ void StepRemoveTemporaryDirectory::RemoveFiles() {
   if (unpack_dir_path.empty())
     return;
   boost::system::error_code error_code;
-  bf::remove_all(unpack_dir_path, error_code);
+  RemoveTree(unpack_dir_path, &error_code);
   return;
 }
 }  // namespace filesystem
@@ -5,27 +5,74 @@
 
 #include "common/step/filesystem/step_unzip.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <tzplatform_config.h>
+#include <unistd.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/chrono/detail/system.hpp>
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
 #include <cstdint>
 #include <climits>
 #include <cstring>
+#include <regex>
 #include <string>
 
+#include "common/certificate_validation.h"
 #include "common/utils/file_util.h"
+#include "common/utils/zip_extractor.h"
+#include "common/utils/zip_stream_extractor.h"
 
 namespace bf = boost::filesystem;
 namespace bs = boost::system;
+namespace ci = common_installer;
 
 namespace {
 
-bool CheckFreeSpaceAtPath(int64_t required_size,
-    const boost::filesystem::path& target_location) {
+const char kTizenManifest[] = "tizen-manifest.xml";
+const char kWidgetConfig[] = "config.xml";
+const char kSignatureAuthor[] = "author-signature.xml";
+const char kRegexDistributorSignature[] = "^signature[1-9][0-9]*\\.xml$";
+const char kStdinPath[] = "/dev/stdin";
+const char kRegexFdPath[] = "^/(proc/self|dev)/fd/([0-9]+)$";
+
+// files needed by manifest parsing and signature checking
+bool IsMetadataFile(const std::string& name) {
+  static const std::regex distributor_regex(kRegexDistributorSignature);
+  return name == kTizenManifest || name == kWidgetConfig ||
+         name == kSignatureAuthor ||
+         std::regex_search(name, distributor_regex);
+}
+
+// package is delivered through pipe, socket or character device, so it can
+// be read only once, sequentially
+bool IsPackageStream(const bf::path& path) {
+  struct stat buf;
+  if (stat(path.c_str(), &buf) != 0)
+    return false;
+  return S_ISFIFO(buf.st_mode) || S_ISSOCK(buf.st_mode) ||
+         S_ISCHR(buf.st_mode);
+}
+
+// descriptor paths are duplicated instead of opened, as sockets cannot be
+// opened by path
+int OpenPackageStream(const bf::path& path) {
+  static const std::regex fd_regex(kRegexFdPath);
+  std::smatch match;
+  std::string path_string = path.string();
+  if (path_string == kStdinPath)
+    return dup(STDIN_FILENO);
+  if (std::regex_match(path_string, match, fd_regex))
+    return dup(std::stoi(match[2]));
+  return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+bool GetFreeSpaceAtPath(const boost::filesystem::path& target_location,
+                        uint64_t* free_space) {
   bs::error_code error;
   boost::filesystem::path root = target_location;
   while (!bf::exists(root) && root != root.root_path()) {
@@ -40,8 +87,16 @@ bool CheckFreeSpaceAtPath(int64_t required_size,
     LOG(ERROR) << "Failed to get space_info: " << error.message();
     return false;
   }
+  *free_space = space_info.free;
+  return true;
+}
 
-  return (space_info.free >= static_cast<uint64_t>(required_size));
+bool CheckFreeSpaceAtPath(int64_t required_size,
+    const boost::filesystem::path& target_location) {
+  uint64_t free_space;
+  if (!GetFreeSpaceAtPath(target_location, &free_space))
+    return false;
+  return (free_space >= static_cast<uint64_t>(required_size));
 }
 
 }  // namespace
@@ -49,7 +104,19 @@ bool CheckFreeSpaceAtPath(int64_t required_size,
 namespace common_installer {
 namespace filesystem {
 
+StepUnzip::StepUnzip(InstallerContext* context, Stage stage)
+    : Step(context),
+      stage_(stage) {
+}
+
 Step::Status StepUnzip::precheck() {
+  if (stage_ == Stage::CONTENT) {
+    if (context_->unpacked_dir_path.get().empty()) {
+      LOG(ERROR) << "unpacked_dir_path attribute is empty";
+      return Step::Status::INVALID_VALUE;
+    }
+  }
+
   if (context_->file_path.get().empty()) {
     LOG(ERROR) << "file_path attribute is empty";
     return Step::Status::INVALID_VALUE;
@@ -76,7 +143,15 @@ Step::Status StepUnzip::precheck() {
 }
 
 Step::Status StepUnzip::process() {
-  bf::path tmp_dir = GenerateTmpDir(context_->root_application_path.get());
+  if (stage_ == Stage::CONTENT)
+    return ProcessContent();
+
+  // fresh install is unpacked next to its final location and then renamed
+  bool use_staging_dir =
+      context_->request_type.get() == RequestType::Install;
+  bf::path tmp_dir = use_staging_dir ?
+      GenerateStagingDir(context_->root_application_path.get()) :
+      GenerateTmpDir(context_->root_application_path.get());
 
   // write unpacked directory for recovery file
   if (context_->recovery_info.get().recovery_file) {
@@ -89,50 +164,155 @@ Step::Status StepUnzip::process() {
     return Step::Status::APP_DIR_ERROR;
   }
 
+  // size of streamed package is unknown until its end
+  bool stream = IsPackageStream(context_->file_path.get());
+  if (!stream) {
+    Status status = CheckRequiredSpace(tmp_dir);
+    if (status != Status::OK) {
+      bs::error_code error;
+      RemoveTree(tmp_dir, &error);
+      return status;
+    }
+  }
+
+  context_->file_digests.get().clear();
+  bool extracted = false;
+  if (stream) {
+    // stream is read once, so whole package is unpacked at metadata stage
+    Status status = ExtractStream(tmp_dir);
+    if (status == Status::OUT_OF_SPACE) {
+      bs::error_code error;
+      RemoveTree(tmp_dir, &error);
+      return status;
+    }
+    extracted = status == Status::OK;
+  } else {
+    ZipExtractor extractor(context_->file_path.get(), tmp_dir,
+                           CreateExtractOptions());
+    if (stage_ == Stage::METADATA)
+      extracted = extractor.Extract(IsMetadataFile);
+    else
+      extracted = extractor.Extract(std::string());
+  }
+  if (!extracted) {
+    LOG(ERROR) << "Failed to process unpack step";
+    bs::error_code error;
+    RemoveTree(tmp_dir, &error);
+    return Step::Status::UNZIP_ERROR;
+  }
+  context_->unpacked_dir_path.set(tmp_dir);
+  context_->partially_unpacked.set(stage_ == Stage::METADATA && !stream);
+  context_->unpacked_to_staging_dir.set(use_staging_dir);
+
+  LOG(INFO) << context_->file_path.get() << " was successfully unzipped into "
+      << context_->unpacked_dir_path.get();
+  return Status::OK;
+}
+
+Step::Status StepUnzip::CheckRequiredSpace(const bf::path& tmp_dir) {
   int64_t required_size =
       GetUnpackedPackageSize(context_->file_path.get());
 
   if (required_size == -1) {
     LOG(ERROR) << "Couldn't get uncompressed size for package: "
                << context_->file_path.get();
-    bs::error_code error;
-    bf::remove_all(tmp_dir, error);
-    return Step::Status::APP_DIR_ERROR;
+    return Status::APP_DIR_ERROR;
   }
 
   LOG(DEBUG) << "Required size for application: " << required_size << "B";
 
   if (!CheckFreeSpaceAtPath(required_size, tmp_dir)) {
     LOG(ERROR) << "There is not enough space to unpack application files";
-    bs::error_code error;
-    bf::remove_all(tmp_dir, error);
-    return Step::Status::OUT_OF_SPACE;
+    return Status::OUT_OF_SPACE;
   }
 
   if (!CheckFreeSpaceAtPath(required_size,
       bf::path(context_->root_application_path.get()))) {
     LOG(ERROR) << "There is not enough space to install application files";
-    bs::error_code error;
-    bf::remove_all(tmp_dir, error);
-    return Step::Status::OUT_OF_SPACE;
+    return Status::OUT_OF_SPACE;
   }
+  return Status::OK;
+}
 
-  if (!ExtractToTmpDir(context_->file_path.get().string().c_str(), tmp_dir)) {
-    LOG(ERROR) << "Failed to process unpack step";
-    bs::error_code error;
-    bf::remove_all(tmp_dir, error);
+Step::Status StepUnzip::ExtractStream(const bf::path& tmp_dir) {
+  // every extracted byte is needed once in temporary directory and once in
+  // application directory, which may be on the same filesystem
+  uint64_t tmp_free;
+  uint64_t root_free;
+  if (!GetFreeSpaceAtPath(tmp_dir, &tmp_free) ||
+      !GetFreeSpaceAtPath(context_->root_application_path.get(),
+                          &root_free))
+    return Status::APP_DIR_ERROR;
+  int fd = OpenPackageStream(context_->file_path.get());
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open package stream: "
+               << context_->file_path.get() << ", errno: " << errno;
+    return Status::UNZIP_ERROR;
+  }
+  ExtractOptions options = CreateExtractOptions();
+  // zero would mean no limit
+  options.max_unpacked_size =
+      std::max<uint64_t>(std::min(tmp_free, root_free), 1);
+  ZipStreamExtractor extractor(fd, tmp_dir, options);
+  bool result = extractor.Extract();
+  close(fd);
+  if (!result && extractor.out_of_space()) {
+    LOG(ERROR) << "There is not enough space to unpack application files";
+    return Status::OUT_OF_SPACE;
+  }
+  return result ? Status::OK : Status::UNZIP_ERROR;
+}
+
+Step::Status StepUnzip::ProcessContent() {
+  // streamed package is unpacked at once by metadata stage
+  if (!context_->partially_unpacked.get()) {
+    LOG(DEBUG) << "Package content is already unpacked";
+    return Status::OK;
+  }
+  const bf::path& unpacked_dir = context_->unpacked_dir_path.get();
+  ZipExtractor extractor(context_->file_path.get(), unpacked_dir,
+                         CreateExtractOptions());
+  if (!extractor.Extract([](const std::string& name) {
+        return !IsMetadataFile(name);
+      })) {
+    LOG(ERROR) << "Failed to unpack package content";
     return Step::Status::UNZIP_ERROR;
   }
-  context_->unpacked_dir_path.set(tmp_dir);
+  context_->partially_unpacked.set(false);
 
-  LOG(INFO) << context_->file_path.get() << " was successfully unzipped into "
-      << context_->unpacked_dir_path.get();
+  if (context_->signature_references_deferred.get()) {
+    std::string error_message;
+    if (!ValidateSignatureReferences(unpacked_dir,
+        context_->is_preload_request.get(), &error_message,
+        &context_->file_digests.get())) {
+      LOG(ERROR) << "Signature references are invalid";
+      on_error(Status::CERT_ERROR, error_message);
+      return Status::CERT_ERROR;
+    }
+    context_->signature_references_deferred.set(false);
+  }
+
+  LOG(INFO) << context_->file_path.get() << " content was unzipped into "
+      << unpacked_dir;
   return Status::OK;
 }
 
+ExtractOptions StepUnzip::CreateExtractOptions() {
+  ExtractOptions options = ExtractOptions::FromEnvironment();
+  options.digests = &context_->file_digests.get();
+  // content of signed packages is verified by digests, preloaded packages
+  // may be unsigned
+  if (!context_->is_preload_request.get())
+    options.verify_crc = false;
+  return options;
+}
+
 Step::Status StepUnzip::undo() {
+  // directory is removed by undo of METADATA stage
+  if (stage_ == Stage::CONTENT)
+    return Status::OK;
   if (access(context_->unpacked_dir_path.get().string().c_str(), F_OK) == 0) {
-    bf::remove_all(context_->unpacked_dir_path.get());
+    RemoveTree(context_->unpacked_dir_path.get());
     LOG(DEBUG) << "remove temp dir: " << context_->unpacked_dir_path.get();
   }
   return Status::OK;
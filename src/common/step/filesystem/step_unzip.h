@@ -12,6 +12,7 @@
 
 #include "common/installer_context.h"
 #include "common/step/step.h"
+#include "common/utils/zip_extractor.h"
 
 namespace common_installer {
 namespace filesystem {
@@ -29,16 +30,45 @@ namespace filesystem {
  * * TZ_SYS_RW/tmpuniquedir (/usr/apps/tmpuniquedir)
  * * TZ_SER_APPS/tmpdir  (/{HOME}/apps_rw/tmpuniquedir)
  * InstallerContext::unpacked_dir_path points to this location.
+ *
+ * Unpacking may be staged so that invalid packages are rejected before
+ * whole content is extracted: Stage::METADATA extracts only manifest and
+ * signature files and Stage::CONTENT, placed after manifest parsing and
+ * signature checking, extracts the rest and checks signature references
+ * deferred by StepCheckSignature.
+ *
+ * Digests of unpacked files are stored in InstallerContext::file_digests
+ * for signature reference checking.
+ *
+ * If InstallerContext::file_path is a pipe, socket, character device or
+ * descriptor path (/dev/stdin, /proc/self/fd/N), package is extracted while
+ * it is read (see ZipStreamExtractor) and Stage::METADATA unpacks it whole.
+ * Free space cannot be checked upfront for such packages.
  */
 class StepUnzip : public Step {
  public:
-  using Step::Step;
+  enum class Stage {
+    ALL,       // unpack whole package
+    METADATA,  // unpack manifest and signature files only
+    CONTENT    // unpack everything not unpacked by METADATA stage
+  };
+
+  explicit StepUnzip(InstallerContext* context, Stage stage = Stage::ALL);
+
   Status process() override;
   Status clean() override { return Status::OK; }
   Status undo() override;
   Status precheck() override;
 
   STEP_NAME(Unzip)
+
+ private:
+  Status ProcessContent();
+  Status CheckRequiredSpace(const boost::filesystem::path& tmp_dir);
+  Status ExtractStream(const boost::filesystem::path& tmp_dir);
+  ExtractOptions CreateExtractOptions();
+
+  Stage stage_;
 };
 
 }  // namespace filesystem
@@ -90,7 +90,7 @@ Step::Status StepUpdateTep::clean() {
 Step::Status StepUpdateTep::undo() {
   bs::error_code error;
   if (bf::exists(context_->tep_path.get())) {
-    bf::remove_all(context_->tep_path.get(), error);
+    RemoveTree(context_->tep_path.get(), &error);
   }
   return Status::OK;
 }
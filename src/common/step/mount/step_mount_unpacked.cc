@@ -51,7 +51,7 @@ Step::Status StepMountUnpacked::undo() {
 
   if (bf::exists(context_->unpacked_dir_path.get())) {
     bs::error_code error;
-    bf::remove_all(context_->unpacked_dir_path.get(), error);
+    RemoveTree(context_->unpacked_dir_path.get(), &error);
     LOG(DEBUG) << "remove temp dir: " << context_->unpacked_dir_path.get();
   }
   return Status::OK;
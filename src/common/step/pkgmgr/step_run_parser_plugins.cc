@@ -33,6 +33,18 @@ Step::Status StepRunParserPlugin::ProcessPlugins(
   return Status::OK;
 }
 
+bool StepRunParserPlugin::GetDependencies(
+    StepDependencies* dependencies) const {
+  if (!IsExactly<StepRunParserPlugin>())
+    return false;
+  dependencies->Reads(context_->xml_path);
+  dependencies->Reads(context_->manifest_data);
+  dependencies->Reads(context_->backup_xml_path);
+  dependencies->Reads(context_->old_manifest_data);
+  dependencies->Writes(resource::kParserPlugins);
+  return true;
+}
+
 Step::Status StepRunParserPlugin::process() {
   return ProcessPlugins(context_->xml_path.get(), context_->manifest_data.get(),
                         action_type_);
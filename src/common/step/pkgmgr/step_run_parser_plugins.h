@@ -27,6 +27,11 @@ class StepRunParserPlugin : public Step {
   Step::Status clean() { return Status::OK; }
   Step::Status undo() override;
   Step::Status precheck() { return Status::OK; }
+  /**
+   * \brief reads xml_path, manifest_data, backup_xml_path and
+   *        old_manifest_data, writes parser plugins resource
+   */
+  bool GetDependencies(StepDependencies* dependencies) const override;
 
  private:
   Step::Status ProcessPlugins(const boost::filesystem::path& xml_path,
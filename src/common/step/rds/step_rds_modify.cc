@@ -68,7 +68,7 @@ Step::Status StepRDSModify::undo() {
 
 Step::Status StepRDSModify::clean() {
   if (bf::exists(backup_temp_dir_))
-    bf::remove_all(backup_temp_dir_);
+    RemoveTree(backup_temp_dir_);
   return Step::Status::OK;
 }
 
@@ -195,7 +195,7 @@ void StepRDSModify::RestoreFiles() {
     bf::path destination_path(app_path / modification.first);
     if (modification.second == Operation::ADD) {
       if (bf::is_directory(source_path)) {
-        bf::remove_all(destination_path);
+        RemoveTree(destination_path);
       } else {
         bf::remove(destination_path);
       }
@@ -212,7 +212,7 @@ void StepRDSModify::RestoreFiles() {
     }
   }
   // after files are restore delete temporary location
-  bf::remove_all(backup_temp_dir_);
+  RemoveTree(backup_temp_dir_);
 }
 
 }  // namespace rds
@@ -52,6 +52,29 @@ Step::Status StepCheckSignature::precheck() {
   return Step::Status::OK;
 }
 
+bool StepCheckSignature::GetDependencies(
+    StepDependencies* dependencies) const {
+  if (!IsExactly<StepCheckSignature>())
+    return false;
+  DeclareDependencies(dependencies);
+  return true;
+}
+
+void StepCheckSignature::DeclareDependencies(
+    StepDependencies* dependencies) const {
+  dependencies->Reads(context_->unpacked_dir_path);
+  dependencies->Reads(context_->request_type);
+  dependencies->Reads(context_->is_preload_request);
+  dependencies->Reads(context_->pkgid);
+  dependencies->Reads(context_->pkg_type);
+  dependencies->Reads(context_->manifest_data);
+  dependencies->Reads(context_->partially_unpacked);
+  dependencies->Reads(context_->file_digests);
+  dependencies->Writes(context_->signature_references_deferred);
+  dependencies->Writes(context_->certificate_info);
+  dependencies->Writes(context_->privilege_level);
+}
+
 boost::filesystem::path StepCheckSignature::GetSignatureRoot() const {
   return context_->unpacked_dir_path.get();
 }
@@ -59,10 +82,15 @@ boost::filesystem::path StepCheckSignature::GetSignatureRoot() const {
 Step::Status StepCheckSignature::CheckSignatures(bool check_reference,
                                                  bool is_preload,
                                                  PrivilegeLevel* level) {
+  // digests calculated during unpacking save reading files again
+  const DigestTable* digests = nullptr;
+  if (!context_->file_digests.get().empty() &&
+      GetSignatureRoot() == context_->unpacked_dir_path.get())
+    digests = &context_->file_digests.get();
   std::string error_message;
   if (!ValidateSignatures(GetSignatureRoot(), level,
                          &context_->certificate_info.get(), check_reference,
-                         is_preload, &error_message)) {
+                         is_preload, &error_message, digests)) {
     on_error(Status::CERT_ERROR, error_message);
     return Status::CERT_ERROR;
   }
@@ -110,6 +138,11 @@ Step::Status StepCheckSignature::process() {
       (context_->request_type.get() == ci::RequestType::ManifestDirectInstall ||
       context_->request_type.get() == ci::RequestType::ManifestDirectUpdate))
     check_reference = false;
+  // references of files which are not unpacked yet are checked by StepUnzip
+  if (check_reference && context_->partially_unpacked.get()) {
+    check_reference = false;
+    context_->signature_references_deferred.set(true);
+  }
   bool is_preload = context_->is_preload_request.get();
   Status status = CheckSignatures(check_reference, is_preload, &level);
   if (status != Status::OK)
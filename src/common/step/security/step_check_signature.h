@@ -43,7 +43,24 @@ class StepCheckSignature : public Step {
    */
   Status precheck() override;
 
+  /**
+   * \brief declares context used by signature checking, see
+   *        DeclareDependencies(). Applies to this class only, subclasses
+   *        are barriers unless they declare dependencies again.
+   */
+  bool GetDependencies(StepDependencies* dependencies) const override;
+
  protected:
+  /**
+   * \brief declares context of signature checking: reads unpacked_dir_path,
+   *        request_type, is_preload_request, pkgid, pkg_type, manifest_data,
+   *        partially_unpacked and file_digests, writes
+   *        signature_references_deferred, certificate_info and
+   *        privilege_level. Subclasses overriding GetSignatureRoot() or
+   *        CheckSignatures() should add properties they use.
+   */
+  void DeclareDependencies(StepDependencies* dependencies) const;
+
   virtual boost::filesystem::path GetSignatureRoot() const;
 
  private:
@@ -57,6 +57,15 @@ bool TranslatePrivilegesForCompatibility(manifest_x* m) {
 namespace common_installer {
 namespace security {
 
+bool StepPrivilegeCompatibility::GetDependencies(
+    StepDependencies* dependencies) const {
+  if (!IsExactly<StepPrivilegeCompatibility>())
+    return false;
+  dependencies->Reads(context_->privilege_level);
+  dependencies->Writes(context_->manifest_data);
+  return true;
+}
+
 Step::Status StepPrivilegeCompatibility::precheck() {
   if (!context_->manifest_data.get()) {
     LOG(ERROR) << "Manifest data is not set";
@@ -26,6 +26,8 @@ class StepPrivilegeCompatibility : public Step {
   // backward translation not needed
   Status undo() override { return Status::OK; }
   Status precheck() override;
+  // reads privilege_level, writes manifest_data
+  bool GetDependencies(StepDependencies* dependencies) const override;
 
   STEP_NAME(PrivilegeCompatibility)
 };
@@ -30,8 +30,10 @@
 
 #include <boost/signals2.hpp>
 #include <string>
+#include <typeinfo>
 
 #include "common/installer_context.h"
+#include "common/step/step_dependencies.h"
 
 // This macro should be defined at the end of class definition
 #define STEP_NAME(NAME)                                                        \
@@ -102,9 +104,34 @@ class Step {
   /** Returns step name */
   virtual const char* name() const = 0;
 
+  /**
+   * \brief Declares context properties and resources used by step. Used by
+   *        parallel scheduling of steps (see AppInstaller).
+   *
+   * Steps which do not declare dependencies are treated as barriers: they
+   * never run concurrently with any other step. Declaration applies only to
+   * class which makes it: overriding methods of subclass (e.g. backend
+   * specific steps) may use other context fields, so each override should
+   * start with IsExactly() check and subclasses which are safe to run
+   * concurrently have to declare their dependencies again.
+   *
+   * \param dependencies object to be filled
+   *
+   * \return true if dependencies were declared
+   */
+  virtual bool GetDependencies(StepDependencies* /*dependencies*/) const {
+    return false;
+  }
+
   StepErrorSignal on_error;
 
  protected:
+  /** Returns true if dynamic type of step is exactly StepType */
+  template<typename StepType>
+  bool IsExactly() const {
+    return typeid(*this) == typeid(StepType);
+  }
+
   InstallerContext* context_;
 };
 
@@ -0,0 +1,95 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_STEP_STEP_DEPENDENCIES_H_
+#define COMMON_STEP_STEP_DEPENDENCIES_H_
+
+#include <set>
+#include <string>
+
+#include "common/utils/property.h"
+
+namespace common_installer {
+
+/**
+ * Names of resources living outside of InstallerContext which can be
+ * declared in StepDependencies.
+ */
+namespace resource {
+
+/** content of package directory (InstallerContext::pkg_path) */
+constexpr char kPackageDirectory[] = "package-directory";
+/** system icons directory */
+constexpr char kIconDirectory[] = "icon-directory";
+/** pkgmgr parser plugins and data they manage */
+constexpr char kParserPlugins[] = "parser-plugins";
+
+}  // namespace resource
+
+/**
+ * \brief Declares which InstallerContext properties and other resources are
+ *        read and written by step.
+ *
+ * Two steps may run concurrently only if none of them writes anything that
+ * the other one reads or writes.
+ */
+class StepDependencies {
+ public:
+  template<typename T>
+  void Reads(const Property<T>& property) {
+    read_properties_.insert(&property);
+  }
+
+  template<typename T>
+  void Writes(const Property<T>& property) {
+    written_properties_.insert(&property);
+  }
+
+  void Reads(const std::string& resource) {
+    read_resources_.insert(resource);
+  }
+
+  void Writes(const std::string& resource) {
+    written_resources_.insert(resource);
+  }
+
+  template<typename T>
+  bool IsWriting(const Property<T>& property) const {
+    return written_properties_.count(&property) != 0;
+  }
+
+  /**
+   * \brief Checks if steps with given dependencies must be serialized
+   *
+   * \param other dependencies of other step
+   *
+   * \return true if steps cannot run concurrently
+   */
+  bool ConflictsWith(const StepDependencies& other) const {
+    return Overlaps(written_properties_, other.read_properties_) ||
+           Overlaps(written_properties_, other.written_properties_) ||
+           Overlaps(read_properties_, other.written_properties_) ||
+           Overlaps(written_resources_, other.read_resources_) ||
+           Overlaps(written_resources_, other.written_resources_) ||
+           Overlaps(read_resources_, other.written_resources_);
+  }
+
+ private:
+  template<typename T>
+  static bool Overlaps(const std::set<T>& lhs, const std::set<T>& rhs) {
+    for (auto& item : lhs)
+      if (rhs.count(item))
+        return true;
+    return false;
+  }
+
+  std::set<const void*> read_properties_;
+  std::set<const void*> written_properties_;
+  std::set<std::string> read_resources_;
+  std::set<std::string> written_resources_;
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_STEP_STEP_DEPENDENCIES_H_
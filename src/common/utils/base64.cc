@@ -5,9 +5,11 @@
 #include "common/utils/base64.h"
 
 #include <boost/archive/iterators/base64_from_binary.hpp>
+#include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 
 #include <algorithm>
+#include <cctype>
 #include <sstream>
 #include <string>
 
@@ -17,6 +19,8 @@ namespace {
 
 typedef bai::base64_from_binary<bai::transform_width<const char*, 6, 8>>
     base64_encode;
+typedef bai::transform_width<bai::binary_from_base64<const char*>, 8, 6>
+    base64_decode;
 
 }  // namespace
 
@@ -29,4 +33,27 @@ std::string EncodeBase64(const std::string& val) {
   return os.str();
 }
 
+bool DecodeBase64(const std::string& val, std::string* result) {
+  std::string text;
+  text.reserve(val.size());
+  for (char c : val)
+    if (!isspace(static_cast<unsigned char>(c)))
+      text += c;
+  if (text.size() % 4 != 0)
+    return false;
+  size_t padding = 0;
+  while (padding < 2 && !text.empty() && text[text.size() - 1 - padding] == '=')
+    ++padding;
+  // padding is decoded as zero bits and dropped afterwards
+  std::replace(text.end() - padding, text.end(), '=', 'A');
+  try {
+    result->assign(base64_decode(text.c_str()),
+                   base64_decode(text.c_str() + text.size()));
+  } catch (const bai::dataflow_exception&) {
+    return false;
+  }
+  result->resize(result->size() - padding);
+  return true;
+}
+
 }  // namespace common_installer
@@ -11,6 +11,16 @@ namespace common_installer {
 
 std::string EncodeBase64(const std::string& val);
 
+/**
+ * \brief Decodes base64 text. Whitespaces are ignored.
+ *
+ * \param val base64 encoded text
+ * \param result decoded data
+ *
+ * \return true if text was valid base64
+ */
+bool DecodeBase64(const std::string& val, std::string* result);
+
 }  // namespace common_installer
 
 #endif  // COMMON_UTILS_BASE64_H_
@@ -0,0 +1,103 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/directory_fd_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <cerrno>
+#include <vector>
+
+#include "common/utils/sync_registry.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+// extraction works on few directories at a time, reopening evicted one
+// costs single openat() relative to its cached ancestor
+const size_t kMaxCachedDirectories = 64;
+
+}  // namespace
+
+namespace common_installer {
+
+DirectoryFdCache::Directory::Directory(int fd) : fd_(fd) {
+}
+
+DirectoryFdCache::Directory::~Directory() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+DirectoryFdCache::DirectoryFdCache(int root_fd, const bf::path& root)
+    : root_directory_(std::make_shared<Directory>(root_fd)), root_(root) {
+}
+
+std::shared_ptr<DirectoryFdCache::Directory> DirectoryFdCache::Get(
+    const bf::path& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (path.empty() || path == ".")
+    return root_directory_;
+  std::shared_ptr<Directory> directory = FindLocked(path.string());
+  if (directory)
+    return directory;
+
+  // components below nearest cached ancestor are opened one by one
+  std::vector<bf::path> missing;
+  bf::path ancestor = path;
+  std::shared_ptr<Directory> parent;
+  while (!parent) {
+    missing.push_back(ancestor);
+    ancestor = ancestor.parent_path();
+    parent = (ancestor.empty() || ancestor == ".") ?
+        root_directory_ : FindLocked(ancestor.string());
+  }
+  for (auto it = missing.rbegin(); it != missing.rend(); ++it) {
+    std::string name = it->filename().string();
+    if (mkdirat(parent->fd(), name.c_str(), 0777) == 0) {
+      RegisterWrittenDirectory(root_ / it->parent_path());
+    } else if (errno != EEXIST) {
+      LOG(ERROR) << "Failed to create directory: " << *it
+                 << ", errno: " << errno;
+      return nullptr;
+    }
+    int fd = openat(parent->fd(), name.c_str(),
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+      LOG(ERROR) << "Failed to open directory: " << *it
+                 << ", errno: " << errno;
+      return nullptr;
+    }
+    parent = std::make_shared<Directory>(fd);
+    InsertLocked(it->string(), parent);
+  }
+  return parent;
+}
+
+std::shared_ptr<DirectoryFdCache::Directory> DirectoryFdCache::FindLocked(
+    const std::string& path) {
+  auto iter = cache_.find(path);
+  if (iter == cache_.end())
+    return nullptr;
+  lru_.splice(lru_.begin(), lru_, iter->second.second);
+  return iter->second.first;
+}
+
+void DirectoryFdCache::InsertLocked(
+    const std::string& path, const std::shared_ptr<Directory>& directory) {
+  lru_.push_front(path);
+  cache_[path] = std::make_pair(directory, lru_.begin());
+  if (lru_.size() > kMaxCachedDirectories) {
+    // descriptor is closed once users of evicted directory drop it
+    cache_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+}  // namespace common_installer
@@ -0,0 +1,89 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_DIRECTORY_FD_CACHE_H_
+#define COMMON_UTILS_DIRECTORY_FD_CACHE_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Descriptors of directories created during extraction, keyed by path
+ *        relative to extraction root. Missing directories are created on
+ *        demand. Symlinks are never followed.
+ *
+ * Only recently used directories are kept open, others are reopened
+ * relative to their nearest cached ancestor, so that packages with many
+ * directories do not exhaust descriptors of process.
+ *
+ * Object is thread-safe.
+ */
+class DirectoryFdCache {
+ public:
+  /**
+   * \brief Open directory, closed when last reference to it is dropped, so
+   *        that it stays valid while used even if cache evicts it.
+   */
+  class Directory {
+   public:
+    explicit Directory(int fd);
+    ~Directory();
+
+    int fd() const { return fd_; }
+
+   private:
+    int fd_;
+
+    DISALLOW_COPY_AND_ASSIGN(Directory);
+  };
+
+  /**
+   * Constructor
+   *
+   * \param root_fd descriptor of extraction root, owned by cache
+   * \param root path of extraction root, used to register created
+   *             directories for sync (see RegisterWrittenDirectory())
+   */
+  DirectoryFdCache(int root_fd, const boost::filesystem::path& root);
+
+  /**
+   * \brief Returns directory, creating it if needed
+   *
+   * \param path path relative to root, empty for root itself
+   *
+   * \return open directory or nullptr on error
+   */
+  std::shared_ptr<Directory> Get(const boost::filesystem::path& path);
+
+ private:
+  typedef std::list<std::string> LruList;
+
+  std::shared_ptr<Directory> FindLocked(const std::string& path);
+  void InsertLocked(const std::string& path,
+                    const std::shared_ptr<Directory>& directory);
+
+  std::shared_ptr<Directory> root_directory_;
+  boost::filesystem::path root_;
+  // most recently used first
+  LruList lru_;
+  std::map<std::string,
+           std::pair<std::shared_ptr<Directory>, LruList::iterator>> cache_;
+  std::mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectoryFdCache);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_DIRECTORY_FD_CACHE_H_
@@ -0,0 +1,179 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/file_copy.h"
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/utils/byte_size_literals.h"
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+namespace {
+
+const size_t kCopyBufferSize = 256_kB;
+
+bool CopyBuffered(int in_fd, int out_fd, uint64_t size) {
+  std::unique_ptr<char[]> buffer(new char[kCopyBufferSize]);
+  off64_t offset = 0;
+  while (size > 0) {
+    ssize_t count = pread64(in_fd, buffer.get(),
+                            std::min<uint64_t>(size, kCopyBufferSize),
+                            offset);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (count == 0) {
+      errno = EIO;
+      return false;
+    }
+    const char* data = buffer.get();
+    size_t left = count;
+    while (left > 0) {
+      ssize_t written = write(out_fd, data, left);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      data += written;
+      left -= written;
+    }
+    offset += count;
+    size -= count;
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+bool CopyRangeInKernel(int in_fd, off64_t offset, int out_fd, uint64_t size) {
+  bool copy_file_range_supported = true;
+  while (size > 0) {
+    ssize_t copied = -1;
+#ifdef __NR_copy_file_range
+    if (copy_file_range_supported) {
+      loff_t in_offset = offset;
+      copied = syscall(__NR_copy_file_range, in_fd, &in_offset, out_fd,
+                       nullptr, size, 0);
+      if (copied < 0 && errno != EINTR) {
+        if (errno != ENOSYS && errno != EXDEV && errno != EINVAL &&
+            errno != EOPNOTSUPP)
+          return false;
+        copy_file_range_supported = false;
+      }
+    }
+#else
+    copy_file_range_supported = false;
+#endif
+    if (!copy_file_range_supported) {
+      off_t in_offset = offset;
+      copied = sendfile(out_fd, in_fd, &in_offset, size);
+    }
+    if (copied < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (copied == 0) {
+      // unexpected end of source
+      errno = EIO;
+      return false;
+    }
+    offset += copied;
+    size -= copied;
+  }
+  return true;
+}
+
+bool CloneFile(int in_fd, int out_fd) {
+  return ioctl(out_fd, FICLONE, in_fd) == 0;
+}
+
+bool CopyFileContent(int in_fd, int out_fd, uint64_t size) {
+  if (size == 0)
+    return true;
+  if (CloneFile(in_fd, out_fd))
+    return true;
+  if (CopyRangeInKernel(in_fd, 0, out_fd, size))
+    return true;
+  // start over, kernel copy may have failed in the middle
+  if (ftruncate(out_fd, 0) != 0 || lseek64(out_fd, 0, SEEK_SET) != 0)
+    return false;
+  return CopyBuffered(in_fd, out_fd, size);
+}
+
+bool CopyFileDurably(const char* src, const char* dst, int open_flags) {
+  int in = open(src, O_RDONLY | O_CLOEXEC);
+  if (in < 0)
+    return false;
+  struct stat info;
+  if (fstat(in, &info) != 0) {
+    close(in);
+    return false;
+  }
+  int out = open(dst, O_WRONLY | O_CREAT | O_CLOEXEC | open_flags,
+                 info.st_mode & 07777);
+  if (out < 0) {
+    int error = errno;
+    close(in);
+    errno = error;
+    return false;
+  }
+  bool result = CopyFileContent(in, out, info.st_size) &&
+      fdatasync(out) == 0;
+  int error = errno;
+  close(in);
+  if (close(out) != 0)
+    result = false;
+  errno = error;
+  return result;
+}
+
+bool CopyExtendedAttributes(int in_fd, int out_fd) {
+  ssize_t size = flistxattr(in_fd, nullptr, 0);
+  if (size < 0)
+    return errno == ENOTSUP;
+  std::vector<char> names(size);
+  if (size > 0) {
+    size = flistxattr(in_fd, names.data(), names.size());
+    if (size < 0)
+      return false;
+  }
+  std::vector<char> value;
+  // list holds null terminated names
+  for (const char* name = names.data(); name < names.data() + size;
+       name += strlen(name) + 1) {
+    ssize_t value_size = fgetxattr(in_fd, name, nullptr, 0);
+    if (value_size < 0)
+      return false;
+    value.resize(value_size);
+    value_size = fgetxattr(in_fd, name, value.data(), value.size());
+    if (value_size < 0 ||
+        fsetxattr(out_fd, name, value.data(), value_size, 0) != 0)
+      return false;
+  }
+  return true;
+}
+
+}  // namespace common_installer
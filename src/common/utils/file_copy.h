@@ -0,0 +1,81 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_FILE_COPY_H_
+#define COMMON_UTILS_FILE_COPY_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+
+namespace common_installer {
+
+/**
+ * \brief Copies data between descriptors inside the kernel, using
+ *        copy_file_range() or sendfile(). Output is written at current
+ *        position of out_fd.
+ *
+ * \param in_fd source descriptor
+ * \param offset offset of data in source
+ * \param out_fd destination descriptor
+ * \param size number of bytes to copy
+ *
+ * \return false if data could not be copied this way, caller may fall back
+ *         to buffered copy if nothing was written yet
+ */
+bool CopyRangeInKernel(int in_fd, off64_t offset, int out_fd, uint64_t size);
+
+/**
+ * \brief Makes content of out_fd a reflink of in_fd (FICLONE), sharing
+ *        blocks on copy-on-write filesystems.
+ *
+ * \param in_fd source descriptor
+ * \param out_fd destination descriptor
+ *
+ * \return false if filesystem does not support it
+ */
+bool CloneFile(int in_fd, int out_fd);
+
+/**
+ * \brief Copies whole content of regular file into empty file. Tries
+ *        reflink (FICLONE, shares blocks on copy-on-write filesystems) first,
+ *        then copying inside the kernel and then buffered copy.
+ *
+ * \param in_fd source descriptor
+ * \param out_fd destination descriptor, positioned at its beginning
+ * \param size size of source file
+ *
+ * \return true on success
+ */
+bool CopyFileContent(int in_fd, int out_fd, uint64_t size);
+
+/**
+ * \brief Copies regular file with its permission bits and flushes the copy
+ *        with fdatasync(), so source may be removed safely afterwards.
+ *
+ * \param src source file
+ * \param dst destination file, created if missing
+ * \param open_flags additional flags for opening destination, e.g. O_EXCL
+ *        or O_TRUNC
+ *
+ * \return true on success, false with errno set otherwise
+ */
+bool CopyFileDurably(const char* src, const char* dst, int open_flags);
+
+/**
+ * \brief Copies all extended attributes readable by the process (e.g.
+ *        security.SMACK64 labels) from one file to another. Existing
+ *        attributes of destination with the same names are replaced.
+ *
+ * \param in_fd source descriptor
+ * \param out_fd destination descriptor
+ *
+ * \return true on success or if filesystem of source has no extended
+ *         attributes, false with errno set otherwise
+ */
+bool CopyExtendedAttributes(int in_fd, int out_fd);
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_FILE_COPY_H_
@@ -0,0 +1,98 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/file_digests.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <cerrno>
+
+#include "common/utils/byte_size_literals.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+const size_t kReadBufferSize = 64_kB;
+
+}  // namespace
+
+namespace common_installer {
+
+DigestCalculator::DigestCalculator(unsigned algorithms)
+    : sha256_(nullptr),
+      sha512_(nullptr) {
+  if (algorithms & DIGEST_SHA256) {
+    sha256_ = EVP_MD_CTX_create();
+    EVP_DigestInit_ex(sha256_, EVP_sha256(), nullptr);
+  }
+  if (algorithms & DIGEST_SHA512) {
+    sha512_ = EVP_MD_CTX_create();
+    EVP_DigestInit_ex(sha512_, EVP_sha512(), nullptr);
+  }
+}
+
+DigestCalculator::~DigestCalculator() {
+  if (sha256_)
+    EVP_MD_CTX_destroy(sha256_);
+  if (sha512_)
+    EVP_MD_CTX_destroy(sha512_);
+}
+
+void DigestCalculator::Update(const void* data, size_t size) {
+  if (sha256_)
+    EVP_DigestUpdate(sha256_, data, size);
+  if (sha512_)
+    EVP_DigestUpdate(sha512_, data, size);
+}
+
+FileDigests DigestCalculator::Finish() {
+  FileDigests digests;
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned size = 0;
+  if (sha256_) {
+    EVP_DigestFinal_ex(sha256_, digest, &size);
+    digests.sha256.assign(reinterpret_cast<char*>(digest), size);
+    EVP_MD_CTX_destroy(sha256_);
+    sha256_ = nullptr;
+  }
+  if (sha512_) {
+    EVP_DigestFinal_ex(sha512_, digest, &size);
+    digests.sha512.assign(reinterpret_cast<char*>(digest), size);
+    EVP_MD_CTX_destroy(sha512_);
+    sha512_ = nullptr;
+  }
+  return digests;
+}
+
+bool CalculateFileDigests(const bf::path& path, unsigned algorithms,
+                          FileDigests* digests) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open file: " << path;
+    return false;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  DigestCalculator calculator(algorithms);
+  char buffer[kReadBufferSize];
+  ssize_t count;
+  while ((count = read(fd, buffer, sizeof(buffer))) != 0) {
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG(ERROR) << "Failed to read file: " << path;
+      close(fd);
+      return false;
+    }
+    calculator.Update(buffer, count);
+  }
+  close(fd);
+  *digests = calculator.Finish();
+  return true;
+}
+
+}  // namespace common_installer
@@ -0,0 +1,84 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_FILE_DIGESTS_H_
+#define COMMON_UTILS_FILE_DIGESTS_H_
+
+#include <boost/filesystem/path.hpp>
+#include <openssl/evp.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * Digest algorithms, may be combined as flags
+ */
+enum DigestAlgorithm : unsigned {
+  DIGEST_SHA256 = 1 << 0,
+  DIGEST_SHA512 = 1 << 1
+};
+
+/**
+ * \brief Binary digests of file content. Digest is empty if it was not
+ *        calculated.
+ */
+struct FileDigests {
+  std::string sha256;
+  std::string sha512;
+};
+
+/**
+ * Digests of package files keyed by path relative to package root
+ */
+using DigestTable = std::unordered_map<std::string, FileDigests>;
+
+/**
+ * \brief Calculates digests of data passed in chunks
+ */
+class DigestCalculator {
+ public:
+  /**
+   * Constructor
+   *
+   * \param algorithms combination of DigestAlgorithm flags
+   */
+  explicit DigestCalculator(unsigned algorithms);
+  ~DigestCalculator();
+
+  void Update(const void* data, size_t size);
+
+  /**
+   * \brief Finishes calculation. Object cannot be updated afterwards.
+   *
+   * \return calculated digests
+   */
+  FileDigests Finish();
+
+ private:
+  EVP_MD_CTX* sha256_;
+  EVP_MD_CTX* sha512_;
+
+  DISALLOW_COPY_AND_ASSIGN(DigestCalculator);
+};
+
+/**
+ * \brief Calculates digests of file by reading it
+ *
+ * \param path path to file
+ * \param algorithms combination of DigestAlgorithm flags
+ * \param digests calculated digests
+ *
+ * \return true if file was read
+ */
+bool CalculateFileDigests(const boost::filesystem::path& path,
+                          unsigned algorithms, FileDigests* digests);
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_FILE_DIGESTS_H_
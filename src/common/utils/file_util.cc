@@ -2,10 +2,11 @@
 
 #include "common/utils/file_util.h"
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <sys/stat.h>
-#include <linux/limits.h>
-#include <unzip.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <zlib.h>
 
 #include <boost/algorithm/string/classification.hpp>
@@ -16,10 +17,23 @@
 #include <manifest_parser/utils/logging.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
-#include "common/utils/byte_size_literals.h"
+#include "common/utils/file_copy.h"
+#include "common/utils/sync_registry.h"
+#include "common/utils/thread_pool.h"
+#include "common/utils/tree_mover.h"
+#include "common/utils/zip_extractor.h"
+#include "common/utils/zip_index.h"
 
 namespace ba = boost::algorithm;
 namespace bs = boost::system;
@@ -27,9 +41,6 @@ namespace bf = boost::filesystem;
 
 namespace {
 
-unsigned kZipBufSize = 8_kB;
-unsigned kZipMaxPath = PATH_MAX;
-
 int64_t GetBlockSizeForPath(const bf::path& path_in_partition) {
   struct stat stats;
   if (stat(path_in_partition.string().c_str(), &stats)) {
@@ -44,47 +55,399 @@ int64_t RoundUpToBlockSizeOf(int64_t size, int64_t block_size) {
   return ((size + block_size - 1) / block_size) * block_size;
 }
 
-class UnzFilePointer {
+// Copies content of directory tree using thread pool. Every directory is
+// listed by separate task, which creates subdirectories in destination and
+// submits tasks for them and for every file. Files are cloned (reflink) if
+// filesystem supports it, otherwise copied inside the kernel.
+//
+// Follows semantics of former recursive implementation: symlinks to
+// directories are copied as directories, other symlinks as symlinks. With
+// FS_MERGE_DIRECTORIES existing directories are merged and existing files
+// and symlinks are left untouched.
+class TreeCopier {
  public:
-  UnzFilePointer()
-    : zipFile_(nullptr),
-      fileOpened_(false),
-      currentFileOpened_(false) { }
-
-  ~UnzFilePointer() {
-    if (currentFileOpened_)
-      unzCloseCurrentFile(zipFile_);
-    if (fileOpened_)
-      unzClose(zipFile_);
-  }
-
-  bool Open(const char* zip_path) {
-    zipFile_ = static_cast<unzFile*>(unzOpen(zip_path));
-    if (!zipFile_)
-       return false;
-    fileOpened_ = true;
-    return true;
+  TreeCopier(common_installer::FSFlag flags,
+             const std::set<std::string>& skipped)
+      : merge_(flags & common_installer::FS_MERGE_DIRECTORIES),
+        skipped_(skipped),
+        failed_(false) {
+  }
+
+  bool Copy(const bf::path& src, const bf::path& dst) {
+    // skipped entries are looked up by path relative to src
+    root_ = src.string();
+    while (root_.size() > 1 && root_.back() == '/')
+      root_.pop_back();
+    pool_.Submit([this, src, dst] { CopyDirectoryContent(src, dst); });
+    pool_.Wait();
+    return !failed_;
+  }
+
+ private:
+  void Fail() {
+    failed_ = true;
+  }
+
+  void CopyDirectoryContent(const bf::path& src, const bf::path& dst) {
+    if (failed_)
+      return;
+    try {
+      for (bf::directory_iterator file(src);
+          file != bf::directory_iterator();
+          ++file) {
+        bf::path current(file->path());
+        bf::path target = dst / current.filename();
+        if (!skipped_.empty() &&
+            skipped_.count(current.string().substr(root_.size() + 1)))
+          continue;
+        struct stat info;
+        if (lstat(current.c_str(), &info) != 0) {
+          LOG(ERROR) << "Failed to stat " << current << ", errno: " << errno;
+          Fail();
+          return;
+        }
+        // symlinks to directories are followed
+        if (S_ISLNK(info.st_mode) && stat(current.c_str(), &info) == 0 &&
+            !S_ISDIR(info.st_mode))
+          info.st_mode = S_IFLNK;
+        if (S_ISDIR(info.st_mode)) {
+          if (!CreateTargetDirectory(target))
+            return;
+          pool_.Submit([this, current, target] {
+            CopyDirectoryContent(current, target);
+          });
+        } else if (S_ISLNK(info.st_mode)) {
+          if (!CopySymlink(current, target))
+            return;
+        } else if (S_ISREG(info.st_mode)) {
+          pool_.Submit([this, current, target] {
+            if (!failed_ && !CopyRegularFile(current, target))
+              Fail();
+          });
+        } else {
+          LOG(ERROR) << "Cannot copy " << current << ", not a regular file";
+          Fail();
+          return;
+        }
+      }
+    } catch (const bf::filesystem_error& error) {
+      LOG(ERROR) << "Failed to copy directory: " << error.what();
+      Fail();
+    }
   }
 
-  bool OpenCurrent() {
-    if (unzOpenCurrentFile(zipFile_) != UNZ_OK)
+  bool CreateTargetDirectory(const bf::path& target) {
+    if (mkdir(target.c_str(), 0777) == 0) {
+      common_installer::RegisterWrittenDirectory(target.parent_path());
+      return true;
+    }
+    if (errno == EEXIST && merge_)
+      return true;
+    LOG(ERROR) << "Failed to create directory " << target
+               << ", errno: " << errno;
+    Fail();
+    return false;
+  }
+
+  bool CopySymlink(const bf::path& current, const bf::path& target) {
+    bs::error_code error;
+    bf::path link = bf::read_symlink(current, error);
+    if (!error && symlink(link.c_str(), target.c_str()) == 0) {
+      common_installer::RegisterWrittenDirectory(target.parent_path());
+      return true;
+    }
+    if (!error && errno == EEXIST && merge_)
+      return true;
+    LOG(ERROR) << "Failed to copy symlink " << current << " to " << target;
+    Fail();
+    return false;
+  }
+
+  bool CopyRegularFile(const bf::path& current, const bf::path& target) {
+    int in = open(current.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+      LOG(ERROR) << "Failed to open " << current << ", errno: " << errno;
       return false;
-    currentFileOpened_ = true;
+    }
+    struct stat info;
+    if (fstat(in, &info) != 0) {
+      LOG(ERROR) << "Failed to stat " << current << ", errno: " << errno;
+      close(in);
+      return false;
+    }
+    int out = open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                   info.st_mode & 07777);
+    if (out < 0) {
+      bool skip = errno == EEXIST && merge_;
+      if (!skip)
+        LOG(ERROR) << "Failed to create " << target << ", errno: " << errno;
+      close(in);
+      return skip;
+    }
+    bool result = common_installer::CopyFileContent(in, out, info.st_size);
+    if (!result)
+      LOG(ERROR) << "Failed to copy " << current << " to " << target
+                 << ", errno: " << errno;
+    close(in);
+    if (close(out) != 0)
+      result = false;
+    if (result)
+      common_installer::RegisterWrittenFile(target);
+    return result;
+  }
+
+  bool merge_;
+  const std::set<std::string>& skipped_;
+  std::string root_;
+  std::atomic<bool> failed_;
+  common_installer::ThreadPool pool_;
+};
+
+// layout of records returned by getdents64
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  uint16_t d_reclen;
+  uint8_t d_type;
+  char d_name[1];
+};
+
+const size_t kDirentBufferSize = 32 * 1024;
+// RENAME_EXCHANGE flag of renameat2(), not exposed by older headers
+const unsigned kRenameExchange = 1 << 1;
+// directories up to this depth are emptied by separate tasks
+const unsigned kMaxParallelRemoveDepth = 3;
+
+// Calls callback for every entry of directory except "." and "..", with its
+// name and d_type (DT_UNKNOWN if filesystem does not report types).
+// Callback returns false and sets errno to stop. Returns 0 or errno.
+int ForEachDirectoryEntry(
+    int fd, const std::function<bool(const char*, uint8_t)>& callback) {
+  std::unique_ptr<char[]> buffer(new char[kDirentBufferSize]);
+  while (true) {
+    long count = syscall(SYS_getdents64, fd, buffer.get(), kDirentBufferSize);
+    if (count < 0)
+      return errno;
+    if (count == 0)
+      return 0;
+    for (long pos = 0; pos < count;) {
+      const LinuxDirent64* entry =
+          reinterpret_cast<const LinuxDirent64*>(buffer.get() + pos);
+      pos += entry->d_reclen;
+      const char* name = entry->d_name;
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        continue;
+      if (!callback(name, entry->d_type))
+        return errno ? errno : EIO;
+    }
+  }
+}
+
+// Removes directory tree with getdents64() and unlinkat() relative to
+// directory descriptors, so no entry needs stat() unless filesystem does not
+// report its type. Subdirectories near the root are emptied in parallel,
+// and removed afterwards from the deepest ones.
+class TreeRemover {
+ public:
+  TreeRemover() : error_(0) { }
+
+  int Remove(const bf::path& root) {
+    EmptyDirectory(root, 0);
+    if (pool_) {
+      pool_->Wait();
+      // children were submitted after their parents
+      for (auto it = emptied_.rbegin(); it != emptied_.rend(); ++it) {
+        if (rmdir(it->c_str()) != 0 && errno != ENOENT)
+          SetError(errno);
+      }
+    }
+    if (error_ == 0 && rmdir(root.c_str()) != 0 && errno != ENOENT)
+      SetError(errno);
+    return error_;
+  }
+
+ private:
+  void SetError(int error) {
+    int expected = 0;
+    error_.compare_exchange_strong(expected, error);
+  }
+
+  void EmptyDirectory(const bf::path& path, unsigned depth) {
+    if (error_ != 0)
+      return;
+    int fd = open(path.c_str(),
+                  O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+      if (errno != ENOENT)
+        SetError(errno);
+      return;
+    }
+    std::vector<std::string> subdirs;
+    if (!RemoveEntries(fd, &subdirs)) {
+      close(fd);
+      return;
+    }
+    for (auto& name : subdirs) {
+      if (depth < kMaxParallelRemoveDepth) {
+        SubmitSubdirectory(path / name, depth + 1);
+      } else {
+        EmptyDirectory(path / name, depth + 1);
+        if (unlinkat(fd, name.c_str(), AT_REMOVEDIR) != 0 && errno != ENOENT)
+          SetError(errno);
+      }
+    }
+    close(fd);
+  }
+
+  void SubmitSubdirectory(const bf::path& path, unsigned depth) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      emptied_.push_back(path);
+      // root is listed on caller thread, nothing runs in pool yet
+      if (!pool_)
+        pool_.reset(new common_installer::ThreadPool());
+    }
+    pool_->Submit([this, path, depth] { EmptyDirectory(path, depth); });
+  }
+
+  // unlinks all non-directory entries, returns names of subdirectories
+  bool RemoveEntries(int fd, std::vector<std::string>* subdirs) {
+    int error = ForEachDirectoryEntry(fd,
+        [this, fd, subdirs](const char* name, uint8_t type) {
+          bool is_directory = type == DT_DIR;
+          if (type == DT_UNKNOWN) {
+            struct stat info;
+            if (fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0)
+              return errno == ENOENT;
+            is_directory = S_ISDIR(info.st_mode);
+          }
+          if (is_directory) {
+            subdirs->emplace_back(name);
+            return true;
+          }
+          return unlinkat(fd, name, 0) == 0 || errno == ENOENT;
+        });
+    if (error != 0) {
+      SetError(error);
+      return false;
+    }
+    return true;
+  }
+
+  std::atomic<int> error_;
+  std::mutex mutex_;
+  std::vector<bf::path> emptied_;
+  std::unique_ptr<common_installer::ThreadPool> pool_;
+};
+
+// directories up to this depth are measured by separate tasks
+const unsigned kMaxParallelSizeDepth = 2;
+
+// Reads size of directory entry, and its type if d_type did not tell it.
+// Asks statx() only for needed fields, so filesystem may skip the rest.
+bool StatEntry(int dir_fd, const char* name, uint8_t type, uint64_t* size,
+               bool* is_directory) {
+#ifdef STATX_SIZE
+  struct statx buf;
+  unsigned mask = STATX_SIZE | (type == DT_UNKNOWN ? STATX_TYPE : 0);
+  if (statx(dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask,
+            &buf) == 0) {
+    *size = buf.stx_size;
+    *is_directory =
+        type == DT_UNKNOWN ? S_ISDIR(buf.stx_mode) : type == DT_DIR;
     return true;
   }
+  if (errno != ENOSYS)
+    return false;
+#endif
+  struct stat info;
+  if (fstatat(dir_fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0)
+    return false;
+  *size = info.st_size;
+  *is_directory = S_ISDIR(info.st_mode);
+  return true;
+}
 
-  void CloseCurrent() {
-    if (currentFileOpened_)
-      unzCloseCurrentFile(zipFile_);
-    currentFileOpened_ = false;
+// Sums sizes of all entries of directory tree, each rounded up to block
+// size. Entries are listed with getdents64() and measured relative to
+// directory descriptor. Subdirectories near the root are measured in
+// parallel.
+class TreeSizer {
+ public:
+  explicit TreeSizer(int64_t block_size)
+      : block_size_(block_size),
+        total_(0),
+        error_(0) {
   }
 
-  unzFile* Get() { return zipFile_; }
+  int64_t Measure(const bf::path& root) {
+    MeasureDirectory(root, 0);
+    if (pool_)
+      pool_->Wait();
+    if (error_ != 0) {
+      LOG(ERROR) << "Failed to measure " << root << ", errno: " << error_;
+      return -1;
+    }
+    return total_;
+  }
 
  private:
-  unzFile* zipFile_;
-  bool fileOpened_;
-  bool currentFileOpened_;
+  void SetError(int error) {
+    int expected = 0;
+    error_.compare_exchange_strong(expected, error);
+  }
+
+  void MeasureDirectory(const bf::path& path, unsigned depth) {
+    if (error_ != 0)
+      return;
+    int fd = open(path.c_str(),
+                  O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+      SetError(errno);
+      return;
+    }
+    std::vector<std::string> subdirs;
+    int64_t size = 0;
+    int error = ForEachDirectoryEntry(fd,
+        [this, fd, &subdirs, &size](const char* name, uint8_t type) {
+          uint64_t entry_size;
+          bool is_directory;
+          if (!StatEntry(fd, name, type, &entry_size, &is_directory))
+            return errno == ENOENT;
+          size += RoundUpToBlockSizeOf(entry_size, block_size_);
+          if (is_directory)
+            subdirs.emplace_back(name);
+          return true;
+        });
+    close(fd);
+    if (error != 0) {
+      SetError(error);
+      return;
+    }
+    total_ += size;
+    for (auto& name : subdirs) {
+      bf::path subdir = path / name;
+      if (depth < kMaxParallelSizeDepth) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          // root is listed on caller thread, nothing runs in pool yet
+          if (!pool_)
+            pool_.reset(new common_installer::ThreadPool());
+        }
+        pool_->Submit([this, subdir, depth] {
+          MeasureDirectory(subdir, depth + 1);
+        });
+      } else {
+        MeasureDirectory(subdir, depth + 1);
+      }
+    }
+  }
+
+  int64_t block_size_;
+  std::atomic<int64_t> total_;
+  std::atomic<int> error_;
+  std::mutex mutex_;
+  std::unique_ptr<common_installer::ThreadPool> pool_;
 };
 
 }  // namespace
@@ -119,7 +482,8 @@ bool SetDirPermissions(const boost::filesystem::path& path,
   return true;
 }
 
-bool CopyDir(const bf::path& src, const bf::path& dst, FSFlag flags) {
+bool CopyDir(const bf::path& src, const bf::path& dst, FSFlag flags,
+             const std::set<std::string>& skipped) {
   try {
     // Check whether the function call is valid
     if (!bf::exists(src) || !bf::is_directory(src)) {
@@ -144,34 +508,10 @@ bool CopyDir(const bf::path& src, const bf::path& dst, FSFlag flags) {
     LOG(ERROR) << "Failed to copy directory: " << error.what();
     return false;
   }
+  RegisterWrittenDirectory(dst.parent_path());
 
-  // Iterate through the source directory
-  for (bf::directory_iterator file(src);
-      file != bf::directory_iterator();
-      ++file) {
-    try {
-      bf::path current(file->path());
-      bf::path target = dst / current.filename();
-      if (bf::is_directory(current)) {
-        // Found directory: Recursion
-        if (!CopyDir(current, target, flags)) {
-          return false;
-        }
-      } else if (bf::is_symlink(current)) {
-        if ((flags & FS_MERGE_DIRECTORIES) && bf::exists(target))
-          continue;
-        bf::copy_symlink(current, target);
-      } else {
-        if ((flags & FS_MERGE_DIRECTORIES) && bf::exists(target))
-          continue;
-        bf::copy_file(current, target);
-      }
-    } catch (const bf::filesystem_error& error) {
-      LOG(ERROR) << "Failed to copy directory: " << error.what();
-      return false;
-    }
-  }
-  return true;
+  TreeCopier copier(flags, skipped);
+  return copier.Copy(src, dst);
 }
 
 bool CopyFile(const bf::path& src, const bf::path& dst) {
@@ -182,30 +522,112 @@ bool CopyFile(const bf::path& src, const bf::path& dst) {
     LOG(WARNING) << "copy file " << src << " due to error [" << error << "]";
     return false;
   }
+  RegisterWrittenFile(dst);
+  return true;
+}
+
+bool RemoveTree(const bf::path& path, bs::error_code* error) {
+  if (error)
+    error->clear();
+  struct stat info;
+  if (lstat(path.c_str(), &info) != 0) {
+    if (errno == ENOENT)
+      return true;
+    if (error)
+      *error = bs::error_code(errno, bs::system_category());
+    return false;
+  }
+  int result = 0;
+  if (!S_ISDIR(info.st_mode)) {
+    if (unlink(path.c_str()) != 0 && errno != ENOENT)
+      result = errno;
+  } else {
+    TreeRemover remover;
+    result = remover.Remove(path);
+  }
+  if (result != 0) {
+    LOG(ERROR) << "Failed to remove " << path << ", errno: " << result;
+    if (error)
+      *error = bs::error_code(result, bs::system_category());
+    return false;
+  }
+  ForgetWrittenPaths(path);
+  RegisterWrittenDirectory(path.parent_path());
   return true;
 }
 
 bool MoveDir(const bf::path& src, const bf::path& dst, FSFlag flags) {
-  if (bf::exists(dst) && !(flags & FS_MERGE_DIRECTORIES)) {
+  // destination of interrupted move is completed below, it is never
+  // renamed over as that would leave its journal behind
+  bool resume = bf::exists(TreeMover::JournalPath(dst));
+  if (bf::exists(dst) && !(flags & FS_MERGE_DIRECTORIES) && !resume) {
     LOG(ERROR) << "Destination directory does exist: " << dst;
     return false;
   }
 
   bs::error_code error;
-  bf::rename(src, dst, error);
-  if (error) {
-    LOG(WARNING) << "Cannot move directory: " << src << ". Will copy/remove...";
-    if (!CopyDir(src, dst, flags)) {
-      LOG(ERROR) << "Cannot copy directory: " << src;
-      return false;
-    }
-    bf::remove_all(src, error);
-    if (error) {
-      LOG(ERROR) << "Cannot remove old directory when coping: " << src;
+  if (!resume)
+    bf::rename(src, dst, error);
+  if (resume || error) {
+    LOG(WARNING) << "Cannot move directory: " << src
+                 << ". Will move it file by file...";
+    TreeMover mover(src, dst, flags & FS_MERGE_DIRECTORIES);
+    if (!mover.Move()) {
+      LOG(ERROR) << "Cannot move directory: " << src;
       return false;
     }
   }
+  MoveWrittenPaths(src, dst);
+  RegisterWrittenDirectory(src.parent_path());
+  RegisterWrittenDirectory(dst.parent_path());
+  return true;
+}
+
+bool RenameDir(const bf::path& src, const bf::path& dst) {
+  struct stat src_stat;
+  struct stat dst_stat;
+  if (stat(src.c_str(), &src_stat) != 0 ||
+      stat(dst.parent_path().c_str(), &dst_stat) != 0) {
+    LOG(ERROR) << "Cannot stat: " << src << " or " << dst.parent_path()
+               << ", errno: " << errno;
+    return false;
+  }
+  if (src_stat.st_dev != dst_stat.st_dev) {
+    LOG(ERROR) << "Cannot rename " << src << " to " << dst
+               << ", different filesystems";
+    return false;
+  }
+  if (rename(src.c_str(), dst.c_str()) != 0) {
+    LOG(ERROR) << "Cannot rename " << src << " to " << dst
+               << ", errno: " << errno;
+    return false;
+  }
+  MoveWrittenPaths(src, dst);
+  RegisterWrittenDirectory(src.parent_path());
+  RegisterWrittenDirectory(dst.parent_path());
+  return true;
+}
+
+bool ExchangePaths(const bf::path& first, const bf::path& second) {
+#ifdef SYS_renameat2
+  if (syscall(SYS_renameat2, AT_FDCWD, first.c_str(), AT_FDCWD,
+              second.c_str(), kRenameExchange) != 0) {
+    int error = errno;
+    LOG(ERROR) << "Cannot exchange " << first << " and " << second
+               << ", errno: " << error;
+    errno = error;
+    return false;
+  }
+  ExchangeWrittenPaths(first, second);
+  RegisterWrittenDirectory(first.parent_path());
+  RegisterWrittenDirectory(second.parent_path());
   return true;
+#else
+  LOG(ERROR) << "Cannot exchange " << first << " and " << second
+             << ", renameat2() is not available";
+  errno = ENOSYS;
+  return false;
+#endif
 }
 
 bool MoveFile(const bf::path& src, const bf::path& dst) {
@@ -216,21 +638,31 @@ bool MoveFile(const bf::path& src, const bf::path& dst) {
   if (error) {
     LOG(WARNING) << "Cannot move file: " << src <<
         ". Will copy/remove... with error [" << error << "]";
-    bf::copy_file(src, dst, bf::copy_option::overwrite_if_exists, error);
-    if (error) {
+    // copy must be durable before source is removed
+    if (!CopyFileDurably(src.c_str(), dst.c_str(), O_TRUNC)) {
       LOG(WARNING) << "Cannot copy file " << src <<
-          " due to error [" << error << "]";
+          " due to error [" << errno << "]";
       return false;
     }
-    bf::remove_all(src, error);
-    if (error) {
+    RegisterWrittenDirectory(dst.parent_path());
+    if (!RemoveTree(src, &error)) {
       LOG(ERROR) << "Cannot remove old file when coping: " << src <<
           "with error [" << error << "]";
     }
   }
+  MoveWrittenPaths(src, dst);
+  RegisterWrittenDirectory(src.parent_path());
+  RegisterWrittenDirectory(dst.parent_path());
   return true;
 }
 
+std::string GetPathIdentity(const bf::path& path) {
+  struct stat info;
+  if (lstat(path.c_str(), &info) != 0)
+    return std::string();
+  return std::to_string(info.st_dev) + ":" + std::to_string(info.st_ino);
+}
+
 int64_t GetUnpackedPackageSize(const bf::path& path) {
   int64_t size = 0;
   int64_t block_size = GetBlockSizeForPath(path);
@@ -239,56 +671,29 @@ int64_t GetUnpackedPackageSize(const bf::path& path) {
   if (block_size == -1)
     return -1;
 
-  unz_global_info info;
-  unz_file_info64 raw_file_info;
-  char raw_file_name_in_zip[kZipMaxPath];
-
-  unzFile* zip_file = static_cast<unzFile*>(unzOpen(path.string().c_str()));
-  if (zip_file == nullptr) {
-    LOG(ERROR) << "Failed to open the source dir: " << path.string();
+  std::shared_ptr<const ZipIndex> index = ZipIndex::Open(path);
+  if (!index) {
+    LOG(ERROR) << "Failed to read archive: " << path.string();
     return -1;
   }
 
-  if (unzGetGlobalInfo(zip_file, &info) != UNZ_OK) {
-    LOG(ERROR) << "Failed to read global info";
-    unzClose(zip_file);
-    return -1;
-  }
-
-  for (uLong i = 0; i < info.number_entry; i++) {
-    if (unzGetCurrentFileInfo64(zip_file, &raw_file_info, raw_file_name_in_zip,
-        sizeof(raw_file_name_in_zip), nullptr, 0, nullptr, 0) != UNZ_OK) {
-      LOG(ERROR) << "Failed to read file info";
-      unzClose(zip_file);
-      return -1;
-    }
-    size += RoundUpToBlockSizeOf(raw_file_info.uncompressed_size, block_size);
-    unzGoToNextFile(zip_file);
-  }
+  for (auto& entry : index->entries())
+    size += RoundUpToBlockSizeOf(entry.uncompressed_size, block_size);
 
   // FIXME: calculate space needed for directories
-  unzClose(zip_file);
   return size;
 }
 
 int64_t GetDirectorySize(const boost::filesystem::path& path) {
-  int64_t block_size = GetBlockSizeForPath(path);
-
-  // if failed to stat path
-  if (block_size == -1)
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    LOG(ERROR) << "stat(" << path.string()
+               << ") failed - error code: " << errno;
     return -1;
-
-  int64_t size = 0;
-  for (bf::recursive_directory_iterator iter(path);
-      iter != bf::recursive_directory_iterator(); ++iter) {
-      struct stat buf;
-      if (lstat(iter->path().c_str(), &buf) == -1) {
-        LOG(ERROR) << "lstat() failed for: " << iter->path();
-        return -1;
-      }
-      size += RoundUpToBlockSizeOf(buf.st_size, block_size);
   }
 
+  TreeSizer sizer(info.st_blksize);
+  int64_t size = sizer.Measure(path);
   // FIXME: block size for external device may differ...
   return size;
 }
@@ -309,6 +714,14 @@ boost::filesystem::path GenerateTmpDir(const bf::path &app_path) {
   return install_tmp_dir;
 }
 
+boost::filesystem::path GenerateStagingDir(const bf::path& app_path) {
+  bf::path staging_dir;
+  do {
+    staging_dir = app_path / bf::unique_path(".staging-%%%%%%");
+  } while (bf::exists(staging_dir));
+  return staging_dir;
+}
+
 boost::filesystem::path GenerateTemporaryPath(
     const boost::filesystem::path& path) {
   bf::path pattern = path;
@@ -327,146 +740,27 @@ bool ExtractToTmpDir(const char* zip_path,
 
 bool ExtractToTmpDir(const char* zip_path, const bf::path& tmp_dir,
                      const std::string& filter_prefix) {
-  unz_global_info info;
-  char read_buffer[kZipBufSize];
-  unz_file_info raw_file_info;
-  char raw_file_name_in_zip[kZipMaxPath];
-
-  current_path(tmp_dir);
-
-  UnzFilePointer zip_file;
-  if (!zip_file.Open(zip_path)) {
-    LOG(ERROR) << "Failed to open the source dir: " << zip_path;
-    return false;
-  }
-
-  if (unzGetGlobalInfo(zip_file.Get(), &info) != UNZ_OK) {
-    LOG(ERROR) << "Failed to read global info";
-    return false;
-  }
-
-  for (uLong i = 0; i < info.number_entry; i++) {
-    if (unzGetCurrentFileInfo(zip_file.Get(),
-                              &raw_file_info,
-                              raw_file_name_in_zip,
-                              sizeof(raw_file_name_in_zip),
-                              nullptr,
-                              0,
-                              nullptr,
-                              0) != UNZ_OK) {
-      LOG(ERROR) << "Failed to read file info";
-      return false;
-    }
-
-    if (raw_file_name_in_zip[0] == '\0')
-      return false;
-
-    // unpack if filter is empty or path is matched
-    if (filter_prefix.empty() ||
-        std::string(raw_file_name_in_zip).find(filter_prefix) == 0) {
-      bf::path filename_in_zip_path(raw_file_name_in_zip);
-
-      // prevent "directory climbing" attack
-      if (HasDirectoryClimbing(filename_in_zip_path)) {
-        LOG(ERROR) << "Relative path in widget in malformed";
-        return false;
-      }
-
-      if (!filename_in_zip_path.parent_path().empty()) {
-        if (!CreateDir(filename_in_zip_path.parent_path())) {
-          LOG(ERROR) << "Failed to create directory: "
-              << filename_in_zip_path.parent_path();
-          return false;
-        }
-      }
-
-      if (!zip_file.OpenCurrent()) {
-        LOG(ERROR) << "Failed to open file";
-        return false;
-      }
-
-      if (!is_directory(filename_in_zip_path)) {
-        FILE *out = fopen(raw_file_name_in_zip, "wb");
-        if (!out) {
-          LOG(ERROR) << "Failed to open destination ";
-          return false;
-        }
-
-        int ret = UNZ_OK;
-        do {
-          ret = unzReadCurrentFile(zip_file.Get(), read_buffer, kZipBufSize);
-          if (ret < 0) {
-            LOG(ERROR) << "Failed to read data: " << ret;
-            return false;
-          } else {
-            fwrite(read_buffer, sizeof(char), ret, out);
-          }
-        } while (ret > 0);
-
-        fclose(out);
-      }
-
-      zip_file.CloseCurrent();
-    }
-
-    if ((i+1) < info.number_entry) {
-      if (unzGoToNextFile(zip_file.Get()) != UNZ_OK) {
-        LOG(ERROR) << "Failed to read next file";
-        return false;
-      }
-    }
-  }
+  return ExtractToTmpDir(zip_path, tmp_dir, filter_prefix,
+                         ExtractOptions::FromEnvironment());
+}
 
-  return true;
+bool ExtractToTmpDir(const char* zip_path, const bf::path& tmp_dir,
+                     const std::string& filter_prefix,
+                     const ExtractOptions& options) {
+  ZipExtractor extractor(zip_path, tmp_dir, options);
+  return extractor.Extract(filter_prefix);
 }
 
 bool CheckPathInZipArchive(const char* zip_archive_path,
                            const boost::filesystem::path& relative_zip_path,
                            bool* found) {
   *found = false;
-  UnzFilePointer zip_file;
-  if (!zip_file.Open(zip_archive_path)) {
-    LOG(ERROR) << "Failed to open the source dir: " << zip_archive_path;
-    return false;
-  }
-
-  unz_global_info info;
-  if (unzGetGlobalInfo(zip_file.Get(), &info) != UNZ_OK) {
-    LOG(ERROR) << "Failed to read global info";
+  std::shared_ptr<const ZipIndex> index = ZipIndex::Open(zip_archive_path);
+  if (!index) {
+    LOG(ERROR) << "Failed to read archive: " << zip_archive_path;
     return false;
   }
-
-  char raw_file_name_in_zip[kZipMaxPath];
-  unz_file_info raw_file_info;
-  for (uLong i = 0; i < info.number_entry; i++) {
-    if (unzGetCurrentFileInfo(zip_file.Get(),
-                              &raw_file_info,
-                              raw_file_name_in_zip,
-                              sizeof(raw_file_name_in_zip),
-                              nullptr,
-                              0,
-                              nullptr,
-                              0) != UNZ_OK) {
-      LOG(ERROR) << "Failed to read file info";
-      return false;
-    }
-
-    if (raw_file_name_in_zip[0] == '\0')
-      return false;
-
-    if (relative_zip_path.string() == raw_file_name_in_zip) {
-      *found = true;
-      return true;
-    }
-
-    if ((i + 1) < info.number_entry) {
-      if (unzGoToNextFile(zip_file.Get()) != UNZ_OK) {
-        LOG(ERROR) << "Failed to read next file";
-        return false;
-      }
-    }
-  }
-
+  *found = index->Find(relative_zip_path.string()) != nullptr;
   return true;
 }
 
@@ -5,8 +5,12 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <set>
 #include <string>
 
+#include "common/utils/zip_extractor.h"
+
 namespace common_installer {
 
 enum FSFlag {
@@ -16,8 +20,36 @@ enum FSFlag {
 
 bool CreateDir(const boost::filesystem::path& path);
 
+/**
+ * \brief Copies directory tree. Regular files are reflinked where filesystem
+ *        supports it (see CopyFileContent()).
+ *
+ * \param src source directory
+ * \param dst destination directory, may exist only with FS_MERGE_DIRECTORIES
+ * \param flags copy flags
+ * \param skipped paths relative to src which are not copied, directories
+ *        are left out with their whole content
+ *
+ * \return true on success
+ */
 bool CopyDir(const boost::filesystem::path& src,
-             const boost::filesystem::path& dst, FSFlag flags = FS_NONE);
+             const boost::filesystem::path& dst, FSFlag flags = FS_NONE,
+             const std::set<std::string>& skipped = std::set<std::string>());
+
+/**
+ * \brief Removes file or whole directory tree, like
+ *        boost::filesystem::remove_all(), but reads directories with
+ *        getdents64() and removes entries with unlinkat() relative to
+ *        directory descriptors. Wide trees are removed in parallel.
+ *        Symlinks are removed, never followed.
+ *
+ * \param path path to remove
+ * \param error set to error of failed removal if not nullptr
+ *
+ * \return true if path does not exist anymore
+ */
+bool RemoveTree(const boost::filesystem::path& path,
+                boost::system::error_code* error = nullptr);
 
 bool CopyFile(const boost::filesystem::path& src,
              const boost::filesystem::path& dst);
@@ -25,18 +57,61 @@ bool CopyFile(const boost::filesystem::path& src,
 bool MoveDir(const boost::filesystem::path& src,
              const boost::filesystem::path& dst, FSFlag flags = FS_NONE);
 
+/**
+ * \brief Atomically swaps two paths on the same filesystem with
+ *        renameat2(RENAME_EXCHANGE). Both paths must exist.
+ *
+ * \return true on success, false with errno set otherwise (ENOSYS or
+ *         EINVAL if kernel or filesystem does not support exchange)
+ */
+bool ExchangePaths(const boost::filesystem::path& first,
+                   const boost::filesystem::path& second);
+
 bool MoveFile(const boost::filesystem::path& src,
               const boost::filesystem::path& dst);
 
+/**
+ * \brief Moves directory with single rename(), without copy fallback.
+ *        Fails if src and parent of dst are on different filesystems or if
+ *        dst exists and is not an empty directory.
+ */
+bool RenameDir(const boost::filesystem::path& src,
+               const boost::filesystem::path& dst);
+
 bool SetDirPermissions(const boost::filesystem::path& path,
                        boost::filesystem::perms permissions);
 
+/**
+ * \brief Identifies directory or file independently of its path, so that it
+ *        can be found again after renames on the same filesystem.
+ *
+ * \return "device:inode" of path, empty string if it cannot be read
+ */
+std::string GetPathIdentity(const boost::filesystem::path& path);
+
 int64_t GetUnpackedPackageSize(const boost::filesystem::path& path);
 
+/**
+ * \brief Computes size of directory tree as sum of sizes of all its entries,
+ *        each rounded up to block size of path's filesystem. Entries are
+ *        read with getdents64() and statx() and subtrees are measured in
+ *        parallel.
+ *
+ * \param path directory to measure
+ *
+ * \return size in bytes or -1 on error
+ */
 int64_t GetDirectorySize(const boost::filesystem::path& path);
 
 boost::filesystem::path GenerateTmpDir(const boost::filesystem::path& app_path);
 
+/**
+ * \brief Generates path of hidden directory inside app_path, so package
+ *        unpacked there can be moved to app_path/pkgid by RenameDir()
+ */
+boost::filesystem::path GenerateStagingDir(
+    const boost::filesystem::path& app_path);
+
 boost::filesystem::path GenerateTemporaryPath(
     const boost::filesystem::path& path);
 
@@ -47,6 +122,11 @@ bool ExtractToTmpDir(const char* zip_path,
                      const boost::filesystem::path& tmp_dir,
                      const std::string& filter_prefix);
 
+bool ExtractToTmpDir(const char* zip_path,
+                     const boost::filesystem::path& tmp_dir,
+                     const std::string& filter_prefix,
+                     const ExtractOptions& options);
+
 bool CheckPathInZipArchive(const char* zip_archive_path,
                            const boost::filesystem::path& relative_zip_path,
                            bool* found);
@@ -0,0 +1,137 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/inflater.h"
+
+#include <zlib.h>
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#include <manifest_parser/utils/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "common/utils/macros.h"
+
+namespace {
+
+const char kZlibBackend[] = "zlib";
+#ifdef HAVE_LIBDEFLATE
+const char kLibdeflateBackend[] = "libdeflate";
+#endif
+
+class ZlibInflater : public common_installer::Inflater {
+ public:
+  ZlibInflater() { }
+
+  const char* name() const override { return kZlibBackend; }
+
+  bool Inflate(const uint8_t* in, size_t in_size, uint8_t* out,
+               size_t out_size) override {
+    if (in_size > std::numeric_limits<uInt>::max() ||
+        out_size > std::numeric_limits<uInt>::max())
+      return false;
+    z_stream stream = {};
+    // zlib rejects null output even if nothing is written, as for empty
+    // entries
+    Bytef empty_output;
+    stream.next_in = const_cast<Bytef*>(in);
+    stream.avail_in = in_size;
+    stream.next_out = out ? out : &empty_output;
+    stream.avail_out = out_size;
+    // negative window bits: raw deflate without zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+      return false;
+    int ret = inflate(&stream, Z_FINISH);
+    bool result = ret == Z_STREAM_END && stream.total_out == out_size;
+    inflateEnd(&stream);
+    return result;
+  }
+
+  uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size) override {
+    while (size > 0) {
+      uInt chunk = std::min<size_t>(size, std::numeric_limits<uInt>::max());
+      crc = crc32(crc, data, chunk);
+      data += chunk;
+      size -= chunk;
+    }
+    return crc;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZlibInflater);
+};
+
+#ifdef HAVE_LIBDEFLATE
+
+class LibdeflateInflater : public common_installer::Inflater {
+ public:
+  LibdeflateInflater()
+      : decompressor_(libdeflate_alloc_decompressor()) { }
+
+  ~LibdeflateInflater() override {
+    if (decompressor_)
+      libdeflate_free_decompressor(decompressor_);
+  }
+
+  bool valid() const { return decompressor_ != nullptr; }
+
+  const char* name() const override { return kLibdeflateBackend; }
+
+  bool Inflate(const uint8_t* in, size_t in_size, uint8_t* out,
+               size_t out_size) override {
+    // null actual size requires output to be filled exactly
+    return libdeflate_deflate_decompress(decompressor_, in, in_size, out,
+                                         out_size, nullptr) ==
+        LIBDEFLATE_SUCCESS;
+  }
+
+  uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size) override {
+    return libdeflate_crc32(crc, data, size);
+  }
+
+ private:
+  struct libdeflate_decompressor* decompressor_;
+
+  DISALLOW_COPY_AND_ASSIGN(LibdeflateInflater);
+};
+
+#endif  // HAVE_LIBDEFLATE
+
+}  // namespace
+
+namespace common_installer {
+
+const char Inflater::kBackendEnvironmentVariable[] =
+    "APP_INSTALLERS_INFLATE_BACKEND";
+
+std::unique_ptr<Inflater> Inflater::Create(const std::string& backend) {
+#ifdef HAVE_LIBDEFLATE
+  if (backend.empty() || backend == kLibdeflateBackend) {
+    std::unique_ptr<LibdeflateInflater> inflater(new LibdeflateInflater());
+    // converting return needs explicit move for compilers without CWG1579
+    if (inflater->valid())
+      return std::move(inflater);
+    LOG(WARNING) << "Failed to create libdeflate decompressor";
+  }
+#endif
+  if (backend.empty() || backend == kZlibBackend)
+    return std::unique_ptr<Inflater>(new ZlibInflater());
+  LOG(ERROR) << "Inflate backend not available: " << backend;
+  return nullptr;
+}
+
+std::vector<std::string> Inflater::AvailableBackends() {
+  std::vector<std::string> backends;
+#ifdef HAVE_LIBDEFLATE
+  backends.push_back(kLibdeflateBackend);
+#endif
+  backends.push_back(kZlibBackend);
+  return backends;
+}
+
+}  // namespace common_installer
@@ -0,0 +1,71 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_INFLATER_H_
+#define COMMON_UTILS_INFLATER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace common_installer {
+
+/**
+ * \brief Decompressor of raw deflate streams (zip method 8) inflating whole
+ *        entry at once from memory to memory.
+ *
+ * Implementations are selected at runtime by name. "zlib" is always
+ * available, "libdeflate" if built with HAVE_LIBDEFLATE. libdeflate picks
+ * SIMD variants of its inflate and crc32 routines according to cpu
+ * features detected at runtime.
+ *
+ * Objects are not thread-safe, every thread should create its own.
+ */
+class Inflater {
+ public:
+  /** Name of environment variable selecting backend */
+  static const char kBackendEnvironmentVariable[];
+
+  /**
+   * \brief Creates inflater
+   *
+   * \param backend name of backend, empty means the fastest available
+   *
+   * \return inflater or nullptr if backend is not available
+   */
+  static std::unique_ptr<Inflater> Create(const std::string& backend);
+
+  /**
+   * \brief Names of backends available in this build, the fastest first
+   */
+  static std::vector<std::string> AvailableBackends();
+
+  virtual ~Inflater() { }
+
+  virtual const char* name() const = 0;
+
+  /**
+   * \brief Inflates whole raw deflate stream
+   *
+   * \param in compressed data
+   * \param in_size size of compressed data
+   * \param out output buffer
+   * \param out_size expected size of uncompressed data
+   *
+   * \return true if stream was inflated to exactly out_size bytes
+   */
+  virtual bool Inflate(const uint8_t* in, size_t in_size, uint8_t* out,
+                       size_t out_size) = 0;
+
+  /**
+   * \brief Updates crc32 (as used by zip) with data
+   */
+  virtual uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size) = 0;
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_INFLATER_H_
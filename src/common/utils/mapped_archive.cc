@@ -0,0 +1,175 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/mapped_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+// state of single minizip handle
+struct Stream {
+  const common_installer::MappedArchive* archive;
+  uint64_t position;
+  bool error;
+};
+
+void* OpenCallback(void* opaque, const void* /* filename */, int mode) {
+  if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) != ZLIB_FILEFUNC_MODE_READ)
+    return nullptr;
+  Stream* stream = new Stream;
+  stream->archive = static_cast<const common_installer::MappedArchive*>(opaque);
+  stream->position = 0;
+  stream->error = false;
+  return stream;
+}
+
+uLong ReadCallback(void* /* opaque */, void* data, void* buf, uLong size) {
+  Stream* stream = static_cast<Stream*>(data);
+  int64_t count = stream->archive->Read(stream->position, buf, size);
+  if (count < 0) {
+    stream->error = true;
+    return 0;
+  }
+  stream->position += count;
+  return count;
+}
+
+uLong WriteCallback(void* /* opaque */, void* /* data */,
+                    const void* /* buf */, uLong /* size */) {
+  return 0;
+}
+
+ZPOS64_T TellCallback(void* /* opaque */, void* data) {
+  return static_cast<Stream*>(data)->position;
+}
+
+long SeekCallback(void* /* opaque */, void* data,  // NOLINT
+                  ZPOS64_T offset, int origin) {
+  Stream* stream = static_cast<Stream*>(data);
+  uint64_t base;
+  switch (origin) {
+    case ZLIB_FILEFUNC_SEEK_SET:
+      base = 0;
+      break;
+    case ZLIB_FILEFUNC_SEEK_CUR:
+      base = stream->position;
+      break;
+    case ZLIB_FILEFUNC_SEEK_END:
+      base = stream->archive->size();
+      break;
+    default:
+      return -1;
+  }
+  if (base + offset > stream->archive->size())
+    return -1;
+  stream->position = base + offset;
+  return 0;
+}
+
+int CloseCallback(void* /* opaque */, void* data) {
+  delete static_cast<Stream*>(data);
+  return 0;
+}
+
+int ErrorCallback(void* /* opaque */, void* data) {
+  return static_cast<Stream*>(data)->error ? 1 : 0;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+std::shared_ptr<MappedArchive> MappedArchive::Open(const bf::path& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open archive: " << path << ", errno: " << errno;
+    return nullptr;
+  }
+  struct stat buf;
+  if (fstat(fd, &buf) != 0) {
+    LOG(ERROR) << "Failed to stat archive: " << path;
+    close(fd);
+    return nullptr;
+  }
+  return std::shared_ptr<MappedArchive>(
+      new MappedArchive(path, fd, buf.st_size));
+}
+
+MappedArchive::MappedArchive(const bf::path& path, int fd, uint64_t size)
+    : path_(path),
+      fd_(fd),
+      size_(size),
+      data_(nullptr) {
+  if (size_ == 0 || size_ != static_cast<size_t>(size_))
+    return;
+  void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (map == MAP_FAILED) {
+    LOG(WARNING) << "Cannot map archive: " << path_ << ", errno: " << errno
+                 << ", falling back to file reads";
+    return;
+  }
+  data_ = static_cast<const uint8_t*>(map);
+}
+
+MappedArchive::~MappedArchive() {
+  if (data_)
+    munmap(const_cast<uint8_t*>(data_), size_);
+  close(fd_);
+}
+
+unzFile MappedArchive::OpenUnzip() const {
+  zlib_filefunc64_def functions;
+  functions.zopen64_file = OpenCallback;
+  functions.zread_file = ReadCallback;
+  functions.zwrite_file = WriteCallback;
+  functions.ztell64_file = TellCallback;
+  functions.zseek64_file = SeekCallback;
+  functions.zclose_file = CloseCallback;
+  functions.zerror_file = ErrorCallback;
+  functions.opaque = const_cast<MappedArchive*>(this);
+  return unzOpen2_64(path_.c_str(), &functions);
+}
+
+void MappedArchive::Advise(int advice) const {
+  if (data_)
+    madvise(const_cast<uint8_t*>(data_), size_, advice);
+}
+
+int64_t MappedArchive::Read(uint64_t offset, void* buffer, size_t size) const {
+  if (offset >= size_)
+    return 0;
+  if (size > size_ - offset)
+    size = size_ - offset;
+  if (data_) {
+    memcpy(buffer, data_ + offset, size);
+    return size;
+  }
+  size_t done = 0;
+  while (done < size) {
+    ssize_t count = pread64(fd_, static_cast<char*>(buffer) + done,
+                            size - done, offset + done);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (count == 0)
+      break;
+    done += count;
+  }
+  return done;
+}
+
+}  // namespace common_installer
@@ -0,0 +1,85 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_MAPPED_ARCHIVE_H_
+#define COMMON_UTILS_MAPPED_ARCHIVE_H_
+
+#include <boost/filesystem/path.hpp>
+#include <unzip.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Archive file mapped into memory, used as minizip I/O backend.
+ *
+ * Minizip reads through zlib_filefunc64_def callbacks which copy from the
+ * mapping, so no stdio buffering, fseek() or fread() calls are involved.
+ * If file cannot be mapped (e.g. lack of address space) the callbacks fall
+ * back to pread() on file descriptor.
+ *
+ * Object may be shared by many minizip handles, also from many threads.
+ */
+class MappedArchive {
+ public:
+  /**
+   * \brief Opens and maps archive
+   *
+   * \param path path to archive
+   *
+   * \return archive object or nullptr if file cannot be opened
+   */
+  static std::shared_ptr<MappedArchive> Open(
+      const boost::filesystem::path& path);
+
+  ~MappedArchive();
+
+  /**
+   * \brief Opens minizip handle reading from this archive. Archive object
+   *        must outlive the handle.
+   *
+   * \return handle to be closed by unzClose() or nullptr
+   */
+  unzFile OpenUnzip() const;
+
+  /**
+   * \brief Gives hint about expected access pattern (madvise())
+   *
+   * \param advice MADV_* value
+   */
+  void Advise(int advice) const;
+
+  /**
+   * \brief Copies data from archive
+   *
+   * \return number of bytes read, smaller than size only at end of file,
+   *         -1 on error
+   */
+  int64_t Read(uint64_t offset, void* buffer, size_t size) const;
+
+  /** mapped content or nullptr if archive is not mapped */
+  const uint8_t* data() const { return data_; }
+  uint64_t size() const { return size_; }
+  int fd() const { return fd_; }
+  const boost::filesystem::path& path() const { return path_; }
+
+ private:
+  MappedArchive(const boost::filesystem::path& path, int fd, uint64_t size);
+
+  boost::filesystem::path path_;
+  int fd_;
+  uint64_t size_;
+  const uint8_t* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedArchive);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_MAPPED_ARCHIVE_H_
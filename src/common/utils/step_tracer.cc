@@ -0,0 +1,146 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/step_tracer.h"
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+int64_t ClockMicroseconds(clockid_t clock) {
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0)
+    return 0;
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+std::string EscapeJson(const std::string& value) {
+  std::string result;
+  result.reserve(value.size());
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buffer[7];
+          snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+          result += buffer;
+        } else {
+          result += c;
+        }
+        break;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+const char StepTracer::kTraceEnvironmentVariable[] =
+    "APP_INSTALLERS_TRACE_FILE";
+
+StepTracer::Scope::Scope(StepTracer* tracer, const char* step_name,
+                         const char* phase)
+    : tracer_(tracer),
+      step_name_(step_name),
+      phase_(phase),
+      wall_start_us_(0),
+      cpu_start_us_(0) {
+  if (!tracer_)
+    return;
+  wall_start_us_ = ClockMicroseconds(CLOCK_MONOTONIC);
+  cpu_start_us_ = ClockMicroseconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+StepTracer::Scope::~Scope() {
+  if (!tracer_)
+    return;
+  Event event;
+  event.step = step_name_;
+  event.phase = phase_;
+  event.wall_start_us = wall_start_us_;
+  event.wall_duration_us = ClockMicroseconds(CLOCK_MONOTONIC) - wall_start_us_;
+  event.cpu_duration_us =
+      ClockMicroseconds(CLOCK_THREAD_CPUTIME_ID) - cpu_start_us_;
+  event.tid = syscall(SYS_gettid);
+  tracer_->Record(std::move(event));
+}
+
+std::unique_ptr<StepTracer> StepTracer::CreateFromEnvironment() {
+  const char* output = getenv(kTraceEnvironmentVariable);
+  if (!output || !*output)
+    return nullptr;
+  return std::unique_ptr<StepTracer>(new StepTracer(output));
+}
+
+StepTracer::StepTracer(const bf::path& output)
+    : output_(output) {
+}
+
+void StepTracer::Record(Event event) {
+  std::lock_guard<std::mutex> lock(events_mutex_);
+  events_.push_back(std::move(event));
+}
+
+bool StepTracer::Write(const std::string& pkgid) const {
+  std::ofstream stream(output_.string(), std::ios::out | std::ios::trunc);
+  if (!stream) {
+    LOG(ERROR) << "Cannot open trace file: " << output_;
+    return false;
+  }
+  std::string escaped_pkgid = EscapeJson(pkgid);
+  pid_t pid = getpid();
+
+  std::lock_guard<std::mutex> lock(events_mutex_);
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (auto& event : events_) {
+    if (!first)
+      stream << ",";
+    first = false;
+    stream << "\n{\"name\":\"" << EscapeJson(event.step) << "\""
+           << ",\"cat\":\"" << EscapeJson(event.phase) << "\""
+           << ",\"ph\":\"X\""
+           << ",\"pid\":" << pid
+           << ",\"tid\":" << event.tid
+           << ",\"ts\":" << event.wall_start_us
+           << ",\"dur\":" << event.wall_duration_us
+           << ",\"tdur\":" << event.cpu_duration_us
+           << ",\"args\":{\"pkgid\":\"" << escaped_pkgid << "\""
+           << ",\"phase\":\"" << EscapeJson(event.phase) << "\""
+           << ",\"wall_us\":" << event.wall_duration_us
+           << ",\"cpu_us\":" << event.cpu_duration_us << "}}";
+  }
+  stream << "\n]}\n";
+  stream.close();
+  if (!stream) {
+    LOG(ERROR) << "Failed to write trace file: " << output_;
+    return false;
+  }
+  LOG(DEBUG) << "Step trace written to: " << output_;
+  return true;
+}
+
+}  // namespace common_installer
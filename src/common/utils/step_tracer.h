@@ -0,0 +1,98 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_STEP_TRACER_H_
+#define COMMON_UTILS_STEP_TRACER_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Collects wall and cpu time of step phases and exports them as
+ *        Chrome trace event JSON (readable by chrome://tracing and Perfetto).
+ *
+ * Tracing is disabled unless output path is given, either by environment
+ * variable (see kTraceEnvironmentVariable) or explicitly. When disabled no
+ * tracer object exists and Scope objects do nothing.
+ */
+class StepTracer {
+ public:
+  /** Name of environment variable holding path of trace output file */
+  static const char kTraceEnvironmentVariable[];
+
+  /**
+   * \brief RAII helper measuring one phase of one step.
+   *        Accepts nullptr tracer in which case it does nothing.
+   */
+  class Scope {
+   public:
+    Scope(StepTracer* tracer, const char* step_name, const char* phase);
+    ~Scope();
+
+   private:
+    StepTracer* tracer_;
+    const char* step_name_;
+    const char* phase_;
+    int64_t wall_start_us_;
+    int64_t cpu_start_us_;
+
+    DISALLOW_COPY_AND_ASSIGN(Scope);
+  };
+
+  /**
+   * \brief Creates tracer if kTraceEnvironmentVariable is set
+   *
+   * \return tracer object or nullptr if tracing is disabled
+   */
+  static std::unique_ptr<StepTracer> CreateFromEnvironment();
+
+  /**
+   * Constructor
+   *
+   * \param output path of file where trace will be written
+   */
+  explicit StepTracer(const boost::filesystem::path& output);
+
+  /**
+   * \brief Writes collected events to output file
+   *
+   * \param pkgid package id attached to every event
+   *
+   * \return true if success
+   */
+  bool Write(const std::string& pkgid) const;
+
+  const boost::filesystem::path& output() const { return output_; }
+
+ private:
+  struct Event {
+    std::string step;
+    std::string phase;
+    int64_t wall_start_us;
+    int64_t wall_duration_us;
+    int64_t cpu_duration_us;
+    int64_t tid;
+  };
+
+  void Record(Event event);
+
+  boost::filesystem::path output_;
+  mutable std::mutex events_mutex_;
+  std::vector<Event> events_;
+
+  DISALLOW_COPY_AND_ASSIGN(StepTracer);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_STEP_TRACER_H_
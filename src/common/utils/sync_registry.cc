@@ -0,0 +1,218 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/sync_registry.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <cerrno>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+std::mutex registry_mutex;
+std::set<std::string> written_files;
+std::set<std::string> written_directories;
+// one existing directory per filesystem which needs syncfs()
+std::map<dev_t, std::string> written_filesystems;
+
+// walks up to nearest existing ancestor so that filesystem of removed or
+// renamed tree can still be found
+bool StatNearestExisting(bf::path path, struct stat* buf, bf::path* found) {
+  while (!path.empty()) {
+    if (stat(path.c_str(), buf) == 0) {
+      *found = path;
+      return true;
+    }
+    path = path.parent_path();
+  }
+  return false;
+}
+
+void AddFilesystemLocked(const bf::path& path) {
+  struct stat buf;
+  bf::path existing;
+  if (!StatNearestExisting(path, &buf, &existing))
+    return;
+  if (!S_ISDIR(buf.st_mode))
+    existing = existing.parent_path();
+  written_filesystems.emplace(buf.st_dev, existing.string());
+}
+
+bool FsyncPath(const std::string& path, int flags) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+  if (fd < 0) {
+    // directory removed after its entries were changed, nothing to flush
+    if ((flags & O_DIRECTORY) && (errno == ENOENT || errno == ENOTDIR))
+      return true;
+    LOG(ERROR) << "Cannot open " << path << " for sync, errno: " << errno;
+    return false;
+  }
+  bool result = true;
+  if (fsync(fd) != 0) {
+    LOG(ERROR) << "fsync failed for " << path << ", errno: " << errno;
+    result = false;
+  }
+  close(fd);
+  return result;
+}
+
+// starts asynchronous writeback so that following fsync() of many files
+// waits for I/O already in flight instead of issuing it file by file
+void StartWriteback(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+  close(fd);
+}
+
+bool IsWithin(const std::string& path, const std::string& root) {
+  return path.compare(0, root.size(), root) == 0 &&
+      (path.size() == root.size() || path[root.size()] == '/');
+}
+
+// removes paths inside src from set and returns them with prefix dst
+std::vector<std::string> TakePathsLocked(const std::string& src,
+                                         const std::string& dst,
+                                         std::set<std::string>* paths) {
+  std::vector<std::string> moved;
+  for (auto it = paths->lower_bound(src);
+       it != paths->end() && it->compare(0, src.size(), src) == 0;) {
+    if (IsWithin(*it, src)) {
+      moved.push_back(dst + it->substr(src.size()));
+      it = paths->erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return moved;
+}
+
+void MovePathsLocked(const std::string& src, const std::string& dst,
+                     std::set<std::string>* paths) {
+  std::vector<std::string> moved = TakePathsLocked(src, dst, paths);
+  paths->insert(moved.begin(), moved.end());
+}
+
+void ExchangePathsLocked(const std::string& first, const std::string& second,
+                         std::set<std::string>* paths) {
+  std::vector<std::string> moved = TakePathsLocked(first, second, paths);
+  std::vector<std::string> other = TakePathsLocked(second, first, paths);
+  paths->insert(moved.begin(), moved.end());
+  paths->insert(other.begin(), other.end());
+}
+
+void ForgetPathsLocked(const std::string& root,
+                       std::set<std::string>* paths) {
+  for (auto it = paths->lower_bound(root);
+       it != paths->end() && it->compare(0, root.size(), root) == 0;) {
+    if (IsWithin(*it, root))
+      it = paths->erase(it);
+    else
+      ++it;
+  }
+}
+
+bool SyncFilesystem(const std::string& path) {
+  bf::path existing;
+  struct stat buf;
+  if (!StatNearestExisting(path, &buf, &existing))
+    return true;
+  int fd = open(existing.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(WARNING) << "Cannot open " << existing << " for syncfs, errno: "
+                 << errno;
+    return false;
+  }
+  bool result = true;
+  if (syncfs(fd) != 0) {
+    LOG(ERROR) << "syncfs failed for " << existing << ", errno: " << errno;
+    result = false;
+  }
+  close(fd);
+  return result;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+void RegisterWrittenFile(const bf::path& path) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  written_files.insert(path.string());
+  written_directories.insert(path.parent_path().string());
+}
+
+void RegisterWrittenDirectory(const bf::path& path) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  written_directories.insert(path.string());
+}
+
+void RegisterWrittenTree(const bf::path& path) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  AddFilesystemLocked(path);
+}
+
+void MoveWrittenPaths(const bf::path& src, const bf::path& dst) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  MovePathsLocked(src.string(), dst.string(), &written_files);
+  MovePathsLocked(src.string(), dst.string(), &written_directories);
+}
+
+void ExchangeWrittenPaths(const bf::path& first, const bf::path& second) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  ExchangePathsLocked(first.string(), second.string(), &written_files);
+  ExchangePathsLocked(first.string(), second.string(), &written_directories);
+}
+
+void ForgetWrittenPaths(const bf::path& path) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  ForgetPathsLocked(path.string(), &written_files);
+  ForgetPathsLocked(path.string(), &written_directories);
+}
+
+bool SyncWrittenFiles() {
+  std::set<std::string> files;
+  std::set<std::string> directories;
+  std::map<dev_t, std::string> filesystems;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    files.swap(written_files);
+    directories.swap(written_directories);
+    filesystems.swap(written_filesystems);
+  }
+
+  bool result = true;
+  for (auto& filesystem : filesystems) {
+    if (!SyncFilesystem(filesystem.second))
+      result = false;
+  }
+  if (files.size() > 1) {
+    for (auto& file : files)
+      StartWriteback(file);
+  }
+  for (auto& file : files) {
+    if (!FsyncPath(file, 0))
+      result = false;
+  }
+  for (auto& directory : directories) {
+    if (!FsyncPath(directory, O_DIRECTORY))
+      result = false;
+  }
+  return result;
+}
+
+}  // namespace common_installer
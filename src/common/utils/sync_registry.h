@@ -0,0 +1,65 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_SYNC_REGISTRY_H_
+#define COMMON_UTILS_SYNC_REGISTRY_H_
+
+#include <boost/filesystem/path.hpp>
+
+namespace common_installer {
+
+// Functions below record what was written during request so that only
+// those files are flushed to storage at the end of request instead of
+// calling global sync(). All of them are thread-safe.
+
+/**
+ * \brief Records regular file which content was written. File and its
+ *        parent directory will be fsync'ed.
+ */
+void RegisterWrittenFile(const boost::filesystem::path& path);
+
+/**
+ * \brief Records directory which entries were changed (created, renamed,
+ *        removed). Directory will be fsync'ed.
+ */
+void RegisterWrittenDirectory(const boost::filesystem::path& path);
+
+/**
+ * \brief Records tree with many written files. Whole filesystem containing
+ *        the tree will be flushed with syncfs(). Use only if written files
+ *        are not known, otherwise register them with RegisterWrittenFile().
+ */
+void RegisterWrittenTree(const boost::filesystem::path& path);
+
+/**
+ * \brief Updates recorded files and directories inside renamed path, so
+ *        that they are flushed at their new location.
+ */
+void MoveWrittenPaths(const boost::filesystem::path& src,
+                      const boost::filesystem::path& dst);
+
+/**
+ * \brief Swaps recorded files and directories inside two exchanged paths.
+ */
+void ExchangeWrittenPaths(const boost::filesystem::path& first,
+                          const boost::filesystem::path& second);
+
+/**
+ * \brief Drops recorded files and directories inside removed path.
+ */
+void ForgetWrittenPaths(const boost::filesystem::path& path);
+
+/**
+ * \brief Flushes all recorded files, directories and filesystems and clears
+ *        the registry. Directories which do not exist anymore are skipped, missing
+ *        file means that its move or removal was not recorded and is
+ *        reported as failure.
+ *
+ * \return true if all flushes succeeded
+ */
+bool SyncWrittenFiles();
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_SYNC_REGISTRY_H_
@@ -0,0 +1,107 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/thread_pool.h"
+
+#include <utility>
+
+namespace {
+
+// pool and queue of worker running on current thread
+thread_local const common_installer::ThreadPool* current_pool = nullptr;
+thread_local unsigned current_queue = 0;
+
+}  // namespace
+
+namespace common_installer {
+
+ThreadPool::ThreadPool(unsigned threads)
+    : queues_(threads ? threads : DefaultSize()),
+      pending_(0),
+      next_queue_(0),
+      stopping_(false) {
+  for (unsigned i = 0; i < queues_.size(); ++i)
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this] { return pending_ == 0; });
+    stopping_ = true;
+  }
+  task_available_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::Submit(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_;
+    unsigned index;
+    if (current_pool == this)
+      index = current_queue;
+    else
+      index = next_queue_++ % queues_.size();
+    queues_[index].push_back(std::move(task));
+  }
+  task_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  all_done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+unsigned ThreadPool::DefaultSize() {
+  unsigned cores = std::thread::hardware_concurrency();
+  return cores ? cores : 1;
+}
+
+bool ThreadPool::TakeTask(unsigned index, Task* task) {
+  // newest own task first, its data is most likely still in cache
+  std::deque<Task>& own = queues_[index];
+  if (!own.empty()) {
+    *task = std::move(own.back());
+    own.pop_back();
+    return true;
+  }
+  // oldest task of other worker, which is likely the biggest one
+  for (unsigned i = 1; i < queues_.size(); ++i) {
+    std::deque<Task>& victim = queues_[(index + i) % queues_.size()];
+    if (!victim.empty()) {
+      *task = std::move(victim.front());
+      victim.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned index) {
+  current_pool = this;
+  current_queue = index;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    Task task;
+    if (!TakeTask(index, &task)) {
+      // pool is stopped only when all tasks are done
+      if (stopping_)
+        return;
+      task_available_.wait(lock);
+      continue;
+    }
+    lock.unlock();
+    task();
+    // captured state is destroyed before task is counted as done, as
+    // caller of Wait() may free what it refers to
+    task = nullptr;
+    lock.lock();
+    if (--pending_ == 0)
+      all_done_.notify_all();
+  }
+}
+
+}  // namespace common_installer
@@ -0,0 +1,85 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_THREAD_POOL_H_
+#define COMMON_UTILS_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Fixed size pool of worker threads executing submitted tasks.
+ *
+ * Every worker has its own task deque. Tasks submitted from a worker thread
+ * (e.g. subtasks found while processing a directory tree) go to that
+ * worker's deque and are taken by it in LIFO order, other tasks are
+ * distributed round-robin. Idle workers steal the oldest tasks from deques
+ * of other workers.
+ *
+ * Tasks must not throw and must not call Wait() of their own pool.
+ * Destructor waits for all submitted tasks.
+ */
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /**
+   * Constructor
+   *
+   * \param threads number of worker threads, 0 means number of cpu cores
+   */
+  explicit ThreadPool(unsigned threads = 0);
+
+  /** Destructor. Waits for all tasks to finish. */
+  ~ThreadPool();
+
+  /**
+   * \brief Queues task for execution
+   *
+   * \param task task to be executed by one of worker threads
+   */
+  void Submit(Task task);
+
+  /** \brief Blocks until all submitted tasks are finished */
+  void Wait();
+
+  unsigned size() const { return workers_.size(); }
+
+  /**
+   * \brief Returns number of threads used by default
+   *
+   * \return number of online cpu cores (at least 1)
+   */
+  static unsigned DefaultSize();
+
+ private:
+  // must be called with mutex_ locked
+  bool TakeTask(unsigned index, Task* task);
+  void WorkerLoop(unsigned index);
+
+  std::vector<std::thread> workers_;
+  // guards task deques and counters below, so sleeping worker is woken
+  // only when there is task it can take
+  std::mutex mutex_;
+  std::vector<std::deque<Task>> queues_;
+  std::condition_variable task_available_;
+  std::condition_variable all_done_;
+  unsigned pending_;
+  unsigned next_queue_;
+  bool stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_THREAD_POOL_H_
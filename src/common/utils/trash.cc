@@ -0,0 +1,149 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/trash.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include "common/utils/file_util.h"
+#include "common/utils/sync_registry.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace {
+
+const char kTrashDirectoryName[] = ".trash";
+// reaper removes trash by this program, so that nothing but async-signal-safe
+// calls happen between fork() and exec() in multithreaded installer
+const char kRemoveProgram[] = "/bin/rm";
+// bounds command line of single reaper, rest is left for next one
+const size_t kMaxReapedEntries = 256;
+
+// values from linux/ioprio.h, which is not exported to userspace headers
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassIdle = 3;
+const int kIoprioClassShift = 13;
+
+bf::path TrashDirectory(const bf::path& root) {
+  return root / kTrashDirectoryName;
+}
+
+// trash is usable only if path can be renamed into it
+bool PrepareTrashDirectory(const bf::path& root, dev_t device,
+                           bf::path* trash) {
+  bf::path candidate = TrashDirectory(root);
+  if (mkdir(candidate.c_str(), 0700) == 0)
+    common_installer::RegisterWrittenDirectory(root);
+  struct stat buf;
+  if (lstat(candidate.c_str(), &buf) != 0 || !S_ISDIR(buf.st_mode) ||
+      buf.st_dev != device)
+    return false;
+  *trash = candidate;
+  return true;
+}
+
+void CloseDescriptorsFrom(int first, int max_fd) {
+#ifdef SYS_close_range
+  if (syscall(SYS_close_range, first, ~0U, 0) == 0)
+    return;
+#endif
+  for (int fd = first; fd < max_fd; ++fd)
+    close(fd);
+}
+
+}  // namespace
+
+namespace common_installer {
+
+bool MoveToTrash(const bf::path& path, const bf::path& root,
+                 bs::error_code* error) {
+  struct stat buf;
+  if (lstat(path.c_str(), &buf) != 0) {
+    if (errno == ENOENT) {
+      if (error)
+        error->clear();
+      return true;
+    }
+    return RemoveTree(path, error);
+  }
+  bf::path trash;
+  if (PrepareTrashDirectory(root, buf.st_dev, &trash)) {
+    // name is kept for debugging of what reaper removes
+    bf::path target = trash /
+        bf::unique_path(path.filename().string() + "-%%%%%%%%");
+    if (rename(path.c_str(), target.c_str()) == 0) {
+      ForgetWrittenPaths(path);
+      RegisterWrittenDirectory(path.parent_path());
+      RegisterWrittenDirectory(trash);
+      if (error)
+        error->clear();
+      return true;
+    }
+    LOG(WARNING) << "Cannot move " << path << " to trash, errno: " << errno
+                 << ", removing it now";
+  }
+  return RemoveTree(path, error);
+}
+
+void StartTrashReaper(const bf::path& root) {
+  // entries are listed here, also those left by interrupted reapers, as
+  // child may not allocate memory before exec()
+  std::vector<std::string> entries;
+  bs::error_code error;
+  for (bf::directory_iterator it(TrashDirectory(root), error);
+       !error && it != bf::directory_iterator() &&
+       entries.size() < kMaxReapedEntries; it.increment(error))
+    entries.push_back(it->path().string());
+  if (entries.empty())
+    return;
+  std::vector<const char*> argv = {kRemoveProgram, "-rf", "--"};
+  for (auto& entry : entries)
+    argv.push_back(entry.c_str());
+  argv.push_back(nullptr);
+  int max_fd = sysconf(_SC_OPEN_MAX);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    LOG(WARNING) << "Cannot start trash reaper, errno: " << errno;
+    return;
+  }
+  if (pid == 0) {
+    // second fork detaches reaper, it is reparented to init
+    if (fork() != 0)
+      _exit(0);
+    setsid();
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+      dup2(null_fd, STDIN_FILENO);
+      dup2(null_fd, STDOUT_FILENO);
+      dup2(null_fd, STDERR_FILENO);
+    }
+    // descriptors of installer, like locks or pipes of caller, must not be
+    // held by reaper
+    CloseDescriptorsFrom(STDERR_FILENO + 1, max_fd);
+    syscall(SYS_setpriority, PRIO_PROCESS, 0, 19);
+    syscall(SYS_ioprio_set, kIoprioWhoProcess, 0,
+            kIoprioClassIdle << kIoprioClassShift);
+    execv(kRemoveProgram, const_cast<char* const*>(argv.data()));
+    _exit(1);
+  }
+  waitpid(pid, nullptr, 0);
+}
+
+}  // namespace common_installer
@@ -0,0 +1,46 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_TRASH_H_
+#define COMMON_UTILS_TRASH_H_
+
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace common_installer {
+
+// Functions below let request drop big trees without waiting for their
+// deletion. Tree is renamed into ".trash" directory of root application
+// path and removed later by detached, low priority reaper process. All of
+// them are thread-safe.
+
+/**
+ * \brief Moves file or directory tree into trash of root application path
+ *        with single rename(). If path is on other filesystem or cannot be
+ *        renamed there, it is removed immediately with RemoveTree().
+ *
+ * \param path path to remove
+ * \param root root application path which holds trash
+ * \param error set to error of failed removal if not nullptr
+ *
+ * \return true if path does not exist anymore
+ */
+bool MoveToTrash(const boost::filesystem::path& path,
+                 const boost::filesystem::path& root,
+                 boost::system::error_code* error = nullptr);
+
+/**
+ * \brief Starts detached reaper process with idle io priority, which
+ *        removes content of trash of root application path, including
+ *        trash left by interrupted reapers. Reaper runs rm(1), installer
+ *        descriptors are closed in it. Returns without waiting for the
+ *        reaper.
+ *
+ * \param root root application path which trash should be emptied
+ */
+void StartTrashReaper(const boost::filesystem::path& root);
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_TRASH_H_
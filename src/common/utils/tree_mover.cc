@@ -0,0 +1,380 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/tree_mover.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/utils/byte_size_literals.h"
+#include "common/utils/file_copy.h"
+#include "common/utils/file_util.h"
+#include "common/utils/sync_registry.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace {
+
+// copying is bound by storage, few threads keep it busy
+const unsigned kMaxMoveThreads = 4;
+const size_t kMaxBatchFiles = 64;
+const uint64_t kMaxBatchBytes = 32_MB;
+
+const char kJournalSource = 'S';
+const char kJournalDestination = 'D';
+const char kJournalStarted = 'C';
+const char kJournalFinished = 'F';
+
+bool SyncPath(const bf::path& path, int flags) {
+  int fd = open(path.c_str(), flags | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  bool result = fsync(fd) == 0;
+  close(fd);
+  return result;
+}
+
+bool CopySymlink(const bf::path& src, const bf::path& dst, bool replace) {
+  bs::error_code error;
+  bf::path target = bf::read_symlink(src, error);
+  if (error)
+    return false;
+  if (replace)
+    unlink(dst.c_str());
+  return symlink(target.c_str(), dst.c_str()) == 0;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+TreeMover::TreeMover(const bf::path& src, const bf::path& dst, bool merge)
+    : src_(src),
+      dst_(dst),
+      journal_path_(JournalPath(dst)),
+      merge_(merge),
+      journal_fd_(-1),
+      resuming_(false),
+      pool_(kMaxMoveThreads) {
+}
+
+TreeMover::~TreeMover() {
+  if (journal_fd_ >= 0)
+    close(journal_fd_);
+}
+
+bf::path TreeMover::JournalPath(const bf::path& dst) {
+  return dst.parent_path() / ("." + dst.filename().string() + ".move");
+}
+
+bool TreeMover::LoadJournal() {
+  std::ifstream journal(journal_path_.string());
+  if (!journal)
+    return !bf::exists(journal_path_);
+  resuming_ = true;
+  std::string line;
+  bool matches = true;
+  while (std::getline(journal, line)) {
+    if (line.size() < 2)
+      continue;
+    std::string value = line.substr(2);
+    switch (line[0]) {
+      case kJournalSource:
+        matches = matches && value == src_.string();
+        break;
+      case kJournalDestination:
+        matches = matches && value == dst_.string();
+        break;
+      case kJournalStarted:
+        started_.insert(value);
+        break;
+      case kJournalFinished:
+        finished_.insert(value);
+        break;
+    }
+  }
+  if (!matches) {
+    LOG(ERROR) << "Journal " << journal_path_ << " belongs to other move";
+    return false;
+  }
+  LOG(INFO) << "Resuming move of " << src_ << " to " << dst_
+            << ", already moved: " << finished_.size();
+  return true;
+}
+
+bool TreeMover::OpenJournal() {
+  bool exists = bf::exists(journal_path_);
+  journal_fd_ = open(journal_path_.c_str(),
+                     O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+  if (journal_fd_ < 0) {
+    LOG(ERROR) << "Cannot open journal " << journal_path_
+               << ", errno: " << errno;
+    return false;
+  }
+  if (exists)
+    return true;
+  std::string header = std::string(1, kJournalSource) + " " + src_.string() +
+      "\n" + kJournalDestination + " " + dst_.string() + "\n";
+  if (write(journal_fd_, header.data(), header.size()) !=
+      static_cast<ssize_t>(header.size()) || fdatasync(journal_fd_) != 0 ||
+      !SyncPath(journal_path_.parent_path(), O_RDONLY | O_DIRECTORY)) {
+    LOG(ERROR) << "Cannot write journal " << journal_path_
+               << ", errno: " << errno;
+    return false;
+  }
+  return true;
+}
+
+bool TreeMover::AppendJournal(char kind, const std::vector<Entry>& entries) {
+  std::string records;
+  for (auto& entry : entries) {
+    records += kind;
+    records += ' ';
+    records += entry.relative;
+    records += '\n';
+  }
+  if (write(journal_fd_, records.data(), records.size()) !=
+      static_cast<ssize_t>(records.size()) || fdatasync(journal_fd_) != 0) {
+    LOG(ERROR) << "Cannot write journal " << journal_path_
+               << ", errno: " << errno;
+    return false;
+  }
+  return true;
+}
+
+bool TreeMover::Move() {
+  if (!LoadJournal() || !OpenJournal())
+    return false;
+  bool result = MoveDirectory(bf::path());
+  if (result) {
+    bs::error_code error;
+    // sources of kept destination files and emptied directories
+    result = RemoveTree(src_, &error);
+  }
+  if (!result) {
+    LOG(ERROR) << "Failed to move " << src_ << " to " << dst_
+               << ", moving back " << finished_.size() << " entries";
+    Rollback();
+    return false;
+  }
+  close(journal_fd_);
+  journal_fd_ = -1;
+  unlink(journal_path_.c_str());
+  RegisterWrittenDirectory(journal_path_.parent_path());
+  RegisterWrittenDirectory(src_.parent_path());
+  return true;
+}
+
+bool TreeMover::MoveDirectory(const bf::path& relative) {
+  bf::path src_dir = src_ / relative;
+  bf::path dst_dir = dst_ / relative;
+  if (mkdir(dst_dir.c_str(), 0777) != 0) {
+    // created already by interrupted move
+    if (errno != EEXIST || (!merge_ && !resuming_ && !relative.empty())) {
+      LOG(ERROR) << "Cannot create directory " << dst_dir
+                 << ", errno: " << errno;
+      return false;
+    }
+  }
+
+  std::vector<Entry> batch;
+  std::vector<bf::path> subdirs;
+  uint64_t batch_bytes = 0;
+  bs::error_code error;
+  for (bf::directory_iterator it(src_dir, error);
+       !error && it != bf::directory_iterator(); it.increment(error)) {
+    bf::path entry_relative = relative / it->path().filename();
+    struct stat info;
+    if (lstat(it->path().c_str(), &info) != 0) {
+      LOG(ERROR) << "Cannot stat " << it->path() << ", errno: " << errno;
+      return false;
+    }
+    if (S_ISDIR(info.st_mode)) {
+      subdirs.push_back(entry_relative);
+      continue;
+    }
+    if (!S_ISREG(info.st_mode) && !S_ISLNK(info.st_mode)) {
+      LOG(ERROR) << "Cannot move " << it->path() << ", not a regular file";
+      return false;
+    }
+    if (entry_relative.string().find('\n') != std::string::npos) {
+      LOG(ERROR) << "Cannot journal name of " << it->path();
+      return false;
+    }
+    batch.push_back({entry_relative.string(), S_ISLNK(info.st_mode)});
+    batch_bytes += info.st_size;
+    if (batch.size() >= kMaxBatchFiles || batch_bytes >= kMaxBatchBytes) {
+      if (!MoveBatch(&batch))
+        return false;
+      batch_bytes = 0;
+    }
+  }
+  if (error) {
+    LOG(ERROR) << "Cannot read directory " << src_dir << ", "
+               << error.message();
+    return false;
+  }
+  if (!batch.empty() && !MoveBatch(&batch))
+    return false;
+  for (auto& subdir : subdirs) {
+    if (!MoveDirectory(subdir))
+      return false;
+  }
+  return true;
+}
+
+bool TreeMover::MoveBatch(std::vector<Entry>* batch) {
+  std::vector<CopyResult> results(batch->size(), CopyResult::FAILED);
+  // merge keeps destination files which were there before move, they are
+  // not journaled as started so that neither resumed move overwrites them
+  // nor rollback takes them away
+  std::vector<Entry> started;
+  for (size_t i = 0; i < batch->size(); ++i) {
+    const std::string& relative = (*batch)[i].relative;
+    struct stat info;
+    if (merge_ && !started_.count(relative) && !finished_.count(relative) &&
+        lstat((dst_ / relative).c_str(), &info) == 0)
+      results[i] = CopyResult::SKIPPED;
+    else
+      started.push_back((*batch)[i]);
+  }
+  if (!started.empty() && !AppendJournal(kJournalStarted, started))
+    return false;
+
+  for (size_t i = 0; i < batch->size(); ++i) {
+    if (results[i] == CopyResult::SKIPPED)
+      continue;
+    pool_.Submit([this, batch, &results, i] {
+      results[i] = CopyEntry((*batch)[i]);
+    });
+  }
+  pool_.Wait();
+
+  if (std::count(results.begin(), results.end(), CopyResult::FAILED)) {
+    // sources are still in place, copies of failed batch are not journaled
+    // as finished so rollback would not remove them
+    for (size_t i = 0; i < batch->size(); ++i) {
+      const std::string& relative = (*batch)[i].relative;
+      if (results[i] == CopyResult::COPIED && !finished_.count(relative))
+        unlink((dst_ / relative).c_str());
+    }
+    return false;
+  }
+
+  std::vector<Entry> copied;
+  std::set<bf::path> directories;
+  for (size_t i = 0; i < batch->size(); ++i) {
+    if (results[i] == CopyResult::COPIED) {
+      copied.push_back((*batch)[i]);
+      directories.insert((dst_ / (*batch)[i].relative).parent_path());
+    }
+  }
+  // new directory entries must be durable before sources are removed
+  for (auto& directory : directories) {
+    if (!SyncPath(directory, O_RDONLY | O_DIRECTORY)) {
+      LOG(ERROR) << "Cannot flush " << directory << ", errno: " << errno;
+      return false;
+    }
+  }
+  if (!copied.empty() && !AppendJournal(kJournalFinished, copied))
+    return false;
+  for (auto& entry : copied) {
+    finished_.insert(entry.relative);
+    bf::path src = src_ / entry.relative;
+    if (unlink(src.c_str()) != 0 && errno != ENOENT) {
+      LOG(ERROR) << "Cannot remove " << src << ", errno: " << errno;
+      return false;
+    }
+  }
+  batch->clear();
+  return true;
+}
+
+TreeMover::CopyResult TreeMover::CopyEntry(const Entry& entry) const {
+  bf::path src = src_ / entry.relative;
+  bf::path dst = dst_ / entry.relative;
+  // copied before interruption, only source was not removed yet
+  if (finished_.count(entry.relative))
+    return CopyResult::COPIED;
+  bool result;
+  if (entry.is_symlink) {
+    result = CopySymlink(src, dst, false);
+  } else {
+    result = CopyFileDurably(src.c_str(), dst.c_str(), O_EXCL);
+  }
+  if (!result && errno == EEXIST) {
+    // existing file may be partial copy only if interrupted move started
+    // copying it, files kept by merge are not copied at all
+    if (merge_ && !started_.count(entry.relative)) {
+      LOG(ERROR) << "Destination appeared during move: " << dst;
+      return CopyResult::FAILED;
+    }
+    if (entry.is_symlink)
+      result = CopySymlink(src, dst, true);
+    else
+      result = CopyFileDurably(src.c_str(), dst.c_str(), O_TRUNC);
+  }
+  if (!result) {
+    LOG(ERROR) << "Cannot copy " << src << " to " << dst
+               << ", errno: " << errno;
+    return CopyResult::FAILED;
+  }
+  return CopyResult::COPIED;
+}
+
+bool TreeMover::MoveEntryBack(const std::string& relative) const {
+  bf::path src = src_ / relative;
+  bf::path dst = dst_ / relative;
+  bs::error_code error;
+  bf::create_directories(src.parent_path(), error);
+  struct stat info;
+  if (error || lstat(dst.c_str(), &info) != 0)
+    return false;
+  bool result = S_ISLNK(info.st_mode) ? CopySymlink(dst, src, true) :
+      CopyFileDurably(dst.c_str(), src.c_str(), O_TRUNC);
+  if (!result || !SyncPath(src.parent_path(), O_RDONLY | O_DIRECTORY))
+    return false;
+  return unlink(dst.c_str()) == 0;
+}
+
+bool TreeMover::Rollback() {
+  if (journal_fd_ < 0 && !LoadJournal())
+    return false;
+  bool result = true;
+  for (auto& relative : finished_) {
+    if (!MoveEntryBack(relative)) {
+      LOG(ERROR) << "Cannot move back " << dst_ / relative
+                 << ", errno: " << errno;
+      result = false;
+    }
+  }
+  if (!result)
+    return false;
+  if (journal_fd_ >= 0) {
+    close(journal_fd_);
+    journal_fd_ = -1;
+  }
+  unlink(journal_path_.c_str());
+  // entries moved back were flushed one by one
+  RegisterWrittenDirectory(journal_path_.parent_path());
+  RegisterWrittenDirectory(src_.parent_path());
+  return true;
+}
+
+}  // namespace common_installer
@@ -0,0 +1,107 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_TREE_MOVER_H_
+#define COMMON_UTILS_TREE_MOVER_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/utils/macros.h"
+#include "common/utils/thread_pool.h"
+
+namespace common_installer {
+
+/**
+ * \brief Moves directory tree when it cannot be renamed, e.g. between
+ *        internal storage and sd card.
+ *
+ * Files are copied in batches by few threads. After every batch copied
+ * files and their directories are flushed, batch is recorded in journal
+ * and only then source files are unlinked, so peak disk usage grows by one
+ * batch instead of whole tree. Source directories are removed at the end.
+ *
+ * Journal is kept next to destination until move finishes. Moving the same
+ * tree again after interruption resumes it. If move fails, files moved so
+ * far are moved back to source.
+ *
+ * Symlinks are moved as symlinks and never followed. With merge, existing
+ * destination files are kept and their sources removed at the end, like
+ * CopyDir() followed by removal of source did.
+ */
+class TreeMover {
+ public:
+  /**
+   * Constructor
+   *
+   * \param src directory to move
+   * \param dst destination directory
+   * \param merge merge into existing destination directories
+   */
+  TreeMover(const boost::filesystem::path& src,
+            const boost::filesystem::path& dst, bool merge);
+  ~TreeMover();
+
+  /**
+   * \brief Moves tree, resuming interrupted move with the same source and
+   *        destination. Rolls back on failure.
+   *
+   * \return true if whole tree was moved and source removed
+   */
+  bool Move();
+
+  /**
+   * \brief Moves files recorded in journal back to source and removes
+   *        journal. Used also for journal left by interrupted move.
+   *
+   * \return true if all recorded files were moved back
+   */
+  bool Rollback();
+
+  /** \brief Returns path of journal used for given destination */
+  static boost::filesystem::path JournalPath(
+      const boost::filesystem::path& dst);
+
+ private:
+  enum class CopyResult {
+    COPIED,
+    SKIPPED,
+    FAILED
+  };
+
+  struct Entry {
+    std::string relative;
+    bool is_symlink;
+  };
+
+  bool LoadJournal();
+  bool OpenJournal();
+  bool AppendJournal(char kind, const std::vector<Entry>& entries);
+  bool MoveDirectory(const boost::filesystem::path& relative);
+  bool MoveBatch(std::vector<Entry>* batch);
+  CopyResult CopyEntry(const Entry& entry) const;
+  bool MoveEntryBack(const std::string& relative) const;
+
+  boost::filesystem::path src_;
+  boost::filesystem::path dst_;
+  boost::filesystem::path journal_path_;
+  bool merge_;
+  int journal_fd_;
+  /** journal of interrupted move was found */
+  bool resuming_;
+  /** entries which copy was started by interrupted move */
+  std::set<std::string> started_;
+  /** entries copied and flushed, by this or interrupted move */
+  std::set<std::string> finished_;
+  ThreadPool pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(TreeMover);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_TREE_MOVER_H_
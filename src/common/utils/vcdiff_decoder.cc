@@ -0,0 +1,537 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/vcdiff_decoder.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "common/utils/byte_size_literals.h"
+
+namespace {
+
+const uint8_t kVcdiffMagic[] = {0xD6, 0xC3, 0xC4};
+
+// header indicator bits
+const uint8_t kVcdDecompress = 0x01;
+const uint8_t kVcdCodeTable = 0x02;
+const uint8_t kVcdAppHeader = 0x04;  // xdelta3 extension
+
+// window indicator bits
+const uint8_t kVcdSource = 0x01;
+const uint8_t kVcdTarget = 0x02;
+const uint8_t kVcdAdler32 = 0x04;  // xdelta3 extension
+
+// xdelta3 never produces bigger target windows
+const uint64_t kMaxTargetWindowSize = 16_MB;
+// delta encoding contains at most target window and instructions for it
+const uint64_t kMaxDeltaEncodingSize = 4 * kMaxTargetWindowSize;
+const uint64_t kMaxTargetSegmentSize = 64_MB;
+
+const size_t kReadBufferSize = 64_kB;
+
+enum InstructionType : uint8_t {
+  NOOP = 0,
+  ADD = 1,
+  RUN = 2,
+  COPY = 3
+};
+
+struct Instruction {
+  uint8_t type;
+  uint8_t size;
+  uint8_t mode;
+};
+
+struct CodeTableEntry {
+  Instruction first;
+  Instruction second;
+};
+
+// default code table, RFC 3284 section 5.6
+class DefaultCodeTable {
+ public:
+  DefaultCodeTable() {
+    size_t i = 0;
+    entries_[i++] = {{RUN, 0, 0}, {NOOP, 0, 0}};
+    for (uint8_t size = 0; size <= 17; ++size)
+      entries_[i++] = {{ADD, size, 0}, {NOOP, 0, 0}};
+    for (uint8_t mode = 0; mode <= 8; ++mode) {
+      entries_[i++] = {{COPY, 0, mode}, {NOOP, 0, 0}};
+      for (uint8_t size = 4; size <= 18; ++size)
+        entries_[i++] = {{COPY, size, mode}, {NOOP, 0, 0}};
+    }
+    for (uint8_t mode = 0; mode <= 5; ++mode) {
+      for (uint8_t add = 1; add <= 4; ++add) {
+        for (uint8_t copy = 4; copy <= 6; ++copy)
+          entries_[i++] = {{ADD, add, 0}, {COPY, copy, mode}};
+      }
+    }
+    for (uint8_t mode = 6; mode <= 8; ++mode) {
+      for (uint8_t add = 1; add <= 4; ++add)
+        entries_[i++] = {{ADD, add, 0}, {COPY, 4, mode}};
+    }
+    for (uint8_t mode = 0; mode <= 8; ++mode)
+      entries_[i++] = {{COPY, 4, mode}, {ADD, 1, 0}};
+  }
+
+  const CodeTableEntry& operator[](uint8_t index) const {
+    return entries_[index];
+  }
+
+ private:
+  CodeTableEntry entries_[256];
+};
+
+const DefaultCodeTable kCodeTable;
+
+// reads integers and bytes from memory, failing on overrun
+class Cursor {
+ public:
+  Cursor(const uint8_t* data, size_t size)
+      : data_(data), end_(data + size) { }
+
+  bool ReadByte(uint8_t* value) {
+    if (data_ == end_)
+      return false;
+    *value = *data_++;
+    return true;
+  }
+
+  // RFC 3284 integer: base 128, most significant digit first
+  bool ReadInteger(uint64_t* value) {
+    uint64_t result = 0;
+    for (int i = 0; i < 10; ++i) {
+      uint8_t byte;
+      if (!ReadByte(&byte) || (result >> 57) != 0)
+        return false;
+      result = (result << 7) | (byte & 0x7F);
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const uint8_t* Take(uint64_t size) {
+    if (size > static_cast<uint64_t>(end_ - data_))
+      return nullptr;
+    const uint8_t* result = data_;
+    data_ += size;
+    return result;
+  }
+
+  bool AtEnd() const { return data_ == end_; }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* end_;
+};
+
+// near and same address caches, RFC 3284 section 5.1
+class AddressCache {
+ public:
+  static const unsigned kNearSize = 4;
+  static const unsigned kSameSize = 3;
+
+  AddressCache() : next_near_(0) {
+    memset(near_, 0, sizeof(near_));
+    memset(same_, 0, sizeof(same_));
+  }
+
+  bool Decode(uint64_t here, uint8_t mode, Cursor* addresses,
+              uint64_t* address) {
+    uint64_t value;
+    if (mode < kNearSize + 2) {
+      if (!addresses->ReadInteger(&value))
+        return false;
+      if (mode == 0) {
+        *address = value;
+      } else if (mode == 1) {
+        if (value > here)
+          return false;
+        *address = here - value;
+      } else {
+        *address = near_[mode - 2] + value;
+      }
+    } else if (mode < kNearSize + kSameSize + 2) {
+      uint8_t byte;
+      if (!addresses->ReadByte(&byte))
+        return false;
+      *address = same_[(mode - kNearSize - 2) * 256 + byte];
+    } else {
+      return false;
+    }
+    if (*address >= here)
+      return false;
+    near_[next_near_] = *address;
+    next_near_ = (next_near_ + 1) % kNearSize;
+    same_[*address % (kSameSize * 256)] = *address;
+    return true;
+  }
+
+ private:
+  uint64_t near_[kNearSize];
+  unsigned next_near_;
+  uint64_t same_[kSameSize * 256];
+};
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+// buffered sequential reader of delta file
+class VcdiffDecoder::Reader {
+ public:
+  explicit Reader(int fd)
+      : fd_(fd), buffer_(new uint8_t[kReadBufferSize]), pos_(0), size_(0),
+        failed_(false) { }
+
+  // returns false on end of file or error, check failed() to tell them apart
+  bool ReadByte(uint8_t* value) {
+    if (pos_ == size_ && !Fill())
+      return false;
+    *value = buffer_[pos_++];
+    return true;
+  }
+
+  bool ReadInteger(uint64_t* value) {
+    uint64_t result = 0;
+    for (int i = 0; i < 10; ++i) {
+      uint8_t byte;
+      if (!ReadByte(&byte) || (result >> 57) != 0)
+        return false;
+      result = (result << 7) | (byte & 0x7F);
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadBytes(uint8_t* out, uint64_t size) {
+    while (size > 0) {
+      if (pos_ == size_ && !Fill())
+        return false;
+      size_t count = std::min<uint64_t>(size, size_ - pos_);
+      memcpy(out, buffer_.get() + pos_, count);
+      pos_ += count;
+      out += count;
+      size -= count;
+    }
+    return true;
+  }
+
+  bool Skip(uint64_t size) {
+    while (size > 0) {
+      if (pos_ == size_ && !Fill())
+        return false;
+      size_t count = std::min<uint64_t>(size, size_ - pos_);
+      pos_ += count;
+      size -= count;
+    }
+    return true;
+  }
+
+  bool failed() const { return failed_; }
+
+ private:
+  bool Fill() {
+    while (true) {
+      ssize_t count = read(fd_, buffer_.get(), kReadBufferSize);
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count < 0)
+        failed_ = true;
+      if (count <= 0)
+        return false;
+      pos_ = 0;
+      size_ = count;
+      return true;
+    }
+  }
+
+  int fd_;
+  std::unique_ptr<uint8_t[]> buffer_;
+  size_t pos_;
+  size_t size_;
+  bool failed_;
+};
+
+VcdiffDecoder::VcdiffDecoder()
+    : source_(nullptr),
+      source_size_(0),
+      segment_(nullptr),
+      segment_size_(0),
+      target_written_(0) {
+}
+
+VcdiffDecoder::~VcdiffDecoder() {
+  if (source_)
+    munmap(const_cast<uint8_t*>(source_), source_size_);
+}
+
+VcdiffDecoder::Result VcdiffDecoder::Decode(int source_fd, int delta_fd,
+                                            int target_fd) {
+  struct stat info;
+  if (fstat(source_fd, &info) != 0) {
+    LOG(ERROR) << "Cannot stat delta source, errno: " << errno;
+    return Result::ERROR;
+  }
+  if (info.st_size > 0) {
+    void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                         source_fd, 0);
+    if (address == MAP_FAILED) {
+      LOG(ERROR) << "Cannot map delta source, errno: " << errno;
+      return Result::ERROR;
+    }
+    source_ = static_cast<const uint8_t*>(address);
+    source_size_ = info.st_size;
+  }
+
+  Reader reader(delta_fd);
+  uint8_t header[5];
+  if (!reader.ReadBytes(header, sizeof(header)) ||
+      memcmp(header, kVcdiffMagic, sizeof(kVcdiffMagic)) != 0) {
+    LOG(ERROR) << "Delta is not in VCDIFF format";
+    return Result::ERROR;
+  }
+  // version byte: 0 is RFC 3284, 'S' is extension of open-vcdiff
+  if (header[3] != 0)
+    return Result::UNSUPPORTED;
+  uint8_t indicator = header[4];
+  if (indicator & (kVcdDecompress | kVcdCodeTable))
+    return Result::UNSUPPORTED;
+  if (indicator & kVcdAppHeader) {
+    uint64_t size;
+    if (!reader.ReadInteger(&size) || !reader.Skip(size)) {
+      LOG(ERROR) << "Truncated VCDIFF header";
+      return Result::ERROR;
+    }
+  }
+
+  uint8_t window_indicator;
+  while (reader.ReadByte(&window_indicator)) {
+    Result result = DecodeWindow(&reader, window_indicator, target_fd);
+    if (result != Result::OK)
+      return result;
+  }
+  if (reader.failed()) {
+    LOG(ERROR) << "Failed to read delta, errno: " << errno;
+    return Result::ERROR;
+  }
+  return Result::OK;
+}
+
+VcdiffDecoder::Result VcdiffDecoder::DecodeWindow(Reader* reader,
+                                                  uint8_t indicator,
+                                                  int target_fd) {
+  if (indicator & ~(kVcdSource | kVcdTarget | kVcdAdler32) ||
+      (indicator & kVcdSource && indicator & kVcdTarget)) {
+    LOG(ERROR) << "Invalid VCDIFF window indicator: "
+               << static_cast<int>(indicator);
+    return Result::ERROR;
+  }
+  uint64_t segment_size = 0;
+  uint64_t segment_position = 0;
+  uint64_t delta_size;
+  if (((indicator & (kVcdSource | kVcdTarget)) &&
+       (!reader->ReadInteger(&segment_size) ||
+        !reader->ReadInteger(&segment_position))) ||
+      !reader->ReadInteger(&delta_size) ||
+      delta_size > kMaxDeltaEncodingSize) {
+    LOG(ERROR) << "Invalid VCDIFF window header";
+    return Result::ERROR;
+  }
+  if (!LoadSourceSegment(indicator, segment_size, segment_position,
+                         target_fd))
+    return Result::ERROR;
+
+  delta_.resize(delta_size);
+  if (!reader->ReadBytes(delta_.data(), delta_size)) {
+    LOG(ERROR) << "Truncated VCDIFF window";
+    return Result::ERROR;
+  }
+  Cursor delta(delta_.data(), delta_.size());
+  uint64_t target_size;
+  uint8_t delta_indicator;
+  uint64_t data_size;
+  uint64_t instructions_size;
+  uint64_t addresses_size;
+  if (!delta.ReadInteger(&target_size) ||
+      target_size > kMaxTargetWindowSize ||
+      !delta.ReadByte(&delta_indicator) ||
+      !delta.ReadInteger(&data_size) ||
+      !delta.ReadInteger(&instructions_size) ||
+      !delta.ReadInteger(&addresses_size)) {
+    LOG(ERROR) << "Invalid VCDIFF delta encoding";
+    return Result::ERROR;
+  }
+  // secondary compression of sections
+  if (delta_indicator != 0)
+    return Result::UNSUPPORTED;
+  uint32_t checksum = 0;
+  if (indicator & kVcdAdler32) {
+    const uint8_t* bytes = delta.Take(4);
+    if (!bytes)
+      return Result::ERROR;
+    checksum = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) |
+        bytes[3];
+  }
+  const uint8_t* data = delta.Take(data_size);
+  const uint8_t* instructions = delta.Take(instructions_size);
+  const uint8_t* addresses = delta.Take(addresses_size);
+  if (!data || !instructions || !addresses || !delta.AtEnd()) {
+    LOG(ERROR) << "Invalid VCDIFF section sizes";
+    return Result::ERROR;
+  }
+
+  window_.resize(target_size);
+  if (!ExecuteInstructions(data, data_size, instructions, instructions_size,
+                           addresses, addresses_size)) {
+    LOG(ERROR) << "Invalid VCDIFF instructions";
+    return Result::ERROR;
+  }
+  if ((indicator & kVcdAdler32) &&
+      adler32(1, window_.data(), window_.size()) != checksum) {
+    LOG(ERROR) << "VCDIFF window checksum mismatch";
+    return Result::ERROR;
+  }
+  if (!WriteAll(target_fd, window_.data(), window_.size())) {
+    LOG(ERROR) << "Failed to write patched file, errno: " << errno;
+    return Result::ERROR;
+  }
+  target_written_ += window_.size();
+  return Result::OK;
+}
+
+bool VcdiffDecoder::LoadSourceSegment(uint8_t indicator, uint64_t size,
+                                      uint64_t position, int target_fd) {
+  segment_ = nullptr;
+  segment_size_ = size;
+  if (indicator & kVcdSource) {
+    if (position > source_size_ || size > source_size_ - position) {
+      LOG(ERROR) << "VCDIFF source segment out of source file";
+      return false;
+    }
+    segment_ = source_ + position;
+  } else if (indicator & kVcdTarget) {
+    if (position > target_written_ || size > target_written_ - position ||
+        size > kMaxTargetSegmentSize) {
+      LOG(ERROR) << "VCDIFF target segment out of decoded data";
+      return false;
+    }
+    target_segment_.resize(size);
+    uint8_t* out = target_segment_.data();
+    while (size > 0) {
+      ssize_t count = pread(target_fd, out, size, position);
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0) {
+        LOG(ERROR) << "Failed to read decoded data, errno: " << errno;
+        return false;
+      }
+      out += count;
+      position += count;
+      size -= count;
+    }
+    segment_ = target_segment_.data();
+  }
+  return true;
+}
+
+bool VcdiffDecoder::ExecuteInstructions(const uint8_t* data,
+                                        size_t data_size,
+                                        const uint8_t* instructions,
+                                        size_t instructions_size,
+                                        const uint8_t* addresses,
+                                        size_t addresses_size) {
+  Cursor data_cursor(data, data_size);
+  Cursor instruction_cursor(instructions, instructions_size);
+  Cursor address_cursor(addresses, addresses_size);
+  AddressCache cache;
+  uint8_t* target = window_.data();
+  uint64_t target_size = window_.size();
+  uint64_t position = 0;
+
+  while (!instruction_cursor.AtEnd()) {
+    uint8_t index;
+    instruction_cursor.ReadByte(&index);
+    const CodeTableEntry& entry = kCodeTable[index];
+    for (const Instruction* instruction : {&entry.first, &entry.second}) {
+      if (instruction->type == NOOP)
+        continue;
+      uint64_t size = instruction->size;
+      if (size == 0 && !instruction_cursor.ReadInteger(&size))
+        return false;
+      if (size > target_size - position)
+        return false;
+      switch (instruction->type) {
+        case ADD: {
+          const uint8_t* bytes = data_cursor.Take(size);
+          if (!bytes)
+            return false;
+          memcpy(target + position, bytes, size);
+          break;
+        }
+        case RUN: {
+          uint8_t byte;
+          if (!data_cursor.ReadByte(&byte))
+            return false;
+          memset(target + position, byte, size);
+          break;
+        }
+        case COPY: {
+          // addresses span source segment followed by target window
+          uint64_t here = segment_size_ + position;
+          uint64_t address;
+          if (!cache.Decode(here, instruction->mode, &address_cursor,
+                            &address))
+            return false;
+          uint64_t done = 0;
+          if (address < segment_size_) {
+            done = std::min(size, segment_size_ - address);
+            memcpy(target + position, segment_ + address, done);
+            address += done;
+          }
+          // target part may overlap with output, which repeats pattern
+          const uint8_t* from = target + (address - segment_size_);
+          for (uint64_t i = done; i < size; ++i)
+            target[position + i] = *from++;
+          break;
+        }
+      }
+      position += size;
+    }
+  }
+  return position == target_size && data_cursor.AtEnd() &&
+      address_cursor.AtEnd();
+}
+
+}  // namespace common_installer
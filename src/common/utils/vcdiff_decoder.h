@@ -0,0 +1,76 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_VCDIFF_DECODER_H_
+#define COMMON_UTILS_VCDIFF_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Decoder of VCDIFF (RFC 3284) deltas, as produced by xdelta3.
+ *
+ * Delta is read and applied window by window, so memory use is bound by
+ * window sizes, not by file sizes. Default code table is supported, with
+ * xdelta3 extensions: application header and adler32 checksum of windows.
+ * Secondary compression and custom code tables are reported as
+ * UNSUPPORTED, so that caller may fall back to xdelta3 tool.
+ */
+class VcdiffDecoder {
+ public:
+  enum class Result {
+    OK,
+    UNSUPPORTED,  // delta uses features which are not implemented
+    ERROR         // delta is corrupted or i/o failed
+  };
+
+  VcdiffDecoder();
+  ~VcdiffDecoder();
+
+  /**
+   * \brief Applies delta to source and writes result to target
+   *
+   * \param source_fd descriptor of source file
+   * \param delta_fd descriptor of delta, read from its current position
+   * \param target_fd descriptor of empty target file, opened for reading
+   *                  and writing (windows may copy from earlier output)
+   *
+   * \return decoding result
+   */
+  Result Decode(int source_fd, int delta_fd, int target_fd);
+
+ private:
+  class Reader;
+
+  Result DecodeWindow(Reader* reader, uint8_t indicator, int target_fd);
+  bool LoadSourceSegment(uint8_t indicator, uint64_t size, uint64_t position,
+                         int target_fd);
+  bool ExecuteInstructions(const uint8_t* data, size_t data_size,
+                           const uint8_t* instructions,
+                           size_t instructions_size,
+                           const uint8_t* addresses, size_t addresses_size);
+
+  // source file, mapped
+  const uint8_t* source_;
+  uint64_t source_size_;
+  // source segment of current window
+  const uint8_t* segment_;
+  uint64_t segment_size_;
+  // segment copied from earlier output (VCD_TARGET)
+  std::vector<uint8_t> target_segment_;
+  std::vector<uint8_t> delta_;
+  std::vector<uint8_t> window_;
+  uint64_t target_written_;
+
+  DISALLOW_COPY_AND_ASSIGN(VcdiffDecoder);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_VCDIFF_DECODER_H_
@@ -0,0 +1,287 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/vcdiff_encoder.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "common/utils/byte_size_literals.h"
+
+namespace {
+
+const uint8_t kVcdiffHeader[] = {0xD6, 0xC3, 0xC4, 0x00, 0x00};
+
+// window indicator bits
+const uint8_t kVcdSource = 0x01;
+const uint8_t kVcdAdler32 = 0x04;  // xdelta3 extension
+
+// half of what VcdiffDecoder accepts
+const size_t kWindowSize = 8_MB;
+// source is indexed in blocks of this size, shorter matches are not found
+const size_t kBlockSize = 16;
+const uint32_t kHashBase = 0x01000193;
+
+// layout of default code table, RFC 3284 section 5.6
+const uint8_t kAddIndex = 1;              // ADD with size 0..17
+const uint8_t kMaxAddSize = 17;
+const uint8_t kCopyIndex = 19;            // COPY with size 0, 4..18 per mode
+const uint8_t kMinCopySize = 4;
+const uint8_t kMaxCopySize = 18;
+const uint8_t kAddCopyIndex = 163;        // ADD 1..4 + COPY 4..6, modes 0..5
+const uint8_t kAddCopy4Index = 235;       // ADD 1..4 + COPY 4, modes 6..8
+const uint8_t kMaxPairAddSize = 4;
+const uint8_t kMaxPairCopySize = 6;
+
+const unsigned kNearSize = 4;
+const unsigned kSameSize = 3;
+const uint8_t kNearMode = 2;
+const uint8_t kSameMode = kNearMode + kNearSize;
+
+void PutInteger(std::vector<uint8_t>* out, uint64_t value) {
+  uint8_t digits[10];
+  int count = 0;
+  do {
+    digits[count++] = value & 0x7F;
+    value >>= 7;
+  } while (value);
+  while (count > 1)
+    out->push_back(digits[--count] | 0x80);
+  out->push_back(digits[0]);
+}
+
+size_t IntegerSize(uint64_t value) {
+  size_t size = 1;
+  while (value >>= 7)
+    ++size;
+  return size;
+}
+
+uint32_t HashBlock(const uint8_t* data) {
+  uint32_t hash = 0;
+  for (size_t i = 0; i < kBlockSize; ++i)
+    hash = hash * kHashBase + data[i];
+  return hash;
+}
+
+uint32_t HashBasePower() {
+  uint32_t power = 1;
+  for (size_t i = 1; i < kBlockSize; ++i)
+    power *= kHashBase;
+  return power;
+}
+
+const uint32_t kHashRemovePower = HashBasePower();
+
+uint32_t RollHash(uint32_t hash, uint8_t removed, uint8_t added) {
+  return (hash - removed * kHashRemovePower) * kHashBase + added;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+// builds sections of one target window
+class VcdiffEncoder::Window {
+ public:
+  explicit Window(uint64_t segment_size)
+      : segment_size_(segment_size), pending_add_size_(0), next_near_(0) {
+    memset(near_, 0, sizeof(near_));
+    memset(same_, 0, sizeof(same_));
+  }
+
+  void Add(const uint8_t* data, size_t size) {
+    FlushAdd();
+    pending_add_size_ = size;
+    data_.insert(data_.end(), data, data + size);
+  }
+
+  // position is offset of copied data in target window
+  void Copy(uint64_t address, uint64_t size, uint64_t position) {
+    uint8_t mode;
+    EncodeAddress(address, segment_size_ + position, &mode);
+    // small ADD followed by short COPY fits into one instruction
+    uint64_t max_pair_copy_size =
+        mode < kSameMode ? kMaxPairCopySize : kMinCopySize;
+    if (pending_add_size_ >= 1 && pending_add_size_ <= kMaxPairAddSize &&
+        size >= kMinCopySize && size <= max_pair_copy_size) {
+      uint8_t add = pending_add_size_ - 1;
+      if (mode < kSameMode)
+        instructions_.push_back(kAddCopyIndex + mode * 12 + add * 3 +
+                                (size - kMinCopySize));
+      else
+        instructions_.push_back(kAddCopy4Index + (mode - kSameMode) * 4 +
+                                add);
+      pending_add_size_ = 0;
+      return;
+    }
+    FlushAdd();
+    uint8_t index = kCopyIndex + mode * 16;
+    if (size >= kMinCopySize && size <= kMaxCopySize) {
+      instructions_.push_back(index + 1 + (size - kMinCopySize));
+    } else {
+      instructions_.push_back(index);
+      PutInteger(&instructions_, size);
+    }
+  }
+
+  void Write(const uint8_t* target, size_t target_size,
+             std::vector<uint8_t>* out) {
+    FlushAdd();
+    std::vector<uint8_t> encoding;
+    PutInteger(&encoding, target_size);
+    encoding.push_back(0);  // no secondary compression
+    PutInteger(&encoding, data_.size());
+    PutInteger(&encoding, instructions_.size());
+    PutInteger(&encoding, addresses_.size());
+    uint32_t checksum = adler32(1, target, target_size);
+    for (int shift = 24; shift >= 0; shift -= 8)
+      encoding.push_back((checksum >> shift) & 0xFF);
+    encoding.insert(encoding.end(), data_.begin(), data_.end());
+    encoding.insert(encoding.end(), instructions_.begin(),
+                    instructions_.end());
+    encoding.insert(encoding.end(), addresses_.begin(), addresses_.end());
+
+    if (segment_size_ > 0) {
+      out->push_back(kVcdSource | kVcdAdler32);
+      PutInteger(out, segment_size_);
+      PutInteger(out, 0);
+    } else {
+      out->push_back(kVcdAdler32);
+    }
+    PutInteger(out, encoding.size());
+    out->insert(out->end(), encoding.begin(), encoding.end());
+  }
+
+ private:
+  void FlushAdd() {
+    if (pending_add_size_ == 0)
+      return;
+    if (pending_add_size_ <= kMaxAddSize) {
+      instructions_.push_back(kAddIndex + pending_add_size_);
+    } else {
+      instructions_.push_back(kAddIndex);
+      PutInteger(&instructions_, pending_add_size_);
+    }
+    pending_add_size_ = 0;
+  }
+
+  // picks shortest of address modes, RFC 3284 section 5.3, and updates
+  // caches as decoder will
+  void EncodeAddress(uint64_t address, uint64_t here, uint8_t* mode) {
+    uint64_t same_key = address % (kSameSize * 256);
+    if (same_[same_key] == address) {
+      *mode = kSameMode + same_key / 256;
+      addresses_.push_back(same_key % 256);
+    } else {
+      uint64_t value = address;
+      *mode = 0;
+      if (IntegerSize(here - address) < IntegerSize(value)) {
+        value = here - address;
+        *mode = 1;
+      }
+      for (unsigned i = 0; i < kNearSize; ++i) {
+        if (address >= near_[i] &&
+            IntegerSize(address - near_[i]) < IntegerSize(value)) {
+          value = address - near_[i];
+          *mode = kNearMode + i;
+        }
+      }
+      PutInteger(&addresses_, value);
+    }
+    near_[next_near_] = address;
+    next_near_ = (next_near_ + 1) % kNearSize;
+    same_[same_key] = address;
+  }
+
+  uint64_t segment_size_;
+  std::vector<uint8_t> data_;
+  std::vector<uint8_t> instructions_;
+  std::vector<uint8_t> addresses_;
+  size_t pending_add_size_;
+  uint64_t near_[kNearSize];
+  unsigned next_near_;
+  uint64_t same_[kSameSize * 256];
+};
+
+VcdiffEncoder::VcdiffEncoder(const uint8_t* source, size_t source_size)
+    : source_(source),
+      source_size_(source_size),
+      hash_mask_(0) {
+  // offsets are kept in 32 bits
+  size_t indexed_size = std::min<size_t>(
+      source_size, std::numeric_limits<uint32_t>::max() - kBlockSize);
+  size_t block_count = indexed_size / kBlockSize;
+  if (block_count == 0)
+    return;
+  size_t table_size = 1;
+  while (table_size < 2 * block_count)
+    table_size <<= 1;
+  blocks_.assign(table_size, 0);
+  hash_mask_ = table_size - 1;
+  for (size_t offset = 0; offset + kBlockSize <= indexed_size;
+       offset += kBlockSize)
+    blocks_[HashBlock(source_ + offset) & hash_mask_] = offset + 1;
+}
+
+VcdiffEncoder::~VcdiffEncoder() { }
+
+uint32_t VcdiffEncoder::FindBlock(const uint8_t* block, uint32_t hash) const {
+  uint32_t entry = blocks_[hash & hash_mask_];
+  if (entry && memcmp(source_ + entry - 1, block, kBlockSize) == 0)
+    return entry;
+  return 0;
+}
+
+void VcdiffEncoder::Encode(const uint8_t* target, size_t target_size,
+                           std::vector<uint8_t>* delta) const {
+  delta->assign(kVcdiffHeader, kVcdiffHeader + sizeof(kVcdiffHeader));
+  for (size_t start = 0; start < target_size; start += kWindowSize) {
+    size_t end = std::min(target_size, start + kWindowSize);
+    Window window(source_size_);
+    // beginning of data not covered by copies yet
+    size_t literal = start;
+    size_t pos = start;
+    if (!blocks_.empty() && end - start >= kBlockSize) {
+      uint32_t hash = HashBlock(target + pos);
+      while (pos + kBlockSize <= end) {
+        uint32_t entry = FindBlock(target + pos, hash);
+        if (!entry) {
+          if (pos + kBlockSize < end)
+            hash = RollHash(hash, target[pos], target[pos + kBlockSize]);
+          ++pos;
+          continue;
+        }
+        // extend match in both directions
+        size_t source_pos = entry - 1;
+        size_t back = 0;
+        while (pos - back > literal && source_pos - back > 0 &&
+               target[pos - back - 1] == source_[source_pos - back - 1])
+          ++back;
+        size_t target_end = pos + kBlockSize;
+        size_t source_end = source_pos + kBlockSize;
+        while (target_end < end && source_end < source_size_ &&
+               target[target_end] == source_[source_end]) {
+          ++target_end;
+          ++source_end;
+        }
+        pos -= back;
+        if (pos > literal)
+          window.Add(target + literal, pos - literal);
+        window.Copy(source_pos - back, target_end - pos, pos - start);
+        pos = literal = target_end;
+        if (pos + kBlockSize <= end)
+          hash = HashBlock(target + pos);
+      }
+    }
+    if (end > literal)
+      window.Add(target + literal, end - literal);
+    window.Write(target + start, end - start, delta);
+  }
+}
+
+}  // namespace common_installer
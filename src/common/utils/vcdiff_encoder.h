@@ -0,0 +1,62 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_VCDIFF_ENCODER_H_
+#define COMMON_UTILS_VCDIFF_ENCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Encoder of VCDIFF (RFC 3284) deltas, counterpart of VcdiffDecoder.
+ *
+ * Output uses default code table, no secondary compression and xdelta3
+ * adler32 checksums of windows, so it can be applied by VcdiffDecoder as
+ * well as by xdelta3 tool. Target is matched only against source, with
+ * blocks of source indexed by hash, which is good enough for files of
+ * package versions, where unchanged parts are long.
+ */
+class VcdiffEncoder {
+ public:
+  /**
+   * Constructor. Indexes source.
+   *
+   * \param source source data, must outlive encoder
+   * \param source_size size of source
+   */
+  VcdiffEncoder(const uint8_t* source, size_t source_size);
+  ~VcdiffEncoder();
+
+  /**
+   * \brief Encodes target as delta against source
+   *
+   * \param target target data
+   * \param target_size size of target
+   * \param delta output, replaced with whole VCDIFF file
+   */
+  void Encode(const uint8_t* target, size_t target_size,
+              std::vector<uint8_t>* delta) const;
+
+ private:
+  class Window;
+
+  uint32_t FindBlock(const uint8_t* block, uint32_t hash) const;
+
+  const uint8_t* source_;
+  size_t source_size_;
+  // source offset + 1 of last block with given hash bits, 0 if none
+  std::vector<uint32_t> blocks_;
+  uint32_t hash_mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(VcdiffEncoder);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_VCDIFF_ENCODER_H_
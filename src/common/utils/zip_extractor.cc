@@ -0,0 +1,762 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/zip_extractor.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <unzip.h>
+#include <zlib.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <vector>
+
+#include "common/utils/byte_size_literals.h"
+#include "common/utils/file_copy.h"
+#include "common/utils/file_util.h"
+#include "common/utils/inflater.h"
+#include "common/utils/macros.h"
+#include "common/utils/sync_registry.h"
+#include "common/utils/thread_pool.h"
+#include "common/utils/zip_format.h"
+#include "common/utils/zstd_decompressor.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using common_installer::kZipFlagEncrypted;
+using common_installer::kZipMethodDeflated;
+using common_installer::kZipMethodStored;
+using common_installer::kZipMethodZstd;
+
+// archives smaller than this are extracted by calling thread
+const uint64_t kMinParallelExtractSize = 1_MB;
+
+// estimated cost of creating file, expressed in bytes, used for balancing
+const uint64_t kPerFileCost = 4_kB;
+
+// deflated entries up to this size are inflated at once from archive mapping
+const uint64_t kMaxInMemoryInflateSize = 32_MB;
+
+const char kSignatureAuthor[] = "author-signature.xml";
+const char kRegexDistributorSignature[] = "^signature[1-9][0-9]*\\.xml$";
+
+class UnzFilePointer {
+ public:
+  UnzFilePointer()
+    : zipFile_(nullptr),
+      fileOpened_(false),
+      currentFileOpened_(false) { }
+
+  ~UnzFilePointer() {
+    if (currentFileOpened_)
+      unzCloseCurrentFile(zipFile_);
+    if (fileOpened_)
+      unzClose(zipFile_);
+  }
+
+  bool Open(const common_installer::MappedArchive& archive) {
+    zipFile_ = static_cast<unzFile*>(archive.OpenUnzip());
+    if (!zipFile_)
+       return false;
+    fileOpened_ = true;
+    return true;
+  }
+
+  bool OpenCurrent() {
+    if (unzOpenCurrentFile(zipFile_) != UNZ_OK)
+      return false;
+    currentFileOpened_ = true;
+    return true;
+  }
+
+  bool OpenCurrentRaw() {
+    int method;
+    int level;
+    if (unzOpenCurrentFile2(zipFile_, &method, &level, 1) != UNZ_OK)
+      return false;
+    currentFileOpened_ = true;
+    return true;
+  }
+
+  bool GoTo(const common_installer::ZipEntry& entry) {
+    unz64_file_pos position;
+    position.pos_in_zip_directory = entry.directory_offset;
+    position.num_of_file = entry.file_number;
+    return unzGoToFilePos64(zipFile_, &position) == UNZ_OK;
+  }
+
+  // returns false also if crc check of fully read entry failed
+  bool CloseCurrent() {
+    int ret = UNZ_OK;
+    if (currentFileOpened_)
+      ret = unzCloseCurrentFile(zipFile_);
+    currentFileOpened_ = false;
+    return ret == UNZ_OK;
+  }
+
+  unzFile* Get() { return zipFile_; }
+
+ private:
+  unzFile* zipFile_;
+  bool fileOpened_;
+  bool currentFileOpened_;
+};
+
+bool IsDirectoryEntry(const common_installer::ZipEntry& entry) {
+  return !entry.name.empty() && entry.name.back() == '/';
+}
+
+uint64_t EntryCost(const common_installer::ZipEntry* entry) {
+  return entry->uncompressed_size + kPerFileCost;
+}
+
+bool IsSignatureFile(const std::string& name) {
+  static const std::regex distributor_regex(kRegexDistributorSignature);
+  return name == kSignatureAuthor ||
+         std::regex_search(name, distributor_regex);
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool CopyRangeBuffered(const common_installer::MappedArchive& archive,
+                       uint64_t offset, int out_fd, uint64_t size,
+                       char* buffer, size_t buffer_size) {
+  if (archive.data())
+    return WriteAll(out_fd, reinterpret_cast<const char*>(archive.data()) +
+                    offset, size);
+  while (size > 0) {
+    int64_t count = archive.Read(offset, buffer,
+                                 std::min<uint64_t>(size, buffer_size));
+    if (count <= 0) {
+      errno = EIO;
+      return false;
+    }
+    if (!WriteAll(out_fd, buffer, count))
+      return false;
+    offset += count;
+    size -= count;
+  }
+  return true;
+}
+
+// reads archive data calculating its crc and digests, both are optional
+bool ScanArchiveData(const common_installer::MappedArchive& archive,
+                     uint64_t offset, uint64_t size, uint32_t* crc,
+                     common_installer::DigestCalculator* calculator,
+                     common_installer::Inflater* inflater,
+                     char* buffer, size_t buffer_size) {
+  if (crc)
+    *crc = 0;
+  while (size > 0) {
+    uInt chunk = std::min<uint64_t>(size, buffer_size);
+    const Bytef* data = nullptr;
+    if (archive.data()) {
+      data = archive.data() + offset;
+    } else {
+      if (archive.Read(offset, buffer, chunk) != chunk)
+        return false;
+      data = reinterpret_cast<const Bytef*>(buffer);
+    }
+    if (crc)
+      *crc = inflater->Crc32(*crc, data, chunk);
+    if (calculator)
+      calculator->Update(data, chunk);
+    offset += chunk;
+    size -= chunk;
+  }
+  return true;
+}
+
+// reserves disk blocks for file, fails only if there is no space
+bool Preallocate(int fd, uint64_t size) {
+  if (size == 0)
+    return true;
+  if (fallocate64(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0)
+    return true;
+  return errno != ENOSPC && errno != EDQUOT;
+}
+
+// finds offset of entry data in archive, after local header
+bool LocateEntryData(UnzFilePointer* zip_file,
+                     const common_installer::MappedArchive& archive,
+                     const common_installer::ZipEntry& entry,
+                     uint64_t size, uint64_t* offset) {
+  if (!zip_file->OpenCurrentRaw()) {
+    LOG(ERROR) << "Failed to open file: " << entry.name;
+    return false;
+  }
+  *offset = unzGetCurrentFileZStreamPos64(zip_file->Get());
+  zip_file->CloseCurrent();
+  if (*offset == 0 || *offset > archive.size() ||
+      size > archive.size() - *offset) {
+    LOG(ERROR) << "Failed to locate data of: " << entry.name;
+    return false;
+  }
+  return true;
+}
+
+bool CopyStoredEntry(UnzFilePointer* zip_file,
+                     const common_installer::MappedArchive& archive,
+                     const common_installer::ZipEntry& entry, int out,
+                     bool verify_crc,
+                     common_installer::DigestCalculator* calculator,
+                     common_installer::Inflater* inflater,
+                     char* buffer, size_t buffer_size) {
+  // data is copied as is, so size of stored data must be size of file
+  if (entry.compressed_size != entry.uncompressed_size) {
+    LOG(ERROR) << "Sizes of stored entry differ: " << entry.name;
+    return false;
+  }
+  uint64_t data_offset;
+  if (!LocateEntryData(zip_file, archive, entry, entry.uncompressed_size,
+                       &data_offset))
+    return false;
+
+  if (verify_crc || calculator) {
+    uint32_t crc = 0;
+    if (!ScanArchiveData(archive, data_offset, entry.uncompressed_size,
+                         verify_crc ? &crc : nullptr, calculator, inflater,
+                         buffer, buffer_size)) {
+      LOG(ERROR) << "Failed to read data of: " << entry.name;
+      return false;
+    }
+    if (verify_crc && crc != entry.crc) {
+      LOG(ERROR) << "CRC check failed for: " << entry.name;
+      return false;
+    }
+  }
+
+  if (!common_installer::CopyRangeInKernel(archive.fd(), data_offset, out,
+                                           entry.uncompressed_size)) {
+    // nothing was written yet if kernel copy is not supported at all
+    if (lseek64(out, 0, SEEK_CUR) != 0 ||
+        !CopyRangeBuffered(archive, data_offset, out,
+                           entry.uncompressed_size, buffer, buffer_size)) {
+      LOG(ERROR) << "Failed to copy: " << entry.name << ", errno: " << errno;
+      return false;
+    }
+  }
+  return true;
+}
+
+// finds offset of entry data by parsing zip headers, for entries which
+// minizip refuses to open (e.g. unsupported compression method)
+bool LocateEntryDataInHeaders(const common_installer::MappedArchive& archive,
+                              const common_installer::ZipEntry& entry,
+                              uint64_t* offset) {
+  uint8_t central[4 + common_installer::kZipCentralFileHeaderSize];
+  if (archive.Read(entry.directory_offset, central, sizeof(central)) !=
+      sizeof(central) ||
+      common_installer::ZipGet32(central) !=
+      common_installer::kZipCentralFileHeaderSignature) {
+    LOG(ERROR) << "Invalid central directory header of: " << entry.name;
+    return false;
+  }
+  uint64_t local_offset = common_installer::ZipGet32(central + 42);
+  uint16_t name_size = common_installer::ZipGet16(central + 28);
+  std::vector<uint8_t> extra(common_installer::ZipGet16(central + 30));
+  uint64_t usize = common_installer::ZipGet32(central + 24);
+  uint64_t csize = common_installer::ZipGet32(central + 20);
+  bool zip64 = false;
+  if (archive.Read(entry.directory_offset + sizeof(central) + name_size,
+                   extra.data(), extra.size()) !=
+      static_cast<int64_t>(extra.size()) ||
+      !common_installer::ApplyZip64Extra(extra, &usize, &csize,
+                                         &local_offset, &zip64)) {
+    LOG(ERROR) << "Invalid central directory header of: " << entry.name;
+    return false;
+  }
+
+  uint8_t local[4 + common_installer::kZipLocalFileHeaderSize];
+  if (archive.Read(local_offset, local, sizeof(local)) != sizeof(local) ||
+      common_installer::ZipGet32(local) !=
+      common_installer::kZipLocalFileHeaderSignature) {
+    LOG(ERROR) << "Invalid local header of: " << entry.name;
+    return false;
+  }
+  *offset = local_offset + sizeof(local) +
+      common_installer::ZipGet16(local + 26) +
+      common_installer::ZipGet16(local + 28);
+  if (*offset > archive.size() ||
+      entry.compressed_size > archive.size() - *offset) {
+    LOG(ERROR) << "Failed to locate data of: " << entry.name;
+    return false;
+  }
+  return true;
+}
+
+// decompresses zstd entry (method 93) writing it in buffer sized chunks
+bool DecompressZstdEntry(const common_installer::MappedArchive& archive,
+                         const common_installer::ZipEntry& entry, int out,
+                         bool verify_crc,
+                         common_installer::DigestCalculator* calculator,
+                         common_installer::Inflater* inflater,
+                         char* buffer, size_t buffer_size) {
+  uint64_t offset;
+  if (!LocateEntryDataInHeaders(archive, entry, &offset))
+    return false;
+  common_installer::ZstdDecompressor decompressor;
+  if (!decompressor.valid()) {
+    LOG(ERROR) << "Cannot decompress zstd entry: " << entry.name;
+    return false;
+  }
+
+  uint8_t* output = reinterpret_cast<uint8_t*>(buffer);
+  std::vector<uint8_t> input_buffer;
+  const uint8_t* input = nullptr;
+  size_t input_size = 0;
+  uint64_t input_left = entry.compressed_size;
+  uint64_t total = 0;
+  uint32_t crc = 0;
+  size_t filled = 0;
+  bool frame_end = false;
+  while (true) {
+    if (input_size == 0 && input_left > 0) {
+      input_size = std::min<uint64_t>(input_left, buffer_size);
+      if (archive.data()) {
+        input = archive.data() + offset;
+      } else {
+        input_buffer.resize(input_size);
+        if (archive.Read(offset, input_buffer.data(), input_size) !=
+            static_cast<int64_t>(input_size)) {
+          LOG(ERROR) << "Failed to read data of: " << entry.name;
+          return false;
+        }
+        input = input_buffer.data();
+      }
+      offset += input_size;
+      input_left -= input_size;
+    }
+    size_t consumed = 0;
+    size_t produced = 0;
+    common_installer::ZstdDecompressor::Result result =
+        decompressor.Decompress(input, input_size, &consumed,
+                                output + filled, buffer_size - filled,
+                                &produced);
+    if (result == common_installer::ZstdDecompressor::Result::ERROR) {
+      LOG(ERROR) << "Failed to decompress: " << entry.name;
+      return false;
+    }
+    // call without input after end of last frame only reports need of data
+    if (consumed > 0 || produced > 0)
+      frame_end =
+          result == common_installer::ZstdDecompressor::Result::FRAME_END;
+    input += consumed;
+    input_size -= consumed;
+    filled += produced;
+    total += produced;
+    if (total > entry.uncompressed_size) {
+      LOG(ERROR) << "Data of " << entry.name << " exceeds declared size";
+      return false;
+    }
+    bool done = input_size == 0 && input_left == 0 && produced == 0;
+    if (filled == buffer_size || (done && filled > 0)) {
+      if (verify_crc)
+        crc = inflater->Crc32(crc, output, filled);
+      if (calculator)
+        calculator->Update(output, filled);
+      if (!WriteAll(out, buffer, filled)) {
+        LOG(ERROR) << "Failed to write: " << entry.name << ", errno: "
+                   << errno;
+        return false;
+      }
+      filled = 0;
+    }
+    if (done)
+      break;
+  }
+  if (!frame_end || total != entry.uncompressed_size) {
+    LOG(ERROR) << "Truncated data of: " << entry.name;
+    return false;
+  }
+  if (verify_crc && crc != entry.crc) {
+    LOG(ERROR) << "CRC check failed for: " << entry.name;
+    return false;
+  }
+  return true;
+}
+
+bool CanInflateInMemory(const common_installer::MappedArchive& archive,
+                        const common_installer::ZipEntry& entry) {
+  return entry.compression_method == kZipMethodDeflated &&
+      !(entry.flags & kZipFlagEncrypted) && archive.data() &&
+      entry.uncompressed_size <= kMaxInMemoryInflateSize;
+}
+
+// inflates whole entry from archive mapping with single call
+bool InflateEntryInMemory(UnzFilePointer* zip_file,
+                          const common_installer::MappedArchive& archive,
+                          const common_installer::ZipEntry& entry, int out,
+                          bool verify_crc,
+                          common_installer::DigestCalculator* calculator,
+                          common_installer::Inflater* inflater,
+                          std::unique_ptr<uint8_t[]>* output,
+                          size_t* output_capacity) {
+  uint64_t data_offset;
+  if (!LocateEntryData(zip_file, archive, entry, entry.compressed_size,
+                       &data_offset))
+    return false;
+
+  size_t size = entry.uncompressed_size;
+  if (*output_capacity < size) {
+    output->reset(new uint8_t[size]);
+    *output_capacity = size;
+  }
+  if (!inflater->Inflate(archive.data() + data_offset, entry.compressed_size,
+                         output->get(), size)) {
+    LOG(ERROR) << "Failed to inflate: " << entry.name;
+    return false;
+  }
+  if (verify_crc && inflater->Crc32(0, output->get(), size) != entry.crc) {
+    LOG(ERROR) << "CRC check failed for: " << entry.name;
+    return false;
+  }
+  if (calculator)
+    calculator->Update(output->get(), size);
+  if (!WriteAll(out, reinterpret_cast<const char*>(output->get()), size)) {
+    LOG(ERROR) << "Failed to write: " << entry.name << ", errno: " << errno;
+    return false;
+  }
+  return true;
+}
+
+bool InflateEntry(UnzFilePointer* zip_file,
+                  const common_installer::ZipEntry& entry, int out,
+                  bool verify_crc,
+                  common_installer::DigestCalculator* calculator,
+                  char* buffer, size_t buffer_size) {
+  if (!zip_file->OpenCurrent()) {
+    LOG(ERROR) << "Failed to open file";
+    return false;
+  }
+
+  // buffer is filled completely before writing, so that every write()
+  // except the last one is of full buffer size
+  size_t filled = 0;
+  int ret = UNZ_OK;
+  do {
+    ret = unzReadCurrentFile(zip_file->Get(), buffer + filled,
+                             buffer_size - filled);
+    if (ret < 0) {
+      LOG(ERROR) << "Failed to read data: " << ret;
+      return false;
+    }
+    if (calculator)
+      calculator->Update(buffer + filled, ret);
+    filled += ret;
+    if (filled == buffer_size || (ret == 0 && filled > 0)) {
+      if (!WriteAll(out, buffer, filled)) {
+        LOG(ERROR) << "Failed to write: " << entry.name
+                   << ", errno: " << errno;
+        return false;
+      }
+      filled = 0;
+    }
+  } while (ret > 0);
+
+  if (!zip_file->CloseCurrent() && verify_crc) {
+    LOG(ERROR) << "CRC check failed for: " << entry.name;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+const char ExtractOptions::kBufferSizeEnvironmentVariable[] =
+    "APP_INSTALLERS_EXTRACT_BUFFER_SIZE";
+const size_t ExtractOptions::kDefaultBufferSize = 256_kB;
+
+ExtractOptions ExtractOptions::FromEnvironment() {
+  ExtractOptions options;
+  const char* buffer_size = getenv(kBufferSizeEnvironmentVariable);
+  if (buffer_size && *buffer_size) {
+    char* end = nullptr;
+    unsigned long long value = strtoull(buffer_size, &end, 10);  // NOLINT
+    if (*end == '\0' && value > 0)
+      options.buffer_size = value;
+    else
+      LOG(WARNING) << "Invalid value of " << kBufferSizeEnvironmentVariable
+                   << ": " << buffer_size;
+  }
+  const char* backend = getenv(Inflater::kBackendEnvironmentVariable);
+  if (backend)
+    options.inflate_backend = backend;
+  return options;
+}
+
+ZipExtractor::ZipExtractor(const bf::path& zip_path,
+                           const bf::path& destination,
+                           const ExtractOptions& options)
+    : zip_path_(zip_path),
+      destination_(destination),
+      options_(options) {
+}
+
+ZipExtractor::~ZipExtractor() {
+}
+
+bool ZipExtractor::Extract(const std::string& filter_prefix) {
+  // unpack if filter is empty or path is matched
+  return Extract([&filter_prefix](const std::string& name) {
+    return filter_prefix.empty() || name.find(filter_prefix) == 0;
+  });
+}
+
+bool ZipExtractor::Extract(const EntryFilter& filter) {
+  std::shared_ptr<const ZipIndex> index = ZipIndex::Open(zip_path_);
+  if (!index) {
+    LOG(ERROR) << "Failed to read archive: " << zip_path_;
+    return false;
+  }
+
+  Batch files;
+  if (!SelectEntries(*index, filter, &files))
+    return false;
+
+  int root_fd = open(destination_.c_str(),
+                     O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (root_fd < 0) {
+    LOG(ERROR) << "Failed to open destination directory: " << destination_;
+    return false;
+  }
+  directory_cache_.reset(new DirectoryFdCache(root_fd, destination_));
+
+  if (!CreateDirectories(&files))
+    return false;
+
+  archive_ = MappedArchive::Open(zip_path_);
+  if (!archive_)
+    return false;
+  archive_->Advise(MADV_SEQUENTIAL);
+  bool result = ExtractFiles(files);
+  // extracted data is not needed in page cache of archive anymore
+  archive_->Advise(MADV_DONTNEED);
+  archive_.reset();
+  return result;
+}
+
+bool ZipExtractor::ExtractFiles(const Batch& files) {
+  uint64_t total_size = 0;
+  for (auto entry : files)
+    total_size += entry->uncompressed_size;
+
+  unsigned threads = options_.threads;
+  if (threads == 0)
+    threads = ThreadPool::DefaultSize();
+  threads = std::min<size_t>(threads, files.size());
+  if (threads <= 1 || total_size < kMinParallelExtractSize)
+    return ExtractBatch(files);
+
+  std::vector<Batch> batches = SplitIntoBatches(files, threads);
+  std::atomic<bool> failed(false);
+  {
+    ThreadPool pool(threads);
+    for (auto& batch : batches) {
+      pool.Submit([this, &batch, &failed] {
+        if (failed)
+          return;
+        if (!ExtractBatch(batch))
+          failed = true;
+      });
+    }
+  }
+  return !failed;
+}
+
+bool ZipExtractor::SelectEntries(const ZipIndex& index,
+                                 const EntryFilter& filter,
+                                 Batch* files) {
+  std::set<bf::path> directories;
+  for (auto& entry : index.entries()) {
+    if (entry.name.empty())
+      return false;
+
+    if (!filter(entry.name))
+      continue;
+
+    bf::path filename_in_zip_path(entry.name);
+
+    // prevent "directory climbing" attack
+    if (HasDirectoryClimbing(filename_in_zip_path)) {
+      LOG(ERROR) << "Relative path in widget in malformed";
+      return false;
+    }
+
+    if (!filename_in_zip_path.parent_path().empty())
+      directories.insert(filename_in_zip_path.parent_path());
+    if (IsDirectoryEntry(entry))
+      directories.insert(filename_in_zip_path);
+    else
+      files->push_back(&entry);
+  }
+  directories_.assign(directories.begin(), directories.end());
+  return true;
+}
+
+bool ZipExtractor::CreateDirectories(Batch* files) {
+  for (auto& directory : directories_) {
+    if (!directory_cache_->Get(directory))
+      return false;
+  }
+  // entry without trailing slash may still denote existing directory
+  Batch regular_files;
+  for (auto entry : *files) {
+    bf::path path(entry->name);
+    struct stat buf;
+    auto parent = directory_cache_->Get(path.parent_path());
+    if (parent && fstatat(parent->fd(), path.filename().c_str(), &buf,
+                          AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(buf.st_mode))
+      continue;
+    regular_files.push_back(entry);
+  }
+  files->swap(regular_files);
+  return true;
+}
+
+std::vector<ZipExtractor::Batch> ZipExtractor::SplitIntoBatches(
+    const Batch& files, unsigned count) const {
+  // greedy balancing: biggest entry goes to the least loaded batch
+  Batch sorted(files);
+  std::sort(sorted.begin(), sorted.end(),
+      [](const ZipEntry* lhs, const ZipEntry* rhs) {
+        return lhs->uncompressed_size > rhs->uncompressed_size;
+      });
+  std::vector<Batch> batches(count);
+  std::vector<uint64_t> loads(count, 0);
+  for (auto entry : sorted) {
+    size_t lightest =
+        std::min_element(loads.begin(), loads.end()) - loads.begin();
+    batches[lightest].push_back(entry);
+    loads[lightest] += EntryCost(entry);
+  }
+  return batches;
+}
+
+bool ZipExtractor::ExtractBatch(const Batch& batch) const {
+  UnzFilePointer zip_file;
+  if (!zip_file.Open(*archive_)) {
+    LOG(ERROR) << "Failed to open the source dir: " << zip_path_;
+    return false;
+  }
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t buffer_size = std::max<size_t>(options_.buffer_size, 1);
+  buffer_size = (buffer_size + page_size - 1) / page_size * page_size;
+  void* buffer_memory = nullptr;
+  if (posix_memalign(&buffer_memory, page_size, buffer_size) != 0) {
+    LOG(ERROR) << "Failed to allocate buffer of size: " << buffer_size;
+    return false;
+  }
+  std::unique_ptr<char, decltype(&free)> buffer(
+      static_cast<char*>(buffer_memory), &free);
+
+  std::unique_ptr<Inflater> inflater =
+      Inflater::Create(options_.inflate_backend);
+  if (!inflater)
+    return false;
+  std::unique_ptr<uint8_t[]> inflate_output;
+  size_t inflate_output_capacity = 0;
+
+  DigestTable digests;
+  bool result = true;
+  for (auto entry : batch) {
+    if (!zip_file.GoTo(*entry)) {
+      LOG(ERROR) << "Failed to locate file: " << entry->name;
+      result = false;
+      break;
+    }
+
+    bf::path path(entry->name);
+    auto parent = directory_cache_->Get(path.parent_path());
+    if (!parent) {
+      result = false;
+      break;
+    }
+    int out = openat(parent->fd(), path.filename().c_str(),
+                     O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                     0666);
+    if (out < 0) {
+      LOG(ERROR) << "Failed to open destination: " << entry->name
+                 << ", errno: " << errno;
+      result = false;
+      break;
+    }
+
+    if (options_.preallocate && !Preallocate(out, entry->uncompressed_size)) {
+      LOG(ERROR) << "Not enough space for: " << entry->name;
+      close(out);
+      result = false;
+      break;
+    }
+
+    bool verify_crc = options_.verify_crc || IsSignatureFile(entry->name);
+    std::unique_ptr<DigestCalculator> calculator;
+    if (options_.digests)
+      calculator.reset(new DigestCalculator(options_.digest_algorithms));
+    if (entry->compression_method == kZipMethodStored &&
+        !(entry->flags & kZipFlagEncrypted))
+      result = CopyStoredEntry(&zip_file, *archive_, *entry, out, verify_crc,
+                               calculator.get(), inflater.get(), buffer.get(),
+                               buffer_size);
+    else if (entry->compression_method == kZipMethodZstd &&
+             !(entry->flags & kZipFlagEncrypted))
+      result = DecompressZstdEntry(*archive_, *entry, out, verify_crc,
+                                   calculator.get(), inflater.get(),
+                                   buffer.get(), buffer_size);
+    else if (CanInflateInMemory(*archive_, *entry))
+      result = InflateEntryInMemory(&zip_file, *archive_, *entry, out,
+                                    verify_crc, calculator.get(),
+                                    inflater.get(), &inflate_output,
+                                    &inflate_output_capacity);
+    else
+      result = InflateEntry(&zip_file, *entry, out, verify_crc,
+                            calculator.get(), buffer.get(), buffer_size);
+    if (result && calculator)
+      digests[entry->name] = calculator->Finish();
+
+    if (close(out) != 0 && result) {
+      LOG(ERROR) << "Failed to close: " << entry->name;
+      result = false;
+    }
+    if (!result)
+      break;
+    RegisterWrittenFile(destination_ / entry->name);
+  }
+  if (result && options_.digests) {
+    std::lock_guard<std::mutex> lock(digests_mutex_);
+    for (auto& item : digests)
+      (*options_.digests)[item.first] = std::move(item.second);
+  }
+  return result;
+}
+
+}  // namespace common_installer
@@ -0,0 +1,159 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_ZIP_EXTRACTOR_H_
+#define COMMON_UTILS_ZIP_EXTRACTOR_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/utils/directory_fd_cache.h"
+#include "common/utils/file_digests.h"
+#include "common/utils/macros.h"
+#include "common/utils/mapped_archive.h"
+#include "common/utils/zip_index.h"
+
+namespace common_installer {
+
+/**
+ * \brief Options of package extraction
+ */
+struct ExtractOptions {
+  /** Name of environment variable overriding buffer_size (in bytes) */
+  static const char kBufferSizeEnvironmentVariable[];
+  /** Default size of write buffer */
+  static const size_t kDefaultBufferSize;
+
+  ExtractOptions()
+      : threads(0),
+        verify_crc(true),
+        preallocate(true),
+        buffer_size(kDefaultBufferSize),
+        digests(nullptr),
+        digest_algorithms(DIGEST_SHA256),
+        max_unpacked_size(0) { }
+
+  /**
+   * \brief Returns default options adjusted by environment variables
+   */
+  static ExtractOptions FromEnvironment();
+
+  /** number of extracting threads, 0 means number of cpu cores */
+  unsigned threads;
+  /**
+   * verify crc32 of extracted entries. May be disabled when content is
+   * verified otherwise (e.g. by signature digests). Signature files are
+   * verified always.
+   */
+  bool verify_crc;
+  /** reserve space of every output file before writing */
+  bool preallocate;
+  /**
+   * size of buffer used for writing data of every thread, rounded up to
+   * page size
+   */
+  size_t buffer_size;
+  /**
+   * if not null, digests of extracted files are calculated while writing
+   * them and stored in this table
+   */
+  DigestTable* digests;
+  /** combination of DigestAlgorithm flags used if digests is set */
+  unsigned digest_algorithms;
+  /** name of Inflater backend, empty means the fastest available */
+  std::string inflate_backend;
+  /**
+   * limit of total size of extracted data, 0 means no limit. Used by
+   * ZipStreamExtractor, as size of streamed package is not known before it
+   * is extracted
+   */
+  uint64_t max_unpacked_size;
+};
+
+/**
+ * \brief Extracts content of zip archive into directory.
+ *
+ * Archive is memory mapped once and shared by all threads (see
+ * MappedArchive). Entries are split into batches of similar total size
+ * which are inflated concurrently by worker threads, each having its own
+ * archive handle.
+ * Directories are created upfront, before any file is written. All files
+ * are created relatively to cached directory descriptors (openat()), so
+ * process working directory is not touched.
+ *
+ * Entries stored without compression are copied from archive to output
+ * file inside the kernel (copy_file_range() or sendfile()). Output files are
+ * preallocated with their size known from central directory and written in
+ * large page-aligned chunks. Deflated entries of moderate size are inflated
+ * in one call from archive mapping by selected Inflater backend, bigger
+ * ones are streamed through minizip. Entries compressed with zstd (method
+ * 93, if built with HAVE_ZSTD) are decompressed directly from archive.
+ */
+class ZipExtractor {
+ public:
+  /** Predicate selecting entries to extract by their path in archive */
+  using EntryFilter = std::function<bool(const std::string&)>;
+
+  /**
+   * Constructor
+   *
+   * \param zip_path path to zip archive
+   * \param destination existing directory where files will be extracted
+   * \param options extraction options
+   */
+  ZipExtractor(const boost::filesystem::path& zip_path,
+               const boost::filesystem::path& destination,
+               const ExtractOptions& options);
+  ~ZipExtractor();
+
+  /**
+   * \brief Extracts archive entries
+   *
+   * \param filter_prefix only entries which path starts with it are
+   *                      extracted, empty means all entries
+   *
+   * \return true if all entries were extracted
+   */
+  bool Extract(const std::string& filter_prefix);
+
+  /**
+   * \brief Extracts archive entries accepted by filter
+   *
+   * \param filter predicate called for path of every entry
+   *
+   * \return true if all selected entries were extracted
+   */
+  bool Extract(const EntryFilter& filter);
+
+ private:
+  using Batch = std::vector<const ZipEntry*>;
+
+  bool SelectEntries(const ZipIndex& index, const EntryFilter& filter,
+                     Batch* files);
+  bool CreateDirectories(Batch* files);
+  bool ExtractFiles(const Batch& files);
+  std::vector<Batch> SplitIntoBatches(const Batch& files,
+                                      unsigned count) const;
+  bool ExtractBatch(const Batch& batch) const;
+
+  boost::filesystem::path zip_path_;
+  boost::filesystem::path destination_;
+  ExtractOptions options_;
+  std::vector<boost::filesystem::path> directories_;
+  std::unique_ptr<DirectoryFdCache> directory_cache_;
+  std::shared_ptr<MappedArchive> archive_;
+  mutable std::mutex digests_mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipExtractor);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_ZIP_EXTRACTOR_H_
@@ -0,0 +1,56 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/zip_format.h"
+
+namespace common_installer {
+
+bool ApplyZip64Extra(const std::vector<uint8_t>& extra, uint64_t* usize,
+                     uint64_t* csize, uint64_t* offset, bool* found) {
+  *found = false;
+  size_t pos = 0;
+  while (pos + 4 <= extra.size()) {
+    uint16_t id = ZipGet16(&extra[pos]);
+    uint16_t size = ZipGet16(&extra[pos + 2]);
+    pos += 4;
+    if (pos + size > extra.size())
+      return false;
+    if (id == kZip64ExtraFieldId) {
+      *found = true;
+      const uint8_t* field = &extra[pos];
+      size_t left = size;
+      for (uint64_t* value : {usize, csize, offset}) {
+        if (!value || *value != kZip64Marker)
+          continue;
+        if (left < 8)
+          return false;
+        *value = ZipGet64(field);
+        field += 8;
+        left -= 8;
+      }
+    }
+    pos += size;
+  }
+  return true;
+}
+
+std::string NormalizeZipEntryName(const std::string& name) {
+  std::string normalized;
+  size_t begin = 0;
+  while (begin <= name.size()) {
+    size_t end = name.find('/', begin);
+    if (end == std::string::npos)
+      end = name.size();
+    size_t length = end - begin;
+    if (length != 0 && name.compare(begin, length, ".") != 0) {
+      if (!normalized.empty())
+        normalized += '/';
+      normalized.append(name, begin, length);
+    }
+    begin = end + 1;
+  }
+  return normalized;
+}
+
+}  // namespace common_installer
@@ -0,0 +1,88 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_ZIP_FORMAT_H_
+#define COMMON_UTILS_ZIP_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace common_installer {
+
+// Constants and helpers for parsing zip records directly, where minizip
+// cannot be used. See APPNOTE.TXT of zip format.
+
+// record signatures
+const uint32_t kZipLocalFileHeaderSignature = 0x04034b50;
+const uint32_t kZipDataDescriptorSignature = 0x08074b50;
+const uint32_t kZipCentralFileHeaderSignature = 0x02014b50;
+const uint32_t kZip64EndOfCentralDirectorySignature = 0x06064b50;
+const uint32_t kZip64EndOfCentralDirectoryLocatorSignature = 0x07064b50;
+const uint32_t kZipEndOfCentralDirectorySignature = 0x06054b50;
+
+// sizes of fixed parts of records, without signature
+const size_t kZipLocalFileHeaderSize = 26;
+const size_t kZipCentralFileHeaderSize = 42;
+const size_t kZip64EndOfCentralDirectoryLocatorSize = 16;
+const size_t kZipEndOfCentralDirectorySize = 18;
+
+const uint16_t kZip64ExtraFieldId = 0x0001;
+const uint32_t kZip64Marker = 0xffffffff;
+const uint16_t kZip64EntriesMarker = 0xffff;
+
+// compression methods
+const uint32_t kZipMethodStored = 0;
+const uint32_t kZipMethodDeflated = 8;
+const uint32_t kZipMethodZstd = 93;
+
+// general purpose flag bits
+const uint32_t kZipFlagEncrypted = 0x1;
+const uint32_t kZipFlagDataDescriptor = 0x8;
+
+inline uint16_t ZipGet16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+inline uint32_t ZipGet32(const uint8_t* data) {
+  return ZipGet16(data) |
+      (static_cast<uint32_t>(ZipGet16(data + 2)) << 16);
+}
+
+inline uint64_t ZipGet64(const uint8_t* data) {
+  return ZipGet32(data) |
+      (static_cast<uint64_t>(ZipGet32(data + 4)) << 32);
+}
+
+/**
+ * \brief Replaces fields saturated to kZip64Marker by values from zip64
+ *        extended information extra field
+ *
+ * \param extra extra field of local or central header
+ * \param usize uncompressed size
+ * \param csize compressed size
+ * \param offset local header offset, nullptr if not present in record
+ * \param found set if zip64 extra field is present
+ *
+ * \return false if extra field is malformed
+ */
+bool ApplyZip64Extra(const std::vector<uint8_t>& extra, uint64_t* usize,
+                     uint64_t* csize, uint64_t* offset, bool* found);
+
+/**
+ * \brief Returns path of entry as it is resolved in filesystem: without
+ *        empty and "." components and trailing slash. Entries which names
+ *        differ, but normalize to the same path, are extracted to the same
+ *        file.
+ *
+ * \param name path of entry inside archive
+ *
+ * \return normalized path
+ */
+std::string NormalizeZipEntryName(const std::string& name);
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_ZIP_FORMAT_H_
@@ -0,0 +1,159 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/zip_index.h"
+
+#include <linux/limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unzip.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <mutex>
+#include <unordered_set>
+
+#include "common/utils/mapped_archive.h"
+#include "common/utils/zip_format.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+const unsigned kZipMaxPath = PATH_MAX;
+
+// identity of indexed archive file, index is reused only if it matches
+struct ArchiveStamp {
+  dev_t device;
+  ino_t inode;
+  off_t size;
+  time_t mtime_sec;
+  long mtime_nsec;  // NOLINT
+
+  bool operator==(const ArchiveStamp& other) const {
+    return device == other.device && inode == other.inode &&
+        size == other.size && mtime_sec == other.mtime_sec &&
+        mtime_nsec == other.mtime_nsec;
+  }
+};
+
+bool GetArchiveStamp(const bf::path& path, ArchiveStamp* stamp) {
+  struct stat buf;
+  if (stat(path.c_str(), &buf) != 0)
+    return false;
+  stamp->device = buf.st_dev;
+  stamp->inode = buf.st_ino;
+  stamp->size = buf.st_size;
+  stamp->mtime_sec = buf.st_mtim.tv_sec;
+  stamp->mtime_nsec = buf.st_mtim.tv_nsec;
+  return true;
+}
+
+// packages are processed one at a time, so remembering last one is enough
+std::mutex cache_mutex;
+bf::path cached_path;
+ArchiveStamp cached_stamp;
+std::shared_ptr<const common_installer::ZipIndex> cached_index;
+
+}  // namespace
+
+namespace common_installer {
+
+std::shared_ptr<const ZipIndex> ZipIndex::Open(const bf::path& zip_path) {
+  ArchiveStamp stamp;
+  if (!GetArchiveStamp(zip_path, &stamp)) {
+    LOG(ERROR) << "Failed to stat archive: " << zip_path;
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (cached_index && cached_path == zip_path && cached_stamp == stamp)
+    return cached_index;
+
+  std::shared_ptr<ZipIndex> index(new ZipIndex(zip_path));
+  if (!index->Parse())
+    return nullptr;
+  cached_path = zip_path;
+  cached_stamp = stamp;
+  cached_index = index;
+  return index;
+}
+
+ZipIndex::ZipIndex(const bf::path& zip_path)
+    : path_(zip_path) {
+}
+
+const ZipEntry* ZipIndex::Find(const std::string& name) const {
+  auto iter = lookup_.find(name);
+  if (iter == lookup_.end())
+    return nullptr;
+  return &entries_[iter->second];
+}
+
+bool ZipIndex::Parse() {
+  std::shared_ptr<MappedArchive> archive = MappedArchive::Open(path_);
+  if (!archive)
+    return false;
+  archive->Advise(MADV_RANDOM);
+  unzFile zip_file = archive->OpenUnzip();
+  if (!zip_file) {
+    LOG(ERROR) << "Failed to open the source dir: " << path_;
+    return false;
+  }
+
+  unz_global_info64 info;
+  if (unzGetGlobalInfo64(zip_file, &info) != UNZ_OK) {
+    LOG(ERROR) << "Failed to read global info";
+    unzClose(zip_file);
+    return false;
+  }
+
+  entries_.reserve(info.number_entry);
+  lookup_.reserve(info.number_entry);
+  std::unordered_set<std::string> normalized_names;
+  char raw_file_name_in_zip[kZipMaxPath];
+  for (ZPOS64_T i = 0; i < info.number_entry; i++) {
+    unz_file_info64 raw_file_info;
+    unz64_file_pos position;
+    if (unzGetCurrentFileInfo64(zip_file, &raw_file_info, raw_file_name_in_zip,
+        sizeof(raw_file_name_in_zip), nullptr, 0, nullptr, 0) != UNZ_OK ||
+        unzGetFilePos64(zip_file, &position) != UNZ_OK) {
+      LOG(ERROR) << "Failed to read file info";
+      unzClose(zip_file);
+      return false;
+    }
+
+    ZipEntry entry;
+    entry.name = raw_file_name_in_zip;
+    entry.directory_offset = position.pos_in_zip_directory;
+    entry.file_number = position.num_of_file;
+    entry.compressed_size = raw_file_info.compressed_size;
+    entry.uncompressed_size = raw_file_info.uncompressed_size;
+    entry.compression_method = raw_file_info.compression_method;
+    entry.flags = raw_file_info.flag;
+    entry.crc = raw_file_info.crc;
+    // entries extracted to the same file would make content of the file
+    // depend on order of extraction and differ from verified one
+    if (!normalized_names.insert(NormalizeZipEntryName(entry.name)).second) {
+      LOG(ERROR) << "Duplicated entry in archive: " << entry.name;
+      unzClose(zip_file);
+      return false;
+    }
+    lookup_.emplace(entry.name, entries_.size());
+    entries_.push_back(std::move(entry));
+
+    if ((i + 1) < info.number_entry) {
+      if (unzGoToNextFile(zip_file) != UNZ_OK) {
+        LOG(ERROR) << "Failed to read next file";
+        unzClose(zip_file);
+        return false;
+      }
+    }
+  }
+
+  unzClose(zip_file);
+  return true;
+}
+
+}  // namespace common_installer
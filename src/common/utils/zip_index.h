@@ -0,0 +1,89 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_ZIP_INDEX_H_
+#define COMMON_UTILS_ZIP_INDEX_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Information about single entry of zip archive taken from central
+ *        directory
+ */
+struct ZipEntry {
+  /** path of entry inside archive */
+  std::string name;
+  /** offset of entry in central directory (for unzGoToFilePos64()) */
+  uint64_t directory_offset;
+  /** index of entry in central directory (for unzGoToFilePos64()) */
+  uint64_t file_number;
+  uint64_t compressed_size;
+  uint64_t uncompressed_size;
+  uint32_t compression_method;
+  /** general purpose bit flag */
+  uint32_t flags;
+  uint32_t crc;
+};
+
+/**
+ * \brief Index of zip archive central directory.
+ *
+ * Central directory is parsed once and then entries can be iterated or
+ * looked up by name in constant time. Index objects are immutable and
+ * cached per archive file, so helpers called one after another for the same
+ * package share single parsing of the archive. Archives with entries which
+ * names are equal after normalization (see NormalizeZipEntryName()) are
+ * rejected.
+ */
+class ZipIndex {
+ public:
+  /**
+   * \brief Returns index of given archive. Index is created or taken from
+   *        cache if archive file was not modified since it was indexed.
+   *
+   * \param zip_path path to zip archive
+   *
+   * \return index or nullptr if archive cannot be read
+   */
+  static std::shared_ptr<const ZipIndex> Open(
+      const boost::filesystem::path& zip_path);
+
+  /**
+   * \brief Finds entry by its path inside archive
+   *
+   * \param name path of entry inside archive
+   *
+   * \return entry or nullptr if archive has no such entry
+   */
+  const ZipEntry* Find(const std::string& name) const;
+
+  /** entries in central directory order */
+  const std::vector<ZipEntry>& entries() const { return entries_; }
+
+  const boost::filesystem::path& path() const { return path_; }
+
+ private:
+  explicit ZipIndex(const boost::filesystem::path& zip_path);
+  bool Parse();
+
+  boost::filesystem::path path_;
+  std::vector<ZipEntry> entries_;
+  std::unordered_map<std::string, size_t> lookup_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipIndex);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_ZIP_INDEX_H_
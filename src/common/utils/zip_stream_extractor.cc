@@ -0,0 +1,607 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/zip_stream_extractor.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <regex>
+#include <utility>
+
+#include "common/utils/file_digests.h"
+#include "common/utils/file_util.h"
+#include "common/utils/sync_registry.h"
+#include "common/utils/zip_format.h"
+#include "common/utils/zstd_decompressor.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+const char kSignatureAuthor[] = "author-signature.xml";
+const char kRegexDistributorSignature[] = "^signature[1-9][0-9]*\\.xml$";
+
+bool IsSignatureFile(const std::string& name) {
+  static const std::regex distributor_regex(kRegexDistributorSignature);
+  return name == kSignatureAuthor ||
+         std::regex_search(name, distributor_regex);
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+// reserves space for file, fails only if there is not enough space
+bool Preallocate(int fd, uint64_t size) {
+  if (size == 0)
+    return true;
+  if (fallocate64(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0)
+    return true;
+  return errno != ENOSPC && errno != EDQUOT;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+/**
+ * Buffered sequential reader of descriptor which tracks position in stream
+ */
+class ZipStreamExtractor::Reader {
+ public:
+  Reader(int fd, size_t capacity)
+      : fd_(fd),
+        buffer_(capacity),
+        begin_(0),
+        end_(0),
+        position_(0) { }
+
+  /**
+   * \brief Reads more data if buffer is empty
+   *
+   * \return number of buffered bytes, 0 at end of stream or on error
+   */
+  size_t Fill() {
+    if (begin_ < end_)
+      return end_ - begin_;
+    begin_ = end_ = 0;
+    while (true) {
+      ssize_t count = read(fd_, buffer_.data(), buffer_.size());
+      if (count < 0) {
+        if (errno == EINTR)
+          continue;
+        LOG(ERROR) << "Failed to read archive stream, errno: " << errno;
+        return 0;
+      }
+      end_ = count;
+      return end_;
+    }
+  }
+
+  bool ReadExact(void* data, size_t size) {
+    uint8_t* output = static_cast<uint8_t*>(data);
+    while (size > 0) {
+      size_t available = Fill();
+      if (available == 0)
+        return false;
+      size_t chunk = std::min(size, available);
+      std::copy(this->data(), this->data() + chunk, output);
+      Consume(chunk);
+      output += chunk;
+      size -= chunk;
+    }
+    return true;
+  }
+
+  bool Skip(uint64_t size) {
+    while (size > 0) {
+      size_t available = Fill();
+      if (available == 0)
+        return false;
+      size_t chunk = std::min<uint64_t>(size, available);
+      Consume(chunk);
+      size -= chunk;
+    }
+    return true;
+  }
+
+  const uint8_t* data() const { return buffer_.data() + begin_; }
+
+  void Consume(size_t size) {
+    begin_ += size;
+    position_ += size;
+  }
+
+  /** number of bytes consumed since start of stream */
+  uint64_t position() const { return position_; }
+
+ private:
+  int fd_;
+  std::vector<uint8_t> buffer_;
+  size_t begin_;
+  size_t end_;
+  uint64_t position_;
+
+  DISALLOW_COPY_AND_ASSIGN(Reader);
+};
+
+ZipStreamExtractor::ZipStreamExtractor(int fd, const bf::path& destination,
+                                       const ExtractOptions& options)
+    : fd_(fd),
+      destination_(destination),
+      options_(options),
+      declared_entries_(0),
+      unpacked_size_(0),
+      entry_reserved_(0),
+      out_of_space_(false) {
+}
+
+ZipStreamExtractor::~ZipStreamExtractor() {
+}
+
+bool ZipStreamExtractor::Extract() {
+  int root_fd = open(destination_.c_str(),
+                     O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (root_fd < 0) {
+    LOG(ERROR) << "Failed to open destination directory: " << destination_;
+    return false;
+  }
+  directory_cache_.reset(new DirectoryFdCache(root_fd, destination_));
+  buffer_.resize(std::max<size_t>(options_.buffer_size, 1));
+
+  Reader reader(fd_, buffer_.size());
+  bool central_directory = false;
+  while (true) {
+    uint64_t offset = reader.position();
+    uint8_t signature_data[4];
+    if (!reader.ReadExact(signature_data, sizeof(signature_data))) {
+      LOG(ERROR) << "Unexpected end of archive stream at: " << offset;
+      return false;
+    }
+    uint32_t signature = ZipGet32(signature_data);
+    if (signature == kZipLocalFileHeaderSignature && !central_directory) {
+      if (!ExtractLocalEntry(&reader, offset))
+        return false;
+    } else if (signature == kZipCentralFileHeaderSignature) {
+      central_directory = true;
+      if (!ReadCentralEntry(&reader))
+        return false;
+    } else if (signature == kZip64EndOfCentralDirectorySignature ||
+               signature == kZip64EndOfCentralDirectoryLocatorSignature) {
+      if (!ReadEndOfCentralDirectory(&reader, signature))
+        return false;
+    } else if (signature == kZipEndOfCentralDirectorySignature) {
+      if (!ReadEndOfCentralDirectory(&reader, signature))
+        return false;
+      break;
+    } else {
+      LOG(ERROR) << "Unexpected record in archive stream at: " << offset;
+      return false;
+    }
+  }
+  // let producer finish writing, nothing is expected after archive comment
+  while (reader.Fill() > 0)
+    reader.Consume(reader.Fill());
+
+  if (!Reconcile())
+    return false;
+  LOG(DEBUG) << "Extracted " << extracted_.size() << " entries from stream";
+  return true;
+}
+
+bool ZipStreamExtractor::ExtractLocalEntry(Reader* reader,
+                                           uint64_t header_offset) {
+  uint8_t header[kZipLocalFileHeaderSize];
+  if (!reader->ReadExact(header, sizeof(header))) {
+    LOG(ERROR) << "Truncated local file header at: " << header_offset;
+    return false;
+  }
+  ZipEntry entry;
+  entry.flags = ZipGet16(header + 2);
+  entry.compression_method = ZipGet16(header + 4);
+  entry.crc = ZipGet32(header + 10);
+  entry.compressed_size = ZipGet32(header + 14);
+  entry.uncompressed_size = ZipGet32(header + 18);
+  entry.directory_offset = 0;
+  entry.file_number = extracted_.size();
+  entry.name.resize(ZipGet16(header + 22));
+  std::vector<uint8_t> extra(ZipGet16(header + 24));
+  if (!reader->ReadExact(&entry.name[0], entry.name.size()) ||
+      !reader->ReadExact(extra.data(), extra.size())) {
+    LOG(ERROR) << "Truncated local file header at: " << header_offset;
+    return false;
+  }
+  bool zip64 = false;
+  if (!ApplyZip64Extra(extra, &entry.uncompressed_size,
+                       &entry.compressed_size, nullptr, &zip64)) {
+    LOG(ERROR) << "Malformed extra field of: " << entry.name;
+    return false;
+  }
+
+  if (entry.name.empty()) {
+    LOG(ERROR) << "Entry without name at: " << header_offset;
+    return false;
+  }
+  bf::path path(entry.name);
+  // prevent "directory climbing" attack
+  if (HasDirectoryClimbing(path)) {
+    LOG(ERROR) << "Relative path in widget in malformed";
+    return false;
+  }
+  if (!normalized_names_.insert(NormalizeZipEntryName(entry.name)).second) {
+    LOG(ERROR) << "Duplicated entry in archive: " << entry.name;
+    return false;
+  }
+  if (entry.flags & kZipFlagEncrypted) {
+    LOG(ERROR) << "Encrypted entries are not supported: " << entry.name;
+    return false;
+  }
+  if (entry.compression_method != kZipMethodStored &&
+      entry.compression_method != kZipMethodDeflated &&
+      entry.compression_method != kZipMethodZstd) {
+    LOG(ERROR) << "Unsupported compression method "
+               << entry.compression_method << " of: " << entry.name;
+    return false;
+  }
+  bool is_directory = entry.name.back() == '/';
+  bool has_descriptor = entry.flags & kZipFlagDataDescriptor;
+  // end of stored data can be found only by its size, some writers put it
+  // in local header even if data descriptor follows
+  if (has_descriptor && entry.compression_method == kZipMethodStored &&
+      entry.compressed_size == 0 && !is_directory) {
+    LOG(ERROR) << "Size of stored entry is unknown: " << entry.name;
+    return false;
+  }
+
+  // size from header fails big entry before any of its data is written,
+  // written data is counted too as header may not tell its size
+  entry_reserved_ = 0;
+  if (!has_descriptor && !ReserveSpace(entry, entry.uncompressed_size))
+    return false;
+
+  ZipEntry actual = entry;
+  bool verify_crc = false;
+  if (is_directory) {
+    if (!directory_cache_->Get(entry.name.substr(0, entry.name.size() - 1)))
+      return false;
+    if (!reader->Skip(entry.compressed_size)) {
+      LOG(ERROR) << "Truncated data of: " << entry.name;
+      return false;
+    }
+  } else {
+    auto parent = directory_cache_->Get(path.parent_path());
+    if (!parent)
+      return false;
+    int out = openat(parent->fd(), path.filename().c_str(),
+                     O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                     0666);
+    if (out < 0) {
+      LOG(ERROR) << "Failed to open destination: " << entry.name
+                 << ", errno: " << errno;
+      return false;
+    }
+    if (options_.preallocate && !has_descriptor &&
+        !Preallocate(out, entry.uncompressed_size)) {
+      LOG(ERROR) << "Not enough space for: " << entry.name;
+      out_of_space_ = true;
+      close(out);
+      return false;
+    }
+    verify_crc = options_.verify_crc || IsSignatureFile(entry.name);
+    bool result = ExtractData(reader, entry, has_descriptor, verify_crc, out,
+                              &actual);
+    if (close(out) != 0 && result) {
+      LOG(ERROR) << "Failed to close: " << entry.name;
+      result = false;
+    }
+    if (!result)
+      return false;
+    RegisterWrittenFile(destination_ / entry.name);
+  }
+
+  if (has_descriptor) {
+    uint8_t descriptor[24];
+    size_t sizes_length = zip64 ? 16 : 8;
+    if (!reader->ReadExact(descriptor, 4)) {
+      LOG(ERROR) << "Truncated data descriptor of: " << entry.name;
+      return false;
+    }
+    // signature of data descriptor is optional
+    size_t pos = ZipGet32(descriptor) == kZipDataDescriptorSignature ? 0 : 4;
+    if (!reader->ReadExact(descriptor + pos, sizes_length + 4 - pos)) {
+      LOG(ERROR) << "Truncated data descriptor of: " << entry.name;
+      return false;
+    }
+    entry.crc = ZipGet32(descriptor);
+    entry.compressed_size =
+        zip64 ? ZipGet64(descriptor + 4) : ZipGet32(descriptor + 4);
+    entry.uncompressed_size =
+        zip64 ? ZipGet64(descriptor + 12) : ZipGet32(descriptor + 8);
+  }
+  if (actual.compressed_size != entry.compressed_size ||
+      actual.uncompressed_size != entry.uncompressed_size) {
+    LOG(ERROR) << "Size of data does not match header: " << entry.name;
+    return false;
+  }
+  if (verify_crc && actual.crc != entry.crc) {
+    LOG(ERROR) << "CRC check failed for: " << entry.name;
+    return false;
+  }
+
+  lookup_.emplace(entry.name, extracted_.size());
+  extracted_.push_back(std::move(entry));
+  local_offsets_.push_back(header_offset);
+  return true;
+}
+
+bool ZipStreamExtractor::ExtractData(Reader* reader, const ZipEntry& entry,
+                                     bool has_descriptor, bool verify_crc,
+                                     int out, ZipEntry* actual) {
+  std::unique_ptr<DigestCalculator> calculator;
+  if (options_.digests)
+    calculator.reset(new DigestCalculator(options_.digest_algorithms));
+  uLong crc = crc32(0L, Z_NULL, 0);
+  uint64_t written = 0;
+  OutputCallback consume_output = [&](const uint8_t* data, size_t size) {
+    written += size;
+    if (!ReserveSpace(entry, written))
+      return false;
+    if (verify_crc)
+      crc = crc32(crc, data, size);
+    if (calculator)
+      calculator->Update(data, size);
+    if (!WriteAll(out, data, size)) {
+      LOG(ERROR) << "Failed to write: " << entry.name << ", errno: " << errno;
+      if (errno == ENOSPC || errno == EDQUOT)
+        out_of_space_ = true;
+      return false;
+    }
+    return true;
+  };
+
+  actual->compressed_size = 0;
+  actual->uncompressed_size = 0;
+  if (entry.compression_method == kZipMethodStored) {
+    uint64_t left = entry.compressed_size;
+    while (left > 0) {
+      size_t available = reader->Fill();
+      if (available == 0) {
+        LOG(ERROR) << "Truncated data of: " << entry.name;
+        return false;
+      }
+      size_t chunk = std::min<uint64_t>(left, available);
+      if (!consume_output(reader->data(), chunk))
+        return false;
+      reader->Consume(chunk);
+      left -= chunk;
+    }
+    actual->compressed_size = entry.compressed_size;
+    actual->uncompressed_size = entry.compressed_size;
+  } else if (entry.compression_method == kZipMethodZstd) {
+    if (!ExtractZstdData(reader, entry, has_descriptor, consume_output,
+                         actual))
+      return false;
+  } else {
+    z_stream stream = {};
+    // negative window bits: raw deflate without zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+      LOG(ERROR) << "Failed to initialize inflate";
+      return false;
+    }
+    uint8_t* output = reinterpret_cast<uint8_t*>(buffer_.data());
+    size_t output_size =
+        std::min<size_t>(buffer_.size(), std::numeric_limits<uInt>::max());
+    bool result = false;
+    while (true) {
+      size_t available = reader->Fill();
+      if (available == 0) {
+        LOG(ERROR) << "Truncated data of: " << entry.name;
+        break;
+      }
+      // compressed size from header limits input unless it is in descriptor
+      if (!has_descriptor)
+        available = std::min<uint64_t>(
+            available, entry.compressed_size - actual->compressed_size);
+      available =
+          std::min<size_t>(available, std::numeric_limits<uInt>::max());
+      stream.next_in = const_cast<Bytef*>(reader->data());
+      stream.avail_in = available;
+      stream.next_out = output;
+      stream.avail_out = output_size;
+      int ret = inflate(&stream, Z_NO_FLUSH);
+      size_t consumed = available - stream.avail_in;
+      reader->Consume(consumed);
+      actual->compressed_size += consumed;
+      size_t produced = output_size - stream.avail_out;
+      actual->uncompressed_size += produced;
+      if (!consume_output(output, produced))
+        break;
+      if (ret == Z_STREAM_END) {
+        result = true;
+        break;
+      }
+      if ((ret != Z_OK && ret != Z_BUF_ERROR) ||
+          (available == 0 && produced == 0)) {
+        LOG(ERROR) << "Failed to inflate: " << entry.name;
+        break;
+      }
+    }
+    inflateEnd(&stream);
+    if (!result)
+      return false;
+  }
+
+  actual->crc = crc;
+  if (calculator)
+    (*options_.digests)[entry.name] = calculator->Finish();
+  return true;
+}
+
+bool ZipStreamExtractor::ExtractZstdData(Reader* reader,
+                                         const ZipEntry& entry,
+                                         bool has_descriptor,
+                                         const OutputCallback& consume_output,
+                                         ZipEntry* actual) {
+  ZstdDecompressor decompressor;
+  if (!decompressor.valid()) {
+    LOG(ERROR) << "Cannot decompress zstd entry: " << entry.name;
+    return false;
+  }
+  uint8_t* output = reinterpret_cast<uint8_t*>(buffer_.data());
+  while (true) {
+    size_t available = reader->Fill();
+    // compressed size from header limits input unless it is in descriptor
+    if (!has_descriptor)
+      available = std::min<uint64_t>(
+          available, entry.compressed_size - actual->compressed_size);
+    size_t consumed = 0;
+    size_t produced = 0;
+    ZstdDecompressor::Result result = decompressor.Decompress(
+        reader->data(), available, &consumed, output, buffer_.size(),
+        &produced);
+    if (result == ZstdDecompressor::Result::ERROR) {
+      LOG(ERROR) << "Failed to decompress: " << entry.name;
+      return false;
+    }
+    reader->Consume(consumed);
+    actual->compressed_size += consumed;
+    actual->uncompressed_size += produced;
+    if (!consume_output(output, produced))
+      return false;
+    // entry may consist of many frames if its size is known
+    if (result == ZstdDecompressor::Result::FRAME_END &&
+        (has_descriptor ||
+         actual->compressed_size == entry.compressed_size))
+      return true;
+    if (available == 0 && produced == 0) {
+      LOG(ERROR) << "Truncated data of: " << entry.name;
+      return false;
+    }
+  }
+}
+
+bool ZipStreamExtractor::ReserveSpace(const ZipEntry& entry, uint64_t size) {
+  // entry is counted once, growing reservation adds only the difference
+  if (size <= entry_reserved_)
+    return true;
+  unpacked_size_ += size - entry_reserved_;
+  entry_reserved_ = size;
+  if (options_.max_unpacked_size &&
+      unpacked_size_ > options_.max_unpacked_size) {
+    LOG(ERROR) << "Not enough space for: " << entry.name << ", package needs"
+               << " more than: " << options_.max_unpacked_size << "B";
+    out_of_space_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool ZipStreamExtractor::ReadCentralEntry(Reader* reader) {
+  uint8_t header[kZipCentralFileHeaderSize];
+  if (!reader->ReadExact(header, sizeof(header))) {
+    LOG(ERROR) << "Truncated central directory";
+    return false;
+  }
+  ZipEntry entry;
+  entry.flags = ZipGet16(header + 4);
+  entry.compression_method = ZipGet16(header + 6);
+  entry.crc = ZipGet32(header + 12);
+  entry.compressed_size = ZipGet32(header + 16);
+  entry.uncompressed_size = ZipGet32(header + 20);
+  entry.directory_offset = 0;
+  entry.file_number = entries_.size();
+  uint64_t local_offset = ZipGet32(header + 38);
+  entry.name.resize(ZipGet16(header + 24));
+  std::vector<uint8_t> extra(ZipGet16(header + 26));
+  if (!reader->ReadExact(&entry.name[0], entry.name.size()) ||
+      !reader->ReadExact(extra.data(), extra.size()) ||
+      !reader->Skip(ZipGet16(header + 28))) {
+    LOG(ERROR) << "Truncated central directory";
+    return false;
+  }
+  bool zip64 = false;
+  if (!ApplyZip64Extra(extra, &entry.uncompressed_size,
+                       &entry.compressed_size, &local_offset, &zip64)) {
+    LOG(ERROR) << "Malformed extra field of: " << entry.name;
+    return false;
+  }
+  entries_.push_back(std::move(entry));
+  central_offsets_.push_back(local_offset);
+  return true;
+}
+
+bool ZipStreamExtractor::ReadEndOfCentralDirectory(Reader* reader,
+                                                   uint32_t signature) {
+  if (signature == kZip64EndOfCentralDirectoryLocatorSignature)
+    return reader->Skip(kZip64EndOfCentralDirectoryLocatorSize);
+
+  if (signature == kZip64EndOfCentralDirectorySignature) {
+    uint8_t size_data[8];
+    if (!reader->ReadExact(size_data, sizeof(size_data)))
+      return false;
+    std::vector<uint8_t> record(ZipGet64(size_data));
+    if (record.size() < 28 || !reader->ReadExact(record.data(), record.size()))
+      return false;
+    declared_entries_ = ZipGet64(&record[20]);
+    return true;
+  }
+
+  uint8_t record[kZipEndOfCentralDirectorySize];
+  if (!reader->ReadExact(record, sizeof(record)))
+    return false;
+  uint16_t entries = ZipGet16(record + 6);
+  if (entries != kZip64EntriesMarker)
+    declared_entries_ = entries;
+  // archive comment
+  return reader->Skip(ZipGet16(record + 16));
+}
+
+bool ZipStreamExtractor::Reconcile() const {
+  if (entries_.size() != declared_entries_ ||
+      entries_.size() != extracted_.size()) {
+    LOG(ERROR) << "Central directory lists " << entries_.size()
+               << " entries (declared " << declared_entries_ << "), "
+               << extracted_.size() << " were extracted";
+    return false;
+  }
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const ZipEntry& entry = entries_[i];
+    auto iter = lookup_.find(entry.name);
+    if (iter == lookup_.end()) {
+      LOG(ERROR) << "Entry of central directory was not extracted: "
+                 << entry.name;
+      return false;
+    }
+    const ZipEntry& extracted = extracted_[iter->second];
+    if (central_offsets_[i] != local_offsets_[iter->second] ||
+        entry.compression_method != extracted.compression_method ||
+        entry.crc != extracted.crc ||
+        entry.compressed_size != extracted.compressed_size ||
+        entry.uncompressed_size != extracted.uncompressed_size) {
+      LOG(ERROR) << "Entry does not match central directory: " << entry.name;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace common_installer
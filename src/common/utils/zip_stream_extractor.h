@@ -0,0 +1,117 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_ZIP_STREAM_EXTRACTOR_H_
+#define COMMON_UTILS_ZIP_STREAM_EXTRACTOR_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/utils/directory_fd_cache.h"
+#include "common/utils/macros.h"
+#include "common/utils/zip_extractor.h"
+#include "common/utils/zip_index.h"
+
+namespace common_installer {
+
+/**
+ * \brief Extracts zip archive read sequentially from file descriptor (pipe,
+ *        socket, stdin), without need of having whole package on disk.
+ *
+ * Entries are extracted one by one as their local headers and data arrive,
+ * so transfer of package overlaps with writing its content. Central
+ * directory, which comes last, is used to validate what was extracted:
+ * every entry must be listed there with the same offset, method, sizes and
+ * crc, and every listed entry must have been extracted.
+ *
+ * Only stored, deflated and zstd (method 93) entries are supported. Stored
+ * entries must have sizes in local header, compressed ones may use data
+ * descriptor.
+ *
+ * If extraction fails, already extracted files are left in destination and
+ * should be removed by caller.
+ */
+class ZipStreamExtractor {
+ public:
+  /**
+   * Constructor
+   *
+   * \param fd descriptor to read archive from, not closed by extractor
+   * \param destination existing directory where files will be extracted
+   * \param options extraction options, threads and inflate_backend are not
+   *                used
+   */
+  ZipStreamExtractor(int fd, const boost::filesystem::path& destination,
+                     const ExtractOptions& options);
+  ~ZipStreamExtractor();
+
+  /**
+   * \brief Reads whole archive and extracts all its entries
+   *
+   * \return true if archive was extracted and is consistent with its central
+   *         directory
+   */
+  bool Extract();
+
+  /** entries of central directory, valid after successful Extract() */
+  const std::vector<ZipEntry>& entries() const { return entries_; }
+
+  /**
+   * true if Extract() failed because extracted data exceeded
+   * ExtractOptions::max_unpacked_size or filesystem became full
+   */
+  bool out_of_space() const { return out_of_space_; }
+
+ private:
+  class Reader;
+  using OutputCallback = std::function<bool(const uint8_t*, size_t)>;
+
+  bool ExtractLocalEntry(Reader* reader, uint64_t header_offset);
+  bool ExtractData(Reader* reader, const ZipEntry& entry,
+                   bool has_descriptor, bool verify_crc, int out,
+                   ZipEntry* actual);
+  bool ExtractZstdData(Reader* reader, const ZipEntry& entry,
+                       bool has_descriptor,
+                       const OutputCallback& consume_output,
+                       ZipEntry* actual);
+  bool ReserveSpace(const ZipEntry& entry, uint64_t size);
+  bool ReadCentralEntry(Reader* reader);
+  bool ReadEndOfCentralDirectory(Reader* reader, uint32_t signature);
+  bool Reconcile() const;
+
+  int fd_;
+  boost::filesystem::path destination_;
+  ExtractOptions options_;
+  std::unique_ptr<DirectoryFdCache> directory_cache_;
+  std::vector<char> buffer_;
+  /** entries extracted from local headers, with their header offsets */
+  std::vector<ZipEntry> extracted_;
+  std::vector<uint64_t> local_offsets_;
+  std::unordered_map<std::string, size_t> lookup_;
+  std::unordered_set<std::string> normalized_names_;
+  /** entries of central directory and their local header offsets */
+  std::vector<ZipEntry> entries_;
+  std::vector<uint64_t> central_offsets_;
+  /** number of entries declared in end of central directory record */
+  uint64_t declared_entries_;
+  /** total size of data extracted or reserved so far */
+  uint64_t unpacked_size_;
+  /** part of unpacked_size_ reserved for currently extracted entry */
+  uint64_t entry_reserved_;
+  bool out_of_space_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipStreamExtractor);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_ZIP_STREAM_EXTRACTOR_H_
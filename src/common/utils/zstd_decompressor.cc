@@ -0,0 +1,65 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "common/utils/zstd_decompressor.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <manifest_parser/utils/logging.h>
+
+namespace common_installer {
+
+#ifdef HAVE_ZSTD
+
+ZstdDecompressor::ZstdDecompressor()
+    : context_(ZSTD_createDStream()) {
+  if (context_)
+    ZSTD_initDStream(static_cast<ZSTD_DStream*>(context_));
+}
+
+ZstdDecompressor::~ZstdDecompressor() {
+  if (context_)
+    ZSTD_freeDStream(static_cast<ZSTD_DStream*>(context_));
+}
+
+ZstdDecompressor::Result ZstdDecompressor::Decompress(
+    const uint8_t* in, size_t in_size, size_t* in_consumed,
+    uint8_t* out, size_t out_size, size_t* out_produced) {
+  ZSTD_inBuffer input = {in, in_size, 0};
+  ZSTD_outBuffer output = {out, out_size, 0};
+  size_t ret = ZSTD_decompressStream(static_cast<ZSTD_DStream*>(context_),
+                                     &output, &input);
+  *in_consumed = input.pos;
+  *out_produced = output.pos;
+  if (ZSTD_isError(ret)) {
+    LOG(ERROR) << "Failed to decompress zstd data: "
+               << ZSTD_getErrorName(ret);
+    return Result::ERROR;
+  }
+  return ret == 0 ? Result::FRAME_END : Result::PROGRESS;
+}
+
+#else  // HAVE_ZSTD
+
+ZstdDecompressor::ZstdDecompressor()
+    : context_(nullptr) {
+}
+
+ZstdDecompressor::~ZstdDecompressor() {
+}
+
+ZstdDecompressor::Result ZstdDecompressor::Decompress(
+    const uint8_t* /* in */, size_t /* in_size */, size_t* in_consumed,
+    uint8_t* /* out */, size_t /* out_size */, size_t* out_produced) {
+  *in_consumed = 0;
+  *out_produced = 0;
+  LOG(ERROR) << "zstd support is not built in";
+  return Result::ERROR;
+}
+
+#endif  // HAVE_ZSTD
+
+}  // namespace common_installer
@@ -0,0 +1,59 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef COMMON_UTILS_ZSTD_DECOMPRESSOR_H_
+#define COMMON_UTILS_ZSTD_DECOMPRESSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Streaming decompressor of zstd frames, used for zip entries
+ *        compressed with method 93.
+ *
+ * Decompression is available only if built with HAVE_ZSTD, otherwise
+ * valid() returns false and entries using zstd are rejected.
+ */
+class ZstdDecompressor {
+ public:
+  enum class Result {
+    ERROR,     // data is corrupted
+    PROGRESS,  // more input or output space is needed
+    FRAME_END  // end of frame was reached and all its data was flushed
+  };
+
+  ZstdDecompressor();
+  ~ZstdDecompressor();
+
+  /** true if zstd support is built in and context was created */
+  bool valid() const { return context_ != nullptr; }
+
+  /**
+   * \brief Decompresses as much of input as fits into output
+   *
+   * \param in compressed data
+   * \param in_size size of compressed data
+   * \param in_consumed number of compressed bytes used
+   * \param out output buffer
+   * \param out_size size of output buffer
+   * \param out_produced number of bytes written to out
+   *
+   * \return decompression state
+   */
+  Result Decompress(const uint8_t* in, size_t in_size, size_t* in_consumed,
+                    uint8_t* out, size_t out_size, size_t* out_produced);
+
+ private:
+  void* context_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZstdDecompressor);
+};
+
+}  // namespace common_installer
+
+#endif  // COMMON_UTILS_ZSTD_DECOMPRESSOR_H_
@@ -0,0 +1,59 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache-2.0 license that can be
+// found in the LICENSE file.
+
+// Creates delta package updating installed package to new version, see
+// PackageDelta.
+
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <string>
+
+#include "delta_generator/package_delta.h"
+
+namespace bpo = boost::program_options;
+namespace ci = common_installer;
+
+int main(int argc, char** argv) {
+  bpo::options_description options("Allowed options");
+  bpo::variables_map opt_map;
+  try {
+    options.add_options()
+        ("help,h", "display this help message")
+        ("old,s", bpo::value<std::string>()->required(),
+            "package of installed version")
+        ("new,t", bpo::value<std::string>()->required(),
+            "package of version to update to")
+        ("output,o", bpo::value<std::string>()->required(),
+            "delta package to create")
+        ("max-patch-ratio,r", bpo::value<double>()->default_value(0.8),
+            "changed file is added in full if its patch is bigger than this "
+            "part of its size");
+    bpo::store(bpo::parse_command_line(argc, argv, options), opt_map);
+    if (opt_map.count("help")) {
+      std::cerr << options << std::endl;
+      return 0;
+    }
+    bpo::notify(opt_map);
+  } catch (const bpo::error& error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+
+  ci::PackageDelta delta(opt_map["old"].as<std::string>(),
+                         opt_map["new"].as<std::string>(),
+                         opt_map["max-patch-ratio"].as<double>());
+  if (!delta.Create(opt_map["output"].as<std::string>())) {
+    std::cerr << "Failed to create delta package" << std::endl;
+    return -1;
+  }
+  const ci::PackageDelta::Stats& stats = delta.stats();
+  std::cout << "added: " << stats.added
+            << ", patched: " << stats.patched
+            << ", replaced: " << stats.replaced
+            << ", removed: " << stats.removed << std::endl
+            << "content: " << stats.new_size << " bytes, delta: "
+            << stats.delta_size << " bytes" << std::endl;
+  return 0;
+}
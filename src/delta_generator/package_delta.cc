@@ -0,0 +1,254 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "delta_generator/package_delta.h"
+
+#include <zip.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <manifest_parser/utils/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "common/utils/file_util.h"
+#include "common/utils/vcdiff_encoder.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace {
+
+const char kDeltaFile[] = "delta_info.xml";
+
+bool ReadFile(const bf::path& path, std::vector<uint8_t>* data) {
+  std::ifstream stream(path.string(), std::ios::binary);
+  if (!stream)
+    return false;
+  data->assign(std::istreambuf_iterator<char>(stream),
+               std::istreambuf_iterator<char>());
+  return !stream.bad();
+}
+
+bool WriteFile(const bf::path& path, const std::vector<uint8_t>& data) {
+  std::ofstream stream(path.string(), std::ios::binary | std::ios::trunc);
+  stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+  return static_cast<bool>(stream);
+}
+
+std::string EscapeXml(const std::string& text) {
+  std::string result;
+  for (char c : text) {
+    switch (c) {
+      case '&': result += "&amp;"; break;
+      case '<': result += "&lt;"; break;
+      case '>': result += "&gt;"; break;
+      case '"': result += "&quot;"; break;
+      default: result += c;
+    }
+  }
+  return result;
+}
+
+bool AddZipEntry(zipFile zip_file, const std::string& name,
+                 const uint8_t* data, size_t size) {
+  zip_fileinfo info = {};
+  return zipOpenNewFileInZip64(zip_file, name.c_str(), &info, nullptr, 0,
+                               nullptr, 0, nullptr, Z_DEFLATED,
+                               Z_DEFAULT_COMPRESSION, 1) == ZIP_OK &&
+      zipWriteInFileInZip(zip_file, data, size) == ZIP_OK &&
+      zipCloseFileInZip(zip_file) == ZIP_OK;
+}
+
+}  // namespace
+
+namespace common_installer {
+
+PackageDelta::PackageDelta(const bf::path& old_package,
+                           const bf::path& new_package,
+                           double max_patch_ratio)
+    : old_package_(old_package),
+      new_package_(new_package),
+      max_patch_ratio_(max_patch_ratio),
+      stats_() {
+}
+
+PackageDelta::~PackageDelta() {
+  if (!work_dir_.empty())
+    RemoveTree(work_dir_);
+}
+
+bool PackageDelta::Create(const bf::path& output) {
+  if (!Extract() || !CompareNewContent() || !CompareOldContent())
+    return false;
+  // stable output, parent directories stay before their content
+  for (auto* list : {&added_, &modified_, &removed_})
+    std::sort(list->begin(), list->end());
+  return WritePackage(output);
+}
+
+bool PackageDelta::Extract() {
+  work_dir_ = bf::temp_directory_path() /
+      bf::unique_path("delta-generator-%%%%%%");
+  old_dir_ = work_dir_ / "old";
+  new_dir_ = work_dir_ / "new";
+  patch_dir_ = work_dir_ / "patch";
+  bs::error_code error;
+  for (auto& dir : {old_dir_, new_dir_, patch_dir_}) {
+    bf::create_directories(dir, error);
+    if (error) {
+      LOG(ERROR) << "Cannot create directory " << dir;
+      return false;
+    }
+  }
+  if (!ExtractToTmpDir(old_package_.c_str(), old_dir_) ||
+      !ExtractToTmpDir(new_package_.c_str(), new_dir_)) {
+    LOG(ERROR) << "Failed to extract packages";
+    return false;
+  }
+  return true;
+}
+
+bool PackageDelta::CompareNewContent() {
+  try {
+    for (bf::recursive_directory_iterator iter(new_dir_);
+        iter != bf::recursive_directory_iterator(); ++iter) {
+      std::string relative = MakeRelativePath(iter->path(), new_dir_).string();
+      bf::path old_path = old_dir_ / relative;
+      if (bf::is_directory(iter->status())) {
+        // empty directories are recreated too
+        if (!bf::is_directory(bf::symlink_status(old_path)))
+          added_.push_back(relative);
+      } else if (bf::is_regular_file(iter->status())) {
+        stats_.new_size += bf::file_size(iter->path());
+        if (!CompareFile(relative))
+          return false;
+      } else {
+        LOG(ERROR) << "Unsupported file type: " << relative;
+        return false;
+      }
+    }
+  } catch (const bf::filesystem_error& error) {
+    LOG(ERROR) << "Failed to read new content: " << error.what();
+    return false;
+  }
+  return true;
+}
+
+bool PackageDelta::CompareFile(const std::string& relative) {
+  bf::path new_path = new_dir_ / relative;
+  bf::path old_path = old_dir_ / relative;
+  std::vector<uint8_t> new_data;
+  if (!ReadFile(new_path, &new_data)) {
+    LOG(ERROR) << "Cannot read " << new_path;
+    return false;
+  }
+  if (!bf::is_regular_file(bf::symlink_status(old_path))) {
+    added_.push_back(relative);
+    ++stats_.added;
+    stats_.delta_size += new_data.size();
+    return true;
+  }
+  std::vector<uint8_t> old_data;
+  if (!ReadFile(old_path, &old_data)) {
+    LOG(ERROR) << "Cannot read " << old_path;
+    return false;
+  }
+  if (old_data == new_data)
+    return true;
+
+  VcdiffEncoder encoder(old_data.data(), old_data.size());
+  std::vector<uint8_t> patch;
+  encoder.Encode(new_data.data(), new_data.size(), &patch);
+  if (patch.size() > max_patch_ratio_ * new_data.size()) {
+    added_.push_back(relative);
+    ++stats_.replaced;
+    stats_.delta_size += new_data.size();
+    return true;
+  }
+  bf::path patch_path = patch_dir_ / relative;
+  bs::error_code error;
+  bf::create_directories(patch_path.parent_path(), error);
+  if (error || !WriteFile(patch_path, patch)) {
+    LOG(ERROR) << "Cannot write patch " << patch_path;
+    return false;
+  }
+  modified_.push_back(relative);
+  ++stats_.patched;
+  stats_.delta_size += patch.size();
+  return true;
+}
+
+bool PackageDelta::CompareOldContent() {
+  try {
+    for (bf::recursive_directory_iterator iter(old_dir_);
+        iter != bf::recursive_directory_iterator(); ++iter) {
+      std::string relative = MakeRelativePath(iter->path(), old_dir_).string();
+      bf::file_status status = bf::symlink_status(new_dir_ / relative);
+      bool is_directory = bf::is_directory(iter->status());
+      if (bf::exists(status) && is_directory == bf::is_directory(status))
+        continue;
+      // removed directory is removed with whole content
+      if (is_directory)
+        iter.no_push();
+      removed_.push_back(relative);
+      ++stats_.removed;
+    }
+  } catch (const bf::filesystem_error& error) {
+    LOG(ERROR) << "Failed to read old content: " << error.what();
+    return false;
+  }
+  return true;
+}
+
+bool PackageDelta::WritePackage(const bf::path& output) const {
+  zipFile zip_file = zipOpen64(output.c_str(), APPEND_STATUS_CREATE);
+  if (!zip_file) {
+    LOG(ERROR) << "Cannot create " << output;
+    return false;
+  }
+  std::string delta_info = DeltaInfo();
+  bool result = AddZipEntry(zip_file, kDeltaFile,
+      reinterpret_cast<const uint8_t*>(delta_info.data()), delta_info.size());
+  std::vector<uint8_t> data;
+  for (auto& relative : added_) {
+    if (!result)
+      break;
+    bf::path path = new_dir_ / relative;
+    if (bf::is_directory(path)) {
+      result = AddZipEntry(zip_file, relative + "/", nullptr, 0);
+      continue;
+    }
+    result = ReadFile(path, &data) &&
+        AddZipEntry(zip_file, relative, data.data(), data.size());
+  }
+  for (auto& relative : modified_) {
+    if (!result)
+      break;
+    result = ReadFile(patch_dir_ / relative, &data) &&
+        AddZipEntry(zip_file, relative, data.data(), data.size());
+  }
+  if (zipClose(zip_file, nullptr) != ZIP_OK)
+    result = false;
+  if (!result)
+    LOG(ERROR) << "Failed to write " << output;
+  return result;
+}
+
+std::string PackageDelta::DeltaInfo() const {
+  std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<delta>\n";
+  for (auto& relative : removed_)
+    xml += "  <remove name=\"" + EscapeXml(relative) + "\"/>\n";
+  for (auto& relative : added_)
+    xml += "  <add name=\"" + EscapeXml(relative) + "\"/>\n";
+  for (auto& relative : modified_)
+    xml += "  <modify name=\"" + EscapeXml(relative) + "\"/>\n";
+  xml += "</delta>\n";
+  return xml;
+}
+
+}  // namespace common_installer
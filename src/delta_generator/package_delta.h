@@ -0,0 +1,89 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by a apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef DELTA_GENERATOR_PACKAGE_DELTA_H_
+#define DELTA_GENERATOR_PACKAGE_DELTA_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/utils/macros.h"
+
+namespace common_installer {
+
+/**
+ * \brief Creates delta package which updates content of old package to
+ *        content of new package, as applied by StepDeltaPatch.
+ *
+ * Delta package is zip archive containing delta_info.xml, which lists
+ * added, modified and removed paths, content of added files and VCDIFF
+ * patches of modified files, stored under their paths. Changed file is
+ * listed as modified only if its patch is small enough compared to the
+ * file itself, otherwise it is added again in full.
+ */
+class PackageDelta {
+ public:
+  struct Stats {
+    unsigned added;
+    unsigned patched;
+    unsigned replaced;  // changed files added in full
+    unsigned removed;
+    uint64_t new_size;  // uncompressed size of new content
+    uint64_t delta_size;  // uncompressed size of content of delta
+  };
+
+  /**
+   * Constructor
+   *
+   * \param old_package package currently installed
+   * \param new_package package to update to
+   * \param max_patch_ratio highest ratio of patch size to file size for
+   *                        which file is patched
+   */
+  PackageDelta(const boost::filesystem::path& old_package,
+               const boost::filesystem::path& new_package,
+               double max_patch_ratio);
+  ~PackageDelta();
+
+  /**
+   * \brief Compares packages and writes delta package
+   *
+   * \param output path of delta package to create
+   *
+   * \return true on success
+   */
+  bool Create(const boost::filesystem::path& output);
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  bool Extract();
+  bool CompareNewContent();
+  bool CompareOldContent();
+  bool CompareFile(const std::string& relative);
+  bool WritePackage(const boost::filesystem::path& output) const;
+  std::string DeltaInfo() const;
+
+  boost::filesystem::path old_package_;
+  boost::filesystem::path new_package_;
+  double max_patch_ratio_;
+  boost::filesystem::path work_dir_;
+  boost::filesystem::path old_dir_;
+  boost::filesystem::path new_dir_;
+  boost::filesystem::path patch_dir_;
+  // relative paths of entries listed in delta_info.xml
+  std::vector<std::string> added_;
+  std::vector<std::string> modified_;
+  std::vector<std::string> removed_;
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(PackageDelta);
+};
+
+}  // namespace common_installer
+
+#endif  // DELTA_GENERATOR_PACKAGE_DELTA_H_
@@ -0,0 +1,247 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <pkgmgr_installer.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/app_installer.h"
+#include "common/pkgmgr_interface.h"
+#include "common/step/step.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+namespace {
+
+const unsigned kThreads = 4;
+
+class TestPkgmgrInstaller : public PkgmgrInstallerInterface {
+ public:
+  bool CreatePkgMgrInstaller(pkgmgr_installer** installer,
+                             InstallationMode* mode) override {
+    *installer = pkgmgr_installer_offline_new();
+    if (!*installer)
+      return false;
+    *mode = InstallationMode::OFFLINE;
+    return true;
+  }
+  bool ShouldCreateSignal() const override {
+    return false;
+  }
+};
+
+// events of steps in order in which they happened
+class EventLog {
+ public:
+  void Add(const std::string& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back(event);
+    changed_.notify_all();
+  }
+
+  // waits until event happens, returns false on timeout
+  bool WaitFor(const std::string& event) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, std::chrono::seconds(10), [&] {
+      return std::find(events_.begin(), events_.end(), event) !=
+          events_.end();
+    });
+  }
+
+  // position of event or -1 if it did not happen
+  int IndexOf(const std::string& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(events_.begin(), events_.end(), event);
+    return it == events_.end() ? -1 : it - events_.begin();
+  }
+
+  std::vector<std::string> WithPrefix(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> result;
+    for (auto& event : events_)
+      if (event.compare(0, prefix.size(), prefix) == 0)
+        result.push_back(event.substr(prefix.size()));
+    return result;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::vector<std::string> events_;
+};
+
+// step which logs its execution and declares given resources, steps
+// without resources are barriers
+class TestStep : public Step {
+ public:
+  struct Options {
+    std::vector<std::string> reads;
+    std::vector<std::string> writes;
+    // event which must happen before process() finishes
+    std::string awaited;
+    // time for which process() sleeps
+    unsigned delay_ms = 0;
+    bool fails = false;
+  };
+
+  TestStep(InstallerContext* context, EventLog* log, const std::string& name,
+           const Options& options)
+      : Step(context),
+        log_(log),
+        name_(name),
+        options_(options) {
+  }
+
+  Status precheck() override { return Status::OK; }
+  Status process() override {
+    log_->Add("start " + name_);
+    bool awaited =
+        options_.awaited.empty() || log_->WaitFor(options_.awaited);
+    std::this_thread::sleep_for(std::chrono::milliseconds(options_.delay_ms));
+    log_->Add("end " + name_);
+    return awaited && !options_.fails ? Status::OK : Status::ERROR;
+  }
+  Status clean() override { return Status::OK; }
+  Status undo() override {
+    log_->Add("undo " + name_);
+    return Status::OK;
+  }
+
+  bool GetDependencies(StepDependencies* dependencies) const override {
+    if (options_.reads.empty() && options_.writes.empty())
+      return false;
+    for (auto& resource : options_.reads)
+      dependencies->Reads(resource);
+    for (auto& resource : options_.writes)
+      dependencies->Writes(resource);
+    return true;
+  }
+
+  const char* name() const override { return name_.c_str(); }
+
+ private:
+  EventLog* log_;
+  std::string name_;
+  Options options_;
+};
+
+class TestAppInstaller : public AppInstaller {
+ public:
+  TestAppInstaller(PkgMgrPtr pkgmgr, const bf::path& root)
+      : AppInstaller("test", pkgmgr) {
+    context_->root_application_path.set(root);
+    EnableParallelSteps(kThreads);
+  }
+};
+
+}  // namespace
+
+// Steps run by AppInstaller::ProcessParallel() must respect dependencies
+// they declare and be undone in reverse order of their completion.
+class AppInstallerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = bf::temp_directory_path() /
+        bf::unique_path("app-installer-test-%%%%%%");
+    ASSERT_TRUE(bf::create_directories(root_));
+    const char* argv[] = {"app_installer_unittest", "-i", "test.tpk"};
+    pkgmgr_ = PkgMgrInterface::Create(3, const_cast<char**>(argv),
+                                      &pkgmgr_installer_);
+    ASSERT_TRUE(pkgmgr_ != nullptr);
+    installer_.reset(new TestAppInstaller(pkgmgr_, root_));
+  }
+
+  void TearDown() override {
+    installer_.reset();
+    bs::error_code error;
+    bf::remove_all(root_, error);
+  }
+
+  void AddStep(const std::string& name, const TestStep::Options& options) {
+    installer_->AddStep<TestStep>(&log_, name, options);
+  }
+
+  bf::path root_;
+  TestPkgmgrInstaller pkgmgr_installer_;
+  PkgMgrPtr pkgmgr_;
+  std::unique_ptr<TestAppInstaller> installer_;
+  EventLog log_;
+};
+
+TEST_F(AppInstallerTest, RunsStepsInOrderOfDeclaredDependencies) {
+  TestStep::Options writer;
+  writer.writes = {"a"};
+  // finishes only if independent step runs concurrently with it
+  writer.awaited = "start independent";
+  TestStep::Options reader;
+  reader.reads = {"a"};
+  TestStep::Options independent;
+  independent.writes = {"b"};
+  AddStep("writer", writer);
+  AddStep("reader", reader);
+  AddStep("independent", independent);
+
+  ASSERT_EQ(installer_->Run(), AppInstaller::Result::OK);
+  EXPECT_LT(log_.IndexOf("end writer"), log_.IndexOf("start reader"));
+  EXPECT_LT(log_.IndexOf("start independent"), log_.IndexOf("end writer"));
+}
+
+TEST_F(AppInstallerTest, RunsUndeclaredStepAsBarrier) {
+  TestStep::Options first;
+  first.writes = {"a"};
+  TestStep::Options barrier;
+  TestStep::Options last;
+  last.writes = {"b"};
+  AddStep("first", first);
+  AddStep("barrier", barrier);
+  AddStep("last", last);
+
+  ASSERT_EQ(installer_->Run(), AppInstaller::Result::OK);
+  EXPECT_LT(log_.IndexOf("end first"), log_.IndexOf("start barrier"));
+  EXPECT_LT(log_.IndexOf("end barrier"), log_.IndexOf("start last"));
+}
+
+TEST_F(AppInstallerTest, UndoesStepsInReverseOrderOfCompletion) {
+  // "slow" is listed first but finishes after "fast", as it waits for step
+  // started only when "fast" is done. That step fails well after "slow".
+  TestStep::Options slow;
+  slow.writes = {"a"};
+  slow.awaited = "start failing";
+  TestStep::Options fast;
+  fast.writes = {"b"};
+  TestStep::Options failing;
+  failing.reads = {"b"};
+  failing.writes = {"c"};
+  failing.delay_ms = 200;
+  failing.fails = true;
+  TestStep::Options not_started;
+  not_started.reads = {"c"};
+  AddStep("slow", slow);
+  AddStep("fast", fast);
+  AddStep("failing", failing);
+  AddStep("not_started", not_started);
+
+  ASSERT_EQ(installer_->Run(), AppInstaller::Result::ERROR);
+  std::vector<std::string> completed = {"fast", "slow", "failing"};
+  EXPECT_EQ(log_.WithPrefix("end "), completed);
+  std::vector<std::string> undone = {"failing", "slow", "fast"};
+  EXPECT_EQ(log_.WithPrefix("undo "), undone);
+}
+
+}  // namespace common_installer
@@ -0,0 +1,164 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+
+#include "common/installer_context.h"
+#include "common/step/filesystem/step_delta_patch.h"
+#include "common/utils/file_util.h"
+#include "delta_generator/package_delta.h"
+#include "unit_tests/test_utils.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+namespace {
+
+const char kPkgId[] = "org.test.delta";
+// package content is kept in subdirectory of package directory, like widget
+// content, which keeps StepDeltaPatch away from files added by installer
+const char kDeltaRoot[] = "res/wgt";
+
+}  // namespace
+
+// Delta created by PackageDelta and applied by StepDeltaPatch must turn
+// installed old package content into new package content.
+class PackageDeltaTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    work_dir_ = bf::temp_directory_path() /
+        bf::unique_path("package-delta-test-%%%%%%");
+    root_ = work_dir_ / "apps";
+    installed_ = root_ / kPkgId / kDeltaRoot;
+    unpacked_ = work_dir_ / "unpacked";
+    ASSERT_TRUE(bf::create_directories(installed_));
+    ASSERT_TRUE(bf::create_directories(unpacked_));
+  }
+
+  void TearDown() override {
+    bs::error_code error;
+    bf::remove_all(work_dir_, error);
+  }
+
+  // creates delta between packages, installs old one and applies delta,
+  // installed content may be changed before delta is applied
+  void ApplyDelta(const FileTree& old_files, const FileTree& new_files,
+                  PackageDelta::Stats* stats,
+                  const std::function<void()>& change_installed = nullptr) {
+    bf::path old_package = work_dir_ / "old.wgt";
+    bf::path new_package = work_dir_ / "new.wgt";
+    bf::path delta_package = work_dir_ / "delta.wgt";
+    ASSERT_TRUE(WritePackage(old_package, old_files));
+    ASSERT_TRUE(WritePackage(new_package, new_files));
+    PackageDelta delta(old_package, new_package, 0.5);
+    ASSERT_TRUE(delta.Create(delta_package));
+    *stats = delta.stats();
+
+    ASSERT_TRUE(ExtractToTmpDir(old_package.c_str(), installed_));
+    ASSERT_TRUE(ExtractToTmpDir(delta_package.c_str(), unpacked_));
+    if (change_installed)
+      change_installed();
+
+    InstallerContext context;
+    context.pkgid.set(kPkgId);
+    context.root_application_path.set(root_);
+    context.unpacked_dir_path.set(unpacked_);
+    filesystem::StepDeltaPatch step(&context, kDeltaRoot);
+    ASSERT_EQ(step.precheck(), Step::Status::OK);
+    ASSERT_EQ(step.process(), Step::Status::OK);
+  }
+
+  bf::path work_dir_;
+  bf::path root_;
+  bf::path installed_;
+  bf::path unpacked_;
+};
+
+TEST_F(PackageDeltaTest, AppliesAddedRemovedModifiedAndReplacedFiles) {
+  std::string modified = MakeContent(256 * 1024, 1);
+  FileTree old_files = {
+    {"config.xml", "<widget/>"},
+    {"kept/same.txt", "same"},
+    {"modified.bin", modified},
+    {"replaced.bin", MakeContent(16 * 1024, 2)},
+    {"removed.txt", "removed"},
+    {"removed_dir/inner.txt", "inner"},
+    {"to_dir", "file"},
+    {"to_file/inner.txt", "inner"},
+  };
+  // small change keeps patch small, replaced file has nothing in common
+  modified.replace(100000, 64, MakeContent(64, 3));
+  modified.append("appended");
+  FileTree new_files = {
+    {"config.xml", "<widget version=\"2\"/>"},
+    {"kept/same.txt", "same"},
+    {"modified.bin", modified},
+    {"replaced.bin", MakeContent(16 * 1024, 4)},
+    {"added.txt", "added"},
+    {"added_dir/inner.txt", "added inner"},
+    // file replaced by directory and directory by file
+    {"to_dir/inner.txt", "inner"},
+    {"to_file", "file"},
+  };
+
+  PackageDelta::Stats stats;
+  ApplyDelta(old_files, new_files, &stats);
+  EXPECT_GE(stats.added, 4u);
+  EXPECT_GE(stats.patched, 1u);
+  EXPECT_GE(stats.replaced, 1u);
+  EXPECT_GE(stats.removed, 4u);
+  EXPECT_EQ(ReadTree(unpacked_), new_files);
+  // installed package is only read while patching
+  EXPECT_EQ(ReadTree(installed_), old_files);
+}
+
+TEST_F(PackageDeltaTest, DoesNotCopyRemovedFiles) {
+  FileTree old_files = {
+    {"config.xml", "<widget/>"},
+    {"removed_dir/inner.txt", "inner"},
+    {"removed.txt", "removed"},
+  };
+  FileTree new_files = {
+    {"config.xml", "<widget/>"},
+  };
+  // installed files which cannot be copied are never touched if delta
+  // removes them
+  PackageDelta::Stats stats;
+  ApplyDelta(old_files, new_files, &stats, [this] {
+    bf::remove(installed_ / "removed.txt");
+    bf::remove(installed_ / "removed_dir" / "inner.txt");
+    ASSERT_EQ(mkfifo((installed_ / "removed.txt").c_str(), 0600), 0);
+    ASSERT_EQ(mkfifo((installed_ / "removed_dir" / "inner.txt").c_str(),
+                     0600), 0);
+  });
+  EXPECT_EQ(stats.removed, 2u);
+  EXPECT_EQ(ReadTree(unpacked_), new_files);
+  EXPECT_FALSE(bf::exists(unpacked_ / "removed_dir"));
+}
+
+TEST_F(PackageDeltaTest, AppliesDeltaOfSamePackage) {
+  FileTree files = {
+    {"config.xml", "<widget/>"},
+    {"data.bin", MakeContent(64 * 1024, 5)},
+  };
+  PackageDelta::Stats stats;
+  ApplyDelta(files, files, &stats);
+  EXPECT_EQ(stats.added, 0u);
+  EXPECT_EQ(stats.patched, 0u);
+  EXPECT_EQ(stats.replaced, 0u);
+  EXPECT_EQ(stats.removed, 0u);
+  EXPECT_EQ(ReadTree(unpacked_), files);
+}
+
+}  // namespace common_installer
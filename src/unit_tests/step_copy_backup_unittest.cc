@@ -0,0 +1,168 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+#include "common/installer_context.h"
+#include "common/paths.h"
+#include "common/recovery_file.h"
+#include "common/step/backup/step_copy_backup.h"
+#include "common/step/filesystem/step_recover_files.h"
+#include "common/utils/file_util.h"
+#include "unit_tests/test_utils.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+namespace {
+
+const char kPkgId[] = "org.test.update";
+
+}  // namespace
+
+// Update state left on disk by crash at different points of StepCopyBackup
+// must be recovered by StepRecoverFiles to old package content.
+class StepCopyBackupTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = bf::temp_directory_path() /
+        bf::unique_path("copy-backup-test-%%%%%%");
+    pkg_path_ = root_ / kPkgId;
+    unpacked_ = root_ / ".staging-test";
+    recovery_path_ = root_ / "recovery";
+    ASSERT_TRUE(bf::create_directories(pkg_path_ / "bin"));
+    ASSERT_TRUE(bf::create_directories(unpacked_ / "bin"));
+    WriteFile(pkg_path_ / "bin" / "app", "old");
+    WriteFile(unpacked_ / "bin" / "app", "new");
+
+    auto recovery_file =
+        recovery::RecoveryFile::CreateRecoveryFileForPath(recovery_path_);
+    ASSERT_TRUE(recovery_file);
+    recovery_file->set_type(RequestType::Update);
+    recovery_file->set_pkgid(kPkgId);
+    ASSERT_TRUE(recovery_file->WriteAndCommitFileContent());
+    context_.recovery_info.set(RecoveryInfo(std::move(recovery_file)));
+    context_.pkgid.set(kPkgId);
+    context_.root_application_path.set(root_);
+    context_.unpacked_dir_path.set(unpacked_);
+  }
+
+  void TearDown() override {
+    bs::error_code error;
+    bf::remove_all(root_, error);
+  }
+
+  // runs process() of StepCopyBackup, as during update
+  void CommitUpdate(backup::StepCopyBackup* step) {
+    ASSERT_EQ(step->precheck(), Step::Status::OK);
+    ASSERT_EQ(step->process(), Step::Status::OK);
+    ASSERT_EQ(ReadFile(pkg_path_ / "bin" / "app"), "new");
+    ASSERT_FALSE(bf::exists(unpacked_));
+  }
+
+  // records backup phase as StepCopyBackup does before renames
+  void SetBackupPhase(recovery::BackupPhase phase) {
+    auto& recovery_file = context_.recovery_info.get().recovery_file;
+    recovery_file->set_backup_phase(phase);
+    recovery_file->set_backup_content(GetPathIdentity(pkg_path_));
+    ASSERT_TRUE(recovery_file->WriteAndCommitFileContent());
+  }
+
+  void RecoverAndExpectOldContent() {
+    InstallerContext recovery_context;
+    auto recovery_file =
+        recovery::RecoveryFile::OpenRecoveryFileForPath(recovery_path_);
+    ASSERT_TRUE(recovery_file);
+    recovery_file->Detach();
+    recovery_context.recovery_info.set(
+        RecoveryInfo(std::move(recovery_file)));
+    recovery_context.pkgid.set(kPkgId);
+    recovery_context.root_application_path.set(root_);
+    filesystem::StepRecoverFiles step(&recovery_context);
+    ASSERT_EQ(step.RecoveryUpdate(), Step::Status::OK);
+    EXPECT_EQ(ReadFile(pkg_path_ / "bin" / "app"), "old");
+    EXPECT_FALSE(bf::exists(GetBackupPathForPackagePath(pkg_path_)));
+    EXPECT_FALSE(bf::exists(GetStagingPathForPackagePath(pkg_path_)));
+  }
+
+  InstallerContext context_;
+  bf::path root_;
+  bf::path pkg_path_;
+  bf::path unpacked_;
+  bf::path recovery_path_;
+};
+
+TEST_F(StepCopyBackupTest, CommitKeepsOldContentAtBackupPath) {
+  backup::StepCopyBackup step(&context_);
+  CommitUpdate(&step);
+  EXPECT_EQ(ReadFile(GetBackupPathForPackagePath(pkg_path_) / "bin" / "app"),
+            "old");
+  EXPECT_FALSE(bf::exists(GetStagingPathForPackagePath(pkg_path_)));
+}
+
+TEST_F(StepCopyBackupTest, UndoRestoresOldContent) {
+  backup::StepCopyBackup step(&context_);
+  CommitUpdate(&step);
+  ASSERT_EQ(step.undo(), Step::Status::OK);
+  EXPECT_EQ(ReadFile(pkg_path_ / "bin" / "app"), "old");
+  EXPECT_FALSE(bf::exists(GetBackupPathForPackagePath(pkg_path_)));
+  EXPECT_FALSE(bf::exists(GetStagingPathForPackagePath(pkg_path_)));
+}
+
+TEST_F(StepCopyBackupTest, RecoversCrashAfterStaging) {
+  // new content staged, package directory not exchanged yet
+  bf::rename(unpacked_, GetStagingPathForPackagePath(pkg_path_));
+  SetBackupPhase(recovery::BackupPhase::Exchange);
+  RecoverAndExpectOldContent();
+}
+
+TEST_F(StepCopyBackupTest, RecoversCrashDuringCommit) {
+  // directories exchanged, phase after exchange not recorded yet, so
+  // staging path holds old content
+  bf::rename(unpacked_, GetStagingPathForPackagePath(pkg_path_));
+  SetBackupPhase(recovery::BackupPhase::Exchange);
+  ASSERT_TRUE(ExchangePaths(pkg_path_,
+                            GetStagingPathForPackagePath(pkg_path_)));
+  RecoverAndExpectOldContent();
+}
+
+TEST_F(StepCopyBackupTest, RecoversCrashBeforeBackupRename) {
+  bf::rename(unpacked_, GetStagingPathForPackagePath(pkg_path_));
+  SetBackupPhase(recovery::BackupPhase::Exchanged);
+  ASSERT_TRUE(ExchangePaths(pkg_path_,
+                            GetStagingPathForPackagePath(pkg_path_)));
+  RecoverAndExpectOldContent();
+}
+
+TEST_F(StepCopyBackupTest, RecoversCrashAfterCommit) {
+  backup::StepCopyBackup step(&context_);
+  CommitUpdate(&step);
+  RecoverAndExpectOldContent();
+}
+
+TEST_F(StepCopyBackupTest, RecoversCrashDuringUndo) {
+  backup::StepCopyBackup step(&context_);
+  CommitUpdate(&step);
+  // undo exchanged directories back, backup path holds new content which
+  // was not removed yet
+  ASSERT_TRUE(ExchangePaths(pkg_path_,
+                            GetBackupPathForPackagePath(pkg_path_)));
+  RecoverAndExpectOldContent();
+}
+
+TEST_F(StepCopyBackupTest, RecoversCrashOfContentMove) {
+  // content moved to backup without exchange, new content not moved in yet
+  bf::rename(pkg_path_, GetBackupPathForPackagePath(pkg_path_));
+  RecoverAndExpectOldContent();
+}
+
+}  // namespace common_installer
@@ -0,0 +1,125 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include "unit_tests/test_utils.h"
+
+#include <zip.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace {
+
+bool AddEntry(zipFile zip_file, const common_installer::TestFile& file) {
+  zip_fileinfo info = {};
+  if (file.method != common_installer::kZipMethodZstd) {
+    return zipOpenNewFileInZip64(zip_file, file.name.c_str(), &info, nullptr,
+                                 0, nullptr, 0, nullptr, file.method,
+                                 Z_DEFAULT_COMPRESSION, 1) == ZIP_OK &&
+        zipWriteInFileInZip(zip_file, file.content.data(),
+                            file.content.size()) == ZIP_OK &&
+        zipCloseFileInZip(zip_file) == ZIP_OK;
+  }
+#ifdef HAVE_ZSTD
+  std::vector<char> compressed(ZSTD_compressBound(file.content.size()));
+  size_t size = ZSTD_compress(compressed.data(), compressed.size(),
+                              file.content.data(), file.content.size(), 3);
+  uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(file.content.data()),
+                    file.content.size());
+  // raw mode stores data compressed by us with given method
+  return !ZSTD_isError(size) &&
+      zipOpenNewFileInZip2_64(zip_file, file.name.c_str(), &info, nullptr, 0,
+                              nullptr, 0, nullptr,
+                              common_installer::kZipMethodZstd, 0, 1,
+                              1) == ZIP_OK &&
+      zipWriteInFileInZip(zip_file, compressed.data(), size) == ZIP_OK &&
+      zipCloseFileInZipRaw64(zip_file, file.content.size(), crc) == ZIP_OK;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+namespace common_installer {
+
+std::string ReadFile(const bf::path& path) {
+  std::ifstream stream(path.string(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const bf::path& path, const std::string& content) {
+  bs::error_code error;
+  bf::create_directories(path.parent_path(), error);
+  std::ofstream stream(path.string(), std::ios::binary | std::ios::trunc);
+  stream << content;
+}
+
+FileTree ReadTree(const bf::path& root) {
+  FileTree tree;
+  if (!bf::exists(root))
+    return tree;
+  for (bf::recursive_directory_iterator iter(root);
+       iter != bf::recursive_directory_iterator(); ++iter) {
+    if (!bf::is_regular_file(iter->symlink_status()))
+      continue;
+    std::string relative =
+        iter->path().string().substr(root.string().size() + 1);
+    tree[relative] = ReadFile(iter->path());
+  }
+  return tree;
+}
+
+std::string MakeContent(size_t size, unsigned seed) {
+  std::string content;
+  content.reserve(size);
+  uint32_t state = seed;
+  while (content.size() < size) {
+    state = state * 1103515245 + 12345;
+    content.push_back(static_cast<char>(state >> 16));
+  }
+  return content;
+}
+
+std::string MakeCompressibleContent(size_t size, unsigned seed) {
+  std::string content(size, '\0');
+  for (size_t i = 0; i < size; ++i)
+    content[i] = static_cast<char>((i / 7 + seed * 31 + (i % 13) * seed) % 61);
+  return content;
+}
+
+bool WritePackage(const bf::path& path, const std::vector<TestFile>& files) {
+  zipFile zip_file = zipOpen64(path.c_str(), APPEND_STATUS_CREATE);
+  if (!zip_file)
+    return false;
+  bool result = true;
+  for (auto& file : files) {
+    if (!AddEntry(zip_file, file)) {
+      result = false;
+      break;
+    }
+  }
+  return zipClose(zip_file, nullptr) == ZIP_OK && result;
+}
+
+bool WritePackage(const bf::path& path, const FileTree& files) {
+  std::vector<TestFile> entries;
+  for (auto& file : files)
+    entries.push_back({file.first, file.second, Z_DEFLATED});
+  return WritePackage(path, entries);
+}
+
+}  // namespace common_installer
@@ -0,0 +1,80 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#ifndef UNIT_TESTS_TEST_UTILS_H_
+#define UNIT_TESTS_TEST_UTILS_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace common_installer {
+
+/** zip compression method of zstd, see ZipExtractor */
+const int kZipMethodZstd = 93;
+
+/** regular files of directory tree keyed by relative path */
+typedef std::map<std::string, std::string> FileTree;
+
+/** entry of zip package written by WritePackage() */
+struct TestFile {
+  std::string name;
+  std::string content;
+  /** zip compression method, e.g. 0 (stored) or Z_DEFLATED */
+  int method;
+};
+
+/** \return whole content of file, empty if it cannot be read */
+std::string ReadFile(const boost::filesystem::path& path);
+
+/**
+ * \brief Replaces content of file, creating missing parent directories
+ */
+void WriteFile(const boost::filesystem::path& path,
+               const std::string& content);
+
+/**
+ * \return regular files below root, symlinks are not followed, empty if
+ *         root does not exist
+ */
+FileTree ReadTree(const boost::filesystem::path& root);
+
+/**
+ * \brief Generates pseudo-random content, which does not compress
+ *
+ * \param size size of content
+ * \param seed the same seed gives the same content
+ */
+std::string MakeContent(size_t size, unsigned seed);
+
+/**
+ * \brief Generates content which compresses, but not to nothing
+ *
+ * \param size size of content
+ * \param seed the same seed gives the same content
+ */
+std::string MakeCompressibleContent(size_t size, unsigned seed);
+
+/**
+ * \brief Creates zip package with given entries. Entries compressed with
+ *        kZipMethodZstd are supported only if tests are built with zstd.
+ *
+ * \return true on success
+ */
+bool WritePackage(const boost::filesystem::path& path,
+                  const std::vector<TestFile>& files);
+
+/**
+ * \brief Creates zip package with deflated entries of given files
+ *
+ * \return true on success
+ */
+bool WritePackage(const boost::filesystem::path& path, const FileTree& files);
+
+}  // namespace common_installer
+
+#endif  // UNIT_TESTS_TEST_UTILS_H_
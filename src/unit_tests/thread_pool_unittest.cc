@@ -0,0 +1,101 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#include "common/utils/thread_pool.h"
+
+namespace common_installer {
+
+namespace {
+
+// submits task which submits children down to given depth from the pool
+void SubmitTree(ThreadPool* pool, unsigned depth, std::atomic<int>* done) {
+  pool->Submit([pool, depth, done] {
+    if (depth > 0) {
+      SubmitTree(pool, depth - 1, done);
+      SubmitTree(pool, depth - 1, done);
+    }
+    ++*done;
+  });
+}
+
+}  // namespace
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+  std::atomic<int> done(0);
+  ThreadPool pool(4);
+  for (int i = 0; i < 1000; ++i)
+    pool.Submit([&done] { ++done; });
+  pool.Wait();
+  EXPECT_EQ(done, 1000);
+}
+
+TEST(ThreadPoolTest, WaitsForNestedTasks) {
+  std::atomic<int> done(0);
+  ThreadPool pool(4);
+  SubmitTree(&pool, 10, &done);
+  pool.Wait();
+  EXPECT_EQ(done, (1 << 11) - 1);
+
+  // pool is reusable after Wait()
+  SubmitTree(&pool, 3, &done);
+  pool.Wait();
+  EXPECT_EQ(done, (1 << 11) - 1 + (1 << 4) - 1);
+}
+
+TEST(ThreadPoolTest, DestructorWaitsForTasks) {
+  std::atomic<int> done(0);
+  {
+    ThreadPool pool(2);
+    SubmitTree(&pool, 6, &done);
+  }
+  EXPECT_EQ(done, (1 << 7) - 1);
+}
+
+TEST(ThreadPoolTest, RunsTasksConcurrently) {
+  // every task waits until all of them are started, which never happens
+  // if workers do not run in parallel
+  const unsigned kThreads = 4;
+  std::mutex mutex;
+  std::condition_variable all_started;
+  unsigned started = 0;
+  std::atomic<int> met(0);
+  ThreadPool pool(kThreads);
+  for (unsigned i = 0; i < kThreads; ++i) {
+    pool.Submit([&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (++started == kThreads)
+        all_started.notify_all();
+      if (all_started.wait_for(lock, std::chrono::seconds(10),
+                               [&] { return started == kThreads; }))
+        ++met;
+    });
+  }
+  pool.Wait();
+  EXPECT_EQ(met, static_cast<int>(kThreads));
+}
+
+TEST(ThreadPoolTest, IdleWorkersDoNotSpin) {
+  // workers waiting for tasks must sleep, so they use almost no cpu time
+  // while task of the only busy worker submits no subtasks
+  ThreadPool pool(4);
+  std::clock_t start = std::clock();
+  pool.Submit([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  });
+  pool.Wait();
+  double cpu_seconds = static_cast<double>(std::clock() - start) /
+      CLOCKS_PER_SEC;
+  EXPECT_LT(cpu_seconds, 0.1);
+}
+
+}  // namespace common_installer
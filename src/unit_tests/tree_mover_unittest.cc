@@ -0,0 +1,202 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "common/utils/file_util.h"
+#include "common/utils/tree_mover.h"
+#include "unit_tests/test_utils.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+class TreeMoverTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = bf::temp_directory_path() /
+        bf::unique_path("tree-mover-test-%%%%%%");
+    src_ = root_ / "src";
+    dst_ = root_ / "dst";
+    ASSERT_TRUE(bf::create_directories(src_));
+  }
+
+  void TearDown() override {
+    bs::error_code error;
+    bf::remove_all(root_, error);
+  }
+
+  void WriteJournal(const std::string& records) {
+    std::ofstream journal(TreeMover::JournalPath(dst_).string());
+    journal << "S " << src_.string() << "\n"
+            << "D " << dst_.string() << "\n"
+            << records;
+  }
+
+  bf::path root_;
+  bf::path src_;
+  bf::path dst_;
+};
+
+TEST_F(TreeMoverTest, MovesTree) {
+  WriteFile(src_ / "a", "a");
+  WriteFile(src_ / "dir" / "b", "b");
+  WriteFile(src_ / "dir" / "sub" / "c", std::string(100000, 'c'));
+  auto expected = ReadTree(src_);
+  TreeMover mover(src_, dst_, false);
+  ASSERT_TRUE(mover.Move());
+  EXPECT_EQ(ReadTree(dst_), expected);
+  EXPECT_FALSE(bf::exists(src_));
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, ResumesInterruptedMove) {
+  // state left by move interrupted in the middle of batch: "a" was copied
+  // and its source removed, "b" was copied but source not removed yet,
+  // "c" was partially copied and "dir/d" was not started
+  WriteFile(src_ / "b", "bbbb");
+  WriteFile(src_ / "c", "cccc");
+  WriteFile(src_ / "dir" / "d", "dddd");
+  WriteFile(dst_ / "a", "aaaa");
+  WriteFile(dst_ / "b", "bbbb");
+  WriteFile(dst_ / "c", "cc");
+  WriteJournal("C a\nC b\nC c\nF a\nF b\n");
+
+  ASSERT_TRUE(MoveDir(src_, dst_));
+  FileTree expected = {
+    {"a", "aaaa"}, {"b", "bbbb"}, {"c", "cccc"}, {"dir/d", "dddd"}
+  };
+  EXPECT_EQ(ReadTree(dst_), expected);
+  EXPECT_FALSE(bf::exists(src_));
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, ResumesMoveWithEmptyDestination) {
+  // interrupted before first batch, destination must not be replaced by
+  // rename leaving journal behind
+  WriteFile(src_ / "a", "aaaa");
+  ASSERT_TRUE(bf::create_directories(dst_));
+  WriteJournal("");
+
+  ASSERT_TRUE(MoveDir(src_, dst_));
+  EXPECT_EQ(ReadFile(dst_ / "a"), "aaaa");
+  EXPECT_FALSE(bf::exists(src_));
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, RollsBackAfterPartialMove) {
+  // more files than fit into one batch, so some batches are moved before
+  // move fails on entry which cannot be moved
+  for (int i = 0; i < 150; ++i)
+    WriteFile(src_ / ("file" + std::to_string(i)), std::to_string(i));
+  WriteFile(src_ / "dir" / "b", "b");
+  ASSERT_EQ(mkfifo((src_ / "dir" / "fifo").c_str(), 0600), 0);
+  auto expected = ReadTree(src_);
+
+  TreeMover mover(src_, dst_, false);
+  ASSERT_FALSE(mover.Move());
+  EXPECT_EQ(ReadTree(src_), expected);
+  EXPECT_TRUE(ReadTree(dst_).empty());
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, RollsBackFailedBatch) {
+  for (int i = 0; i < 10; ++i)
+    WriteFile(src_ / ("file" + std::to_string(i)), std::to_string(i));
+  auto expected = ReadTree(src_);
+  // copy of one file of batch fails, other files of it are copied
+  ASSERT_TRUE(bf::create_directories(dst_ / "file5"));
+
+  TreeMover mover(src_, dst_, false);
+  ASSERT_FALSE(mover.Move());
+  EXPECT_EQ(ReadTree(src_), expected);
+  EXPECT_TRUE(ReadTree(dst_).empty());
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, RollsBackInterruptedMove) {
+  WriteFile(src_ / "b", "bbbb");
+  WriteFile(dst_ / "a", "aaaa");
+  WriteFile(dst_ / "b", "bb");
+  WriteJournal("C a\nC b\nF a\n");
+
+  TreeMover mover(src_, dst_, false);
+  ASSERT_TRUE(mover.Rollback());
+  FileTree expected = {
+    {"a", "aaaa"}, {"b", "bbbb"}
+  };
+  EXPECT_EQ(ReadTree(src_), expected);
+  EXPECT_FALSE(bf::exists(dst_ / "a"));
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, MergeKeepsExistingFilesAfterResumeAndRollback) {
+  WriteFile(src_ / "kept", "new");
+  WriteFile(src_ / "big", std::string(256 * 1024, 'b'));
+  WriteFile(dst_ / "kept", "old");
+
+  // first move is killed by SIGXFSZ while copying big file, after batch
+  // with both files was journaled
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    struct rlimit limit = {0, 0};
+    setrlimit(RLIMIT_CORE, &limit);
+    limit.rlim_cur = limit.rlim_max = 64 * 1024;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    TreeMover mover(src_, dst_, true);
+    mover.Move();
+    _exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFSIGNALED(status));
+  ASSERT_TRUE(bf::exists(TreeMover::JournalPath(dst_)));
+
+  // resumed move fails on entry which cannot be moved and is rolled back
+  ASSERT_TRUE(bf::create_directories(src_ / "dir"));
+  ASSERT_EQ(mkfifo((src_ / "dir" / "fifo").c_str(), 0600), 0);
+  TreeMover mover(src_, dst_, true);
+  ASSERT_FALSE(mover.Move());
+  EXPECT_EQ(ReadFile(dst_ / "kept"), "old");
+  EXPECT_EQ(ReadFile(src_ / "kept"), "new");
+  EXPECT_EQ(ReadFile(src_ / "big"), std::string(256 * 1024, 'b'));
+  EXPECT_FALSE(bf::exists(dst_ / "big"));
+  EXPECT_FALSE(bf::exists(TreeMover::JournalPath(dst_)));
+}
+
+TEST_F(TreeMoverTest, MovesSymlinksWithoutFollowing) {
+  WriteFile(src_ / "file", "content");
+  WriteFile(src_ / "dir" / "inner", "inner");
+  bf::create_symlink("file", src_ / "relative");
+  bf::create_symlink(src_ / "dir", src_ / "to_dir");
+  bf::create_symlink("missing", src_ / "dangling");
+
+  TreeMover mover(src_, dst_, false);
+  ASSERT_TRUE(mover.Move());
+  EXPECT_TRUE(bf::is_symlink(dst_ / "relative"));
+  EXPECT_EQ(bf::read_symlink(dst_ / "relative"), bf::path("file"));
+  EXPECT_EQ(ReadFile(dst_ / "relative"), "content");
+  // link keeps its target, directory is not copied through it
+  EXPECT_TRUE(bf::is_symlink(dst_ / "to_dir"));
+  EXPECT_EQ(bf::read_symlink(dst_ / "to_dir"), src_ / "dir");
+  EXPECT_TRUE(bf::is_symlink(dst_ / "dangling"));
+  EXPECT_EQ(bf::read_symlink(dst_ / "dangling"), bf::path("missing"));
+  EXPECT_EQ(ReadFile(dst_ / "dir" / "inner"), "inner");
+  EXPECT_FALSE(bf::exists(src_));
+}
+
+}  // namespace common_installer
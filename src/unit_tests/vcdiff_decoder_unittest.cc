@@ -0,0 +1,268 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/utils/vcdiff_decoder.h"
+#include "common/utils/vcdiff_encoder.h"
+#include "unit_tests/test_utils.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+namespace {
+
+const uint8_t kHeader[] = {0xD6, 0xC3, 0xC4, 0x00, 0x00};
+
+// window indicators
+const uint8_t kVcdSource = 0x01;
+const uint8_t kVcdAdler32 = 0x04;
+
+// default code table indexes
+const uint8_t kAddSize4 = 5;
+const uint8_t kCopySize4Mode0 = 20;
+
+std::vector<uint8_t> Encode(const std::string& source,
+                            const std::string& target) {
+  VcdiffEncoder encoder(reinterpret_cast<const uint8_t*>(source.data()),
+                        source.size());
+  std::vector<uint8_t> delta;
+  encoder.Encode(reinterpret_cast<const uint8_t*>(target.data()),
+                 target.size(), &delta);
+  return delta;
+}
+
+// VCDIFF integer, base 128, most significant digit first
+void PutInteger(uint64_t value, std::vector<uint8_t>* out) {
+  uint8_t digits[10];
+  int count = 0;
+  do {
+    digits[count++] = value & 0x7F;
+    value >>= 7;
+  } while (value);
+  while (count > 1)
+    out->push_back(digits[--count] | 0x80);
+  out->push_back(digits[0]);
+}
+
+// builds delta with single window of given sections
+std::vector<uint8_t> MakeDelta(uint8_t indicator, uint64_t segment_size,
+                               uint64_t target_size, uint32_t checksum,
+                               const std::vector<uint8_t>& data,
+                               const std::vector<uint8_t>& instructions,
+                               const std::vector<uint8_t>& addresses) {
+  std::vector<uint8_t> encoding;
+  PutInteger(target_size, &encoding);
+  encoding.push_back(0);
+  PutInteger(data.size(), &encoding);
+  PutInteger(instructions.size(), &encoding);
+  PutInteger(addresses.size(), &encoding);
+  if (indicator & kVcdAdler32) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+      encoding.push_back((checksum >> shift) & 0xFF);
+  }
+  encoding.insert(encoding.end(), data.begin(), data.end());
+  encoding.insert(encoding.end(), instructions.begin(), instructions.end());
+  encoding.insert(encoding.end(), addresses.begin(), addresses.end());
+
+  std::vector<uint8_t> delta(kHeader, kHeader + sizeof(kHeader));
+  delta.push_back(indicator);
+  if (indicator & kVcdSource) {
+    PutInteger(segment_size, &delta);
+    PutInteger(0, &delta);
+  }
+  PutInteger(encoding.size(), &delta);
+  delta.insert(delta.end(), encoding.begin(), encoding.end());
+  return delta;
+}
+
+uint32_t Adler32(const std::string& data) {
+  return adler32(1, reinterpret_cast<const Bytef*>(data.data()),
+                 data.size());
+}
+
+}  // namespace
+
+class VcdiffDecoderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = bf::temp_directory_path() /
+        bf::unique_path("vcdiff-test-%%%%%%");
+    ASSERT_TRUE(bf::create_directories(root_));
+  }
+
+  void TearDown() override {
+    bs::error_code error;
+    bf::remove_all(root_, error);
+  }
+
+  // applies delta to source, decoded file content is stored in target
+  VcdiffDecoder::Result Decode(const std::string& source,
+                               const std::vector<uint8_t>& delta,
+                               std::string* target) {
+    bf::path source_path = root_ / "source";
+    bf::path delta_path = root_ / "delta";
+    bf::path target_path = root_ / "target";
+    WriteFile(source_path, source);
+    WriteFile(delta_path, std::string(delta.begin(), delta.end()));
+    int source_fd = open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+    int delta_fd = open(delta_path.c_str(), O_RDONLY | O_CLOEXEC);
+    int target_fd = open(target_path.c_str(),
+                         O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    EXPECT_GE(source_fd, 0);
+    EXPECT_GE(delta_fd, 0);
+    EXPECT_GE(target_fd, 0);
+    VcdiffDecoder decoder;
+    VcdiffDecoder::Result result =
+        decoder.Decode(source_fd, delta_fd, target_fd);
+    close(source_fd);
+    close(delta_fd);
+    close(target_fd);
+    *target = ReadFile(target_path);
+    return result;
+  }
+
+  bf::path root_;
+};
+
+TEST_F(VcdiffDecoderTest, DecodesEncoderOutput) {
+  std::string source = MakeContent(256 * 1024, 1);
+  // changed middle part, inserted and removed ranges
+  std::string target = source.substr(0, 100000) + MakeContent(5000, 2) +
+      source.substr(110000, 50000) + source.substr(200000) +
+      std::string(3000, 'x');
+  std::string decoded;
+  ASSERT_EQ(Decode(source, Encode(source, target), &decoded),
+            VcdiffDecoder::Result::OK);
+  EXPECT_EQ(decoded, target);
+}
+
+TEST_F(VcdiffDecoderTest, DecodesMultipleWindows) {
+  // target bigger than single window of encoder
+  std::string source = MakeContent(9 * 1024 * 1024, 3);
+  std::string target = source;
+  target.replace(4 * 1024 * 1024, 1024, MakeContent(1024, 4));
+  target.append(MakeContent(1024, 5));
+  std::string decoded;
+  ASSERT_EQ(Decode(source, Encode(source, target), &decoded),
+            VcdiffDecoder::Result::OK);
+  EXPECT_EQ(decoded, target);
+}
+
+TEST_F(VcdiffDecoderTest, DecodesWithEmptySource) {
+  std::string target = MakeContent(10000, 6);
+  std::string decoded;
+  ASSERT_EQ(Decode("", Encode("", target), &decoded),
+            VcdiffDecoder::Result::OK);
+  EXPECT_EQ(decoded, target);
+}
+
+TEST_F(VcdiffDecoderTest, DecodesHandcraftedWindow) {
+  // control for tests below which corrupt this window
+  std::vector<uint8_t> delta = MakeDelta(
+      kVcdSource | kVcdAdler32, 4, 8, Adler32("abcdwxyz"),
+      {'w', 'x', 'y', 'z'}, {kCopySize4Mode0, kAddSize4}, {0});
+  std::string decoded;
+  ASSERT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::OK);
+  EXPECT_EQ(decoded, "abcdwxyz");
+}
+
+TEST_F(VcdiffDecoderTest, RejectsTruncatedDelta) {
+  std::string source = MakeContent(64 * 1024, 7);
+  std::string target = source;
+  target.replace(1000, 100, MakeContent(100, 8));
+  std::vector<uint8_t> delta = Encode(source, target);
+  for (size_t size : {delta.size() - 1, delta.size() / 2, sizeof(kHeader)}) {
+    std::vector<uint8_t> truncated(delta.begin(), delta.begin() + size);
+    std::string decoded;
+    // whole header is valid delta without windows
+    VcdiffDecoder::Result expected = size == sizeof(kHeader) ?
+        VcdiffDecoder::Result::OK : VcdiffDecoder::Result::ERROR;
+    EXPECT_EQ(Decode(source, truncated, &decoded), expected) << size;
+  }
+  std::vector<uint8_t> header(delta.begin(), delta.begin() + 3);
+  std::string decoded;
+  EXPECT_EQ(Decode(source, header, &decoded), VcdiffDecoder::Result::ERROR);
+}
+
+TEST_F(VcdiffDecoderTest, RejectsCorruptWindow) {
+  std::string decoded;
+  // unknown window indicator bits
+  std::vector<uint8_t> delta = MakeDelta(
+      kVcdSource | 0x10, 4, 8, 0, {'w', 'x', 'y', 'z'},
+      {kCopySize4Mode0, kAddSize4}, {0});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+  // instructions produce less than target window size
+  delta = MakeDelta(kVcdSource, 4, 9, 0, {'w', 'x', 'y', 'z'},
+                    {kCopySize4Mode0, kAddSize4}, {0});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+  // ADD reads past data section
+  delta = MakeDelta(kVcdSource, 4, 8, 0, {'w', 'x', 'y'},
+                    {kCopySize4Mode0, kAddSize4}, {0});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+  // source segment bigger than source file
+  delta = MakeDelta(kVcdSource, 5, 8, 0, {'w', 'x', 'y', 'z'},
+                    {kCopySize4Mode0, kAddSize4}, {0});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+}
+
+TEST_F(VcdiffDecoderTest, RejectsCopyOutOfRange) {
+  std::string decoded;
+  // address past source segment and target decoded so far
+  std::vector<uint8_t> delta = MakeDelta(
+      kVcdSource, 4, 8, 0, {'w', 'x', 'y', 'z'},
+      {kCopySize4Mode0, kAddSize4}, {4});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+  delta = MakeDelta(kVcdSource, 4, 8, 0, {'w', 'x', 'y', 'z'},
+                    {kCopySize4Mode0, kAddSize4}, {100});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+  // COPY without source segment
+  delta = MakeDelta(0, 0, 8, 0, {'w', 'x', 'y', 'z'},
+                    {kCopySize4Mode0, kAddSize4}, {0});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+  // missing address
+  delta = MakeDelta(kVcdSource, 4, 8, 0, {'w', 'x', 'y', 'z'},
+                    {kCopySize4Mode0, kAddSize4}, {});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+}
+
+TEST_F(VcdiffDecoderTest, RejectsChecksumMismatch) {
+  std::string decoded;
+  std::vector<uint8_t> delta = MakeDelta(
+      kVcdSource | kVcdAdler32, 4, 8, Adler32("abcdwxyz") ^ 1,
+      {'w', 'x', 'y', 'z'}, {kCopySize4Mode0, kAddSize4}, {0});
+  EXPECT_EQ(Decode("abcd", delta, &decoded), VcdiffDecoder::Result::ERROR);
+
+  // source differs from one delta was created for
+  std::string source = MakeContent(64 * 1024, 9);
+  std::string target = source;
+  target.replace(2000, 100, MakeContent(100, 10));
+  delta = Encode(source, target);
+  source[30000] ^= 0xFF;
+  EXPECT_EQ(Decode(source, delta, &decoded), VcdiffDecoder::Result::ERROR);
+}
+
+TEST_F(VcdiffDecoderTest, ReportsUnsupportedFeatures) {
+  std::string decoded;
+  // secondary compression of delta
+  std::vector<uint8_t> delta(kHeader, kHeader + sizeof(kHeader));
+  delta[4] = 0x01;
+  delta.push_back(0);
+  EXPECT_EQ(Decode("abcd", delta, &decoded),
+            VcdiffDecoder::Result::UNSUPPORTED);
+}
+
+}  // namespace common_installer
@@ -0,0 +1,260 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <zip.h>
+#include <zlib.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "common/utils/file_digests.h"
+#include "common/utils/inflater.h"
+#include "common/utils/zip_extractor.h"
+#include "common/utils/zip_index.h"
+#include "unit_tests/test_utils.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+class ZipExtractorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    work_dir_ = bf::temp_directory_path() /
+        bf::unique_path("zip-extractor-test-%%%%%%");
+    destination_ = work_dir_ / "extracted";
+    package_ = work_dir_ / "package.zip";
+    ASSERT_TRUE(bf::create_directories(destination_));
+  }
+
+  void TearDown() override {
+    bs::error_code error;
+    bf::remove_all(work_dir_, error);
+  }
+
+  bool Extract(const std::vector<TestFile>& files,
+               const ExtractOptions& options) {
+    if (!WritePackage(package_, files))
+      return false;
+    ZipExtractor extractor(package_, destination_, options);
+    return extractor.Extract("");
+  }
+
+  void ExpectExtracted(const std::vector<TestFile>& files,
+                       const bf::path& root) {
+    for (auto& file : files) {
+      if (file.name.back() == '/')
+        EXPECT_TRUE(bf::is_directory(root / file.name)) << file.name;
+      else
+        EXPECT_EQ(ReadFile(root / file.name), file.content) << file.name;
+    }
+  }
+
+  bf::path work_dir_;
+  bf::path destination_;
+  bf::path package_;
+};
+
+TEST_F(ZipExtractorTest, IndexesCentralDirectory) {
+  std::vector<TestFile> files = {
+    {"config.xml", MakeCompressibleContent(5000, 1), Z_DEFLATED},
+    {"res/", std::string(), 0},
+    {"res/icon.png", MakeCompressibleContent(3000, 2), 0},
+  };
+  ASSERT_TRUE(WritePackage(package_, files));
+  std::shared_ptr<const ZipIndex> index = ZipIndex::Open(package_);
+  ASSERT_NE(index, nullptr);
+  ASSERT_EQ(index->entries().size(), files.size());
+  for (size_t i = 0; i < files.size(); ++i)
+    EXPECT_EQ(index->entries()[i].name, files[i].name);
+  const ZipEntry* entry = index->Find("res/icon.png");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry, &index->entries()[2]);
+  EXPECT_EQ(entry->uncompressed_size, 3000u);
+  EXPECT_EQ(entry->compressed_size, 3000u);
+  EXPECT_EQ(entry->compression_method, 0u);
+  EXPECT_EQ(index->Find("res/missing"), nullptr);
+  // unmodified archive is indexed once
+  EXPECT_EQ(ZipIndex::Open(package_), index);
+}
+
+TEST_F(ZipExtractorTest, ExtractsStoredDeflatedAndZstdEntries) {
+  std::vector<TestFile> files = {
+    {"stored.bin", MakeCompressibleContent(70000, 3), 0},
+    {"deflated.xml", MakeCompressibleContent(90000, 4), Z_DEFLATED},
+    {"res/empty", std::string(), 0},
+    {"res/empty-deflated", std::string(), Z_DEFLATED},
+    // streamed through minizip instead of inflated in memory
+    {"res/big.dat", MakeCompressibleContent(20 * 1024 * 1024, 5), Z_DEFLATED},
+  };
+#ifdef HAVE_ZSTD
+  files.push_back({"lib/zstd.so", MakeCompressibleContent(120000, 6),
+                   kZipMethodZstd});
+  files.push_back({"lib/zstd-empty", std::string(), kZipMethodZstd});
+#endif
+  for (auto& backend : Inflater::AvailableBackends()) {
+    SCOPED_TRACE(backend);
+    ExtractOptions options;
+    options.inflate_backend = backend;
+    ASSERT_TRUE(Extract(files, options));
+    ExpectExtracted(files, destination_);
+    bs::error_code error;
+    bf::remove_all(destination_, error);
+    bf::create_directories(destination_);
+  }
+}
+
+TEST_F(ZipExtractorTest, ExtractsEmptyDeflatedEntryFirst) {
+  // no output buffer is allocated before first entry
+  std::vector<TestFile> files = {
+    {"empty", std::string(), Z_DEFLATED},
+    {"config.xml", MakeCompressibleContent(100, 7), Z_DEFLATED},
+  };
+  for (auto& backend : Inflater::AvailableBackends()) {
+    SCOPED_TRACE(backend);
+    ExtractOptions options;
+    options.inflate_backend = backend;
+    options.threads = 1;
+    ASSERT_TRUE(Extract(files, options));
+    ExpectExtracted(files, destination_);
+    bs::error_code error;
+    bf::remove_all(destination_, error);
+    bf::create_directories(destination_);
+  }
+}
+
+TEST_F(ZipExtractorTest, ParallelExtractionMatchesSequential) {
+  std::vector<TestFile> files;
+  for (unsigned i = 0; i < 60; ++i) {
+    std::string dir = "dir" + std::to_string(i % 5) + "/sub" +
+        std::to_string(i % 3) + "/";
+    // sizes vary a lot, so that batches get different number of files
+    size_t size = (i % 10 == 0) ? 300000 : 1000 + i * 977;
+    files.push_back({dir + "file" + std::to_string(i),
+                     MakeCompressibleContent(size, i),
+                     i % 2 ? Z_DEFLATED : 0});
+  }
+  files.push_back({"empty-dir/", std::string(), 0});
+  ASSERT_TRUE(WritePackage(package_, files));
+
+  bf::path sequential = work_dir_ / "sequential";
+  bf::path parallel = work_dir_ / "parallel";
+  ASSERT_TRUE(bf::create_directories(sequential));
+  ASSERT_TRUE(bf::create_directories(parallel));
+  DigestTable sequential_digests;
+  DigestTable parallel_digests;
+
+  ExtractOptions options;
+  options.threads = 1;
+  options.digests = &sequential_digests;
+  ASSERT_TRUE(ZipExtractor(package_, sequential, options).Extract(""));
+  options.threads = 4;
+  options.digests = &parallel_digests;
+  ASSERT_TRUE(ZipExtractor(package_, parallel, options).Extract(""));
+
+  ExpectExtracted(files, parallel);
+  EXPECT_TRUE(ReadTree(sequential) == ReadTree(parallel));
+  EXPECT_TRUE(bf::is_directory(parallel / "empty-dir"));
+  ASSERT_EQ(sequential_digests.size(), parallel_digests.size());
+  for (auto& item : sequential_digests)
+    EXPECT_EQ(parallel_digests[item.first].sha256, item.second.sha256)
+        << item.first;
+}
+
+TEST_F(ZipExtractorTest, FillsDigestTable) {
+  std::vector<TestFile> files = {
+    {"config.xml", MakeCompressibleContent(4000, 7), Z_DEFLATED},
+    {"res/", std::string(), 0},
+    {"res/icon.png", MakeCompressibleContent(6000, 8), 0},
+    {"res/empty", std::string(), 0},
+  };
+  DigestTable digests;
+  ExtractOptions options;
+  options.digests = &digests;
+  options.digest_algorithms = DIGEST_SHA256 | DIGEST_SHA512;
+  ASSERT_TRUE(Extract(files, options));
+
+  // only regular files have digests, keyed by their path in archive
+  EXPECT_EQ(digests.size(), 3u);
+  EXPECT_EQ(digests.count("res/"), 0u);
+  for (auto& name : {"config.xml", "res/icon.png", "res/empty"}) {
+    FileDigests expected;
+    ASSERT_TRUE(CalculateFileDigests(destination_ / name,
+                                     DIGEST_SHA256 | DIGEST_SHA512,
+                                     &expected));
+    ASSERT_EQ(digests.count(name), 1u) << name;
+    EXPECT_EQ(digests[name].sha256.size(), 32u) << name;
+    EXPECT_EQ(digests[name].sha512.size(), 64u) << name;
+    EXPECT_EQ(digests[name].sha256, expected.sha256) << name;
+    EXPECT_EQ(digests[name].sha512, expected.sha512) << name;
+  }
+  EXPECT_NE(digests["config.xml"].sha256, digests["res/icon.png"].sha256);
+}
+
+TEST_F(ZipExtractorTest, RejectsDirectoryClimbing) {
+  for (auto& name : {"../evil", "res/../../evil", "./../evil"}) {
+    SCOPED_TRACE(name);
+    std::vector<TestFile> files = {
+      {"config.xml", MakeCompressibleContent(100, 9), Z_DEFLATED},
+      {name, "evil", 0},
+    };
+    EXPECT_FALSE(Extract(files, ExtractOptions()));
+    EXPECT_FALSE(bf::exists(work_dir_ / "evil"));
+    bs::error_code error;
+    bf::remove(package_, error);
+  }
+}
+
+TEST_F(ZipExtractorTest, RejectsStoredEntryWithDifferentSizes) {
+  std::string content = MakeCompressibleContent(10000, 10);
+  uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(content.data()),
+                    content.size());
+  zipFile zip_file = zipOpen64(package_.c_str(), APPEND_STATUS_CREATE);
+  ASSERT_NE(zip_file, nullptr);
+  zip_fileinfo info = {};
+  // file size in central directory is smaller than size of stored data
+  ASSERT_EQ(zipOpenNewFileInZip2_64(zip_file, "stored.bin", &info, nullptr, 0,
+                                    nullptr, 0, nullptr, 0, 0, 1, 1), ZIP_OK);
+  ASSERT_EQ(zipWriteInFileInZip(zip_file, content.data(), content.size()),
+            ZIP_OK);
+  ASSERT_EQ(zipCloseFileInZipRaw64(zip_file, content.size() / 2, crc),
+            ZIP_OK);
+  ASSERT_EQ(zipClose(zip_file, nullptr), ZIP_OK);
+
+  ExtractOptions options;
+  options.verify_crc = false;
+  EXPECT_FALSE(ZipExtractor(package_, destination_, options).Extract(""));
+}
+
+TEST_F(ZipExtractorTest, RejectsDuplicatedEntries) {
+  const std::vector<std::pair<const char*, const char*>> duplicates = {
+    {"res/icon.png", "res/icon.png"},
+    {"res/icon.png", "res//icon.png"},
+    {"config.xml", "./config.xml"},
+    {"res/icon.png", "res/./icon.png"},
+    {"res/", "res"},
+  };
+  for (auto& names : duplicates) {
+    SCOPED_TRACE(std::string(names.first) + " " + names.second);
+    std::vector<TestFile> files = {
+      {names.first, "first", 0},
+      {"other.xml", MakeCompressibleContent(1000, 11), Z_DEFLATED},
+      {names.second, "second", 0},
+    };
+    ASSERT_TRUE(WritePackage(package_, files));
+    EXPECT_EQ(ZipIndex::Open(package_), nullptr);
+    EXPECT_FALSE(ZipExtractor(package_, destination_, ExtractOptions())
+        .Extract(""));
+    bs::error_code error;
+    bf::remove(package_, error);
+  }
+}
+
+}  // namespace common_installer
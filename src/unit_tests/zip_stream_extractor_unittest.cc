@@ -0,0 +1,142 @@
+// Copyright (c) 2016 Samsung Electronics Co., Ltd All Rights Reserved
+// Use of this source code is governed by an apache 2.0 license that can be
+// found in the LICENSE file.
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common/utils/zip_stream_extractor.h"
+#include "unit_tests/test_utils.h"
+
+namespace bf = boost::filesystem;
+namespace bs = boost::system;
+
+namespace common_installer {
+
+class ZipStreamExtractorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    work_dir_ = bf::temp_directory_path() /
+        bf::unique_path("zip-stream-test-%%%%%%");
+    destination_ = work_dir_ / "extracted";
+    package_ = work_dir_ / "package.zip";
+    ASSERT_TRUE(bf::create_directories(destination_));
+
+    files_ = {
+      {"config.xml", std::string(100000, 'a'), Z_DEFLATED},
+      {"res/images/icon.png", std::string(300000, '\x7f'), 0},
+      {"res/empty", std::string(), 0},
+      {"author-signature.xml", "<Signature/>", Z_DEFLATED},
+    };
+    ASSERT_TRUE(WritePackage(package_, files_));
+  }
+
+  void TearDown() override {
+    bs::error_code error;
+    bf::remove_all(work_dir_, error);
+  }
+
+  // extracts data written to pipe by child process in small pieces, which
+  // stands in for network transfer
+  bool ExtractFromProducer(const std::string& data, DigestTable* digests,
+                           uint64_t max_unpacked_size = 0,
+                           bool* out_of_space = nullptr) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0)
+      return false;
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(pipe_fds[0]);
+      const size_t kChunkSize = 4096;
+      for (size_t pos = 0; pos < data.size(); pos += kChunkSize) {
+        size_t size = std::min(kChunkSize, data.size() - pos);
+        if (write(pipe_fds[1], data.data() + pos, size) !=
+            static_cast<ssize_t>(size))
+          _exit(1);
+        usleep(100);
+      }
+      _exit(0);
+    }
+    close(pipe_fds[1]);
+    ExtractOptions options;
+    options.digests = digests;
+    options.buffer_size = 1000;
+    options.max_unpacked_size = max_unpacked_size;
+    ZipStreamExtractor extractor(pipe_fds[0], destination_, options);
+    bool result = extractor.Extract();
+    if (out_of_space)
+      *out_of_space = extractor.out_of_space();
+    close(pipe_fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return result;
+  }
+
+  bf::path work_dir_;
+  bf::path destination_;
+  bf::path package_;
+  std::vector<TestFile> files_;
+};
+
+TEST_F(ZipStreamExtractorTest, ExtractsPackageFromPipe) {
+  DigestTable digests;
+  ASSERT_TRUE(ExtractFromProducer(ReadFile(package_), &digests));
+  for (auto& file : files_) {
+    EXPECT_EQ(ReadFile(destination_ / file.name), file.content) << file.name;
+    EXPECT_EQ(digests.count(file.name), 1u) << file.name;
+  }
+}
+
+TEST_F(ZipStreamExtractorTest, RejectsTruncatedPackage) {
+  std::string data = ReadFile(package_);
+  // central directory is missing
+  data.resize(data.size() - 50);
+  EXPECT_FALSE(ExtractFromProducer(data, nullptr));
+}
+
+TEST_F(ZipStreamExtractorTest, RejectsCorruptedPackage) {
+  std::string data = ReadFile(package_);
+  // flip byte inside data of stored file
+  size_t pos = data.find(std::string(1000, '\x7f'));
+  ASSERT_NE(pos, std::string::npos);
+  data[pos] = '\x7e';
+  EXPECT_FALSE(ExtractFromProducer(data, nullptr));
+}
+
+TEST_F(ZipStreamExtractorTest, LimitsUnpackedSize) {
+  uint64_t total = 0;
+  for (auto& file : files_)
+    total += file.content.size();
+  bool out_of_space = false;
+  EXPECT_FALSE(ExtractFromProducer(ReadFile(package_), nullptr, total - 1,
+                                   &out_of_space));
+  EXPECT_TRUE(out_of_space);
+  bs::error_code error;
+  bf::remove_all(destination_, error);
+  ASSERT_TRUE(bf::create_directories(destination_));
+  EXPECT_TRUE(ExtractFromProducer(ReadFile(package_), nullptr, total,
+                                  &out_of_space));
+  EXPECT_FALSE(out_of_space);
+}
+
+TEST_F(ZipStreamExtractorTest, RejectsDuplicatedEntries) {
+  // both entries are extracted to the same file
+  std::vector<TestFile> files = {
+    {"res/icon.png", "icon1", 0},
+    {"res//icon.png", "icon2", 0},
+  };
+  ASSERT_TRUE(WritePackage(package_, files));
+  EXPECT_FALSE(ExtractFromProducer(ReadFile(package_), nullptr));
+}
+
+}  // namespace common_installer